@@ -5,6 +5,7 @@
 #include "device_id.h"
 #include "utils.h"
 #include "Timer.hpp"
+#include "CommandParser.h"
 
 #define USE_NETWORK
 #define NO_ETHERNET
@@ -13,6 +14,9 @@
 const int g_update_interval = 33;
 char g_serial_buf[512];
 
+// incoming text-commands from serial
+kinski::LineBuffer<128> g_serial_lines;
+
 //! time management
 const int g_update_interval_params = 2000;
 int g_time_accum = 0, g_time_accum_params = 0;
@@ -24,6 +28,7 @@ enum TimerEnum{TIMER_UDP_BROADCAST = 0};
 
 #ifdef USE_NETWORK
 #include "NetworkHelper.h"
+#include "Telemetry.h"
 
 // Ethernet MAC adress
 uint8_t g_mac_adress[6] = {0x00, 0xAA, 0xBB, 0xCC, 0xDE, 0x69};
@@ -47,6 +52,16 @@ void send_udp_broadcast()
 {
      NetworkHelper::get()->send_udp_broadcast(DEVICE_ID, g_udp_broadcast_port);
 };
+
+//! incoming text-commands of a network-client and the client-session they belong to
+struct net_input_t
+{
+    kinski::LineBuffer<128> lines;
+    uint32_t session = 0;
+};
+
+// one per connection-slot, partial lines of different clients never mix
+net_input_t g_net_inputs[NetworkHelper::s_max_num_connections];
 #endif
 
 //! number of capacitve touch sensors used
@@ -73,6 +88,23 @@ const uint8_t g_thresh_touch = 12;
 const uint8_t g_thresh_release = 6;
 const uint8_t g_charge_time = 0;
 
+#ifdef USE_NETWORK
+// binary telemetry via UDP, to a unicast- or multicast-address
+IPAddress g_telemetry_ip(239, 255, 42, 1);
+uint16_t g_telemetry_port = 55556;
+
+// telemetry interval in micros (500Hz)
+const uint32_t g_telemetry_interval = 2000;
+uint32_t g_telemetry_time_stamp = 0;
+bool g_use_telemetry = false;
+
+// touch-bitmask and proximity per sensor
+kinski::TelemetryPacket<2 * NUM_SENSORS> g_telemetry;
+
+//! touch-events since the last telemetry packet
+uint16_t g_touch_telemetry[NUM_SENSORS];
+#endif
+
 void blink_status_led()
 {
     digitalWrite(13, LOW);
@@ -118,6 +150,7 @@ void setup()
         g_timer[TIMER_UDP_BROADCAST].expires_from_now(g_udp_broadcast_interval);
         g_timer[TIMER_UDP_BROADCAST].set_periodic();
         g_timer[TIMER_UDP_BROADCAST].set_callback(&::send_udp_broadcast);
+        g_use_telemetry = true;
     }
 #endif
     digitalWrite(13, LOW);
@@ -134,6 +167,11 @@ void loop()
     // poll Timer objects
     for(uint32_t i = 0; i < g_num_timers; ++i){ g_timer[i].poll(); }
 
+#ifdef USE_NETWORK
+    // drain queued output, slow clients never block the sensor-loop
+    g_net_helper->update_connections();
+#endif
+
     uint16_t touch_states = 0;
 
     for(uint8_t i = 0; i < NUM_SENSORS; i++)
@@ -156,28 +194,49 @@ void loop()
 
         // register all touch-events and keep them
         g_touch_buffer[i] |= touch_states;
+
+#ifdef USE_NETWORK
+        g_touch_telemetry[i] |= touch_states;
+#endif
+    }
+
+#ifdef USE_NETWORK
+    if(g_use_telemetry && micros() - g_telemetry_time_stamp >= g_telemetry_interval)
+    {
+        g_telemetry_time_stamp = micros();
+
+        for(uint8_t i = 0; i < NUM_SENSORS; i++)
+        {
+            g_telemetry.set_value(2 * i, g_touch_telemetry[i]);
+            g_telemetry.set_value(2 * i + 1, g_proxy_values[i]);
+            g_touch_telemetry[i] = 0;
+        }
+        g_telemetry.stamp(g_telemetry_time_stamp);
+        g_net_helper->send_udp(g_telemetry.data(), g_telemetry.size(), g_telemetry_ip,
+                               g_telemetry_port);
     }
+#endif
 
 
     if(g_time_accum >= g_update_interval)
     {
-        char fmt_buf[32];
+        // "<touch_mask> <proximity> ..." per sensor, appended in place
         char *buf_ptr = g_serial_buf;
 
         for(uint8_t i = 0; i < NUM_SENSORS; i++)
         {
-            buf_ptr += sprintf(buf_ptr, "%d", g_touch_buffer[0]);
-
-            fmt_real_to_str(fmt_buf, g_proxy_values[i]);
-            buf_ptr += sprintf(buf_ptr, " %s ", fmt_buf);
+            if(i){ *buf_ptr++ = ' '; }
+            buf_ptr = kinski::fmt_uint(buf_ptr, g_touch_buffer[i]);
+            *buf_ptr++ = ' ';
+            buf_ptr = kinski::fmt_fixed(buf_ptr, g_proxy_values[i]);
+            g_touch_buffer[i] = 0;
         }
-        sprintf(buf_ptr - 1, "\n");
+        kinski::fmt_char(buf_ptr, '\n');
 
         g_time_accum = 0;
-        g_touch_buffer[0] = 0;
 
         // IO -> Serial
-        process_input(Serial);
+        process_input(Serial, g_serial_lines);
         Serial.write(g_serial_buf);
 
 #ifdef USE_NETWORK
@@ -187,77 +246,58 @@ void loop()
 
         for(uint32_t i = 0; i < num_connections; ++i)
         {
-             process_input(*net_clients[i]);
+             net_input_t &input = g_net_inputs[net_clients[i]->slot()];
+
+             // the slot was closed and taken over by a new client since
+             if(input.session != net_clients[i]->session())
+             {
+                 input.lines.clear();
+                 input.session = net_clients[i]->session();
+             }
+             process_input(*net_clients[i], input.lines);
              net_clients[i]->write((const uint8_t*)g_serial_buf, strlen(g_serial_buf));
         }
 #endif
     }
 }
 
-template <typename T> void process_input(T& the_device)
+void cmd_query_id(Print &the_device, kinski::Args &the_args)
 {
-    uint16_t buf_idx = 0;
-
-    while(the_device.available())
-    {
-        // get the new byte:
-        char c = the_device.read();
-
-        switch(c)
-        {
-            case '\r':
-            case '\0':
-                continue;
-
-            case '\n':
-                g_serial_buf[buf_idx] = '\0';
-                buf_idx = 0;
-                parse_line(g_serial_buf);
-                break;
-
-            default:
-                g_serial_buf[buf_idx++] = c;
-                break;
-        }
-    }
+    the_device.write(CMD_QUERY_ID " " DEVICE_ID "\n");
 }
 
-bool check_for_cmd(const char* the_str)
+//! sorted by name
+constexpr kinski::command_t<Print> g_commands[] =
 {
-    if(strcmp(the_str, CMD_QUERY_ID) == 0)
-    {
-        char buf[32];
-        sprintf(buf, "%s %s\n", the_str, DEVICE_ID);
-        Serial.write(buf);
-        #ifdef USE_BLUETOOTH
-            g_bt_serial.write(buf);
-        #endif
-        return true;
-    }
-    return false;
-}
+    {CMD_QUERY_ID, &cmd_query_id}
+};
+static_assert(kinski::is_sorted(g_commands), "command-table must be sorted by name");
 
-void parse_line(char *the_line)
+//! "<touch_threshold> <release_threshold> <charge_current>"
+void set_sensor_params(kinski::Args &the_args)
 {
-    const char* delim = " ";
-    const size_t elem_count = 3;
-    char *token = strtok(the_line, delim);
-    int num_buf[elem_count];
-    uint16_t i = 0;
+    int32_t touch, release, current;
 
-    for(; token && (i < elem_count); i++)
+    if(the_args.next_int(&touch) && the_args.next_int(&release) && the_args.next_int(&current))
     {
-        if(check_for_cmd(token)){ break; }
-        else{ num_buf[i] = atoi(token); }
-        token = strtok(nullptr, delim);
+        for(uint8_t i = 0; i < NUM_SENSORS; ++i)
+        {
+            g_cap_sensors[i].setThresholds(touch, release);
+            g_cap_sensors[i].setChargeCurrentAndTime(current, g_charge_time);
+        }
     }
+}
 
-    if(i == elem_count)
+template <typename T> void process_input(T& the_device, kinski::LineBuffer<128> &the_lines)
+{
+    while(the_device.available())
     {
-        for(uint8_t i = 0; i < NUM_SENSORS; ++i)
+        if(!the_lines.feed(the_device.read())){ continue; }
+
+        if(!kinski::dispatch_command(g_commands, the_device, the_lines.line(), the_lines.length()))
         {
-            g_cap_sensors[i].setThresholds(num_buf[0], num_buf[1]);
-            g_cap_sensors[i].setChargeCurrentAndTime(num_buf[2], g_charge_time);
+            kinski::Args args(the_lines.line(), the_lines.length());
+            set_sensor_params(args);
         }
     }
 }
@@ -0,0 +1,150 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+'''
+python script to receive binary telemetry from cap_sense_mpr (see libs/Telemetry/Telemetry.h)
+
+usage: telemetry_receiver.py [port] [multicast_group]
+'''
+
+import sys, time, struct, socket
+
+MAGIC = b'KT'
+VERSION = 1
+HEADER = struct.Struct('<2sBBII')
+
+DEFAULT_PORT = 55556
+DEFAULT_GROUP = '239.255.42.1'
+
+#############################################################
+
+def decode(the_packet):
+  """returns (sequence, timestamp in us, [values]) or None for invalid packets"""
+  if len(the_packet) < HEADER.size: return None
+  magic, version, num_channels, sequence, timestamp = HEADER.unpack_from(the_packet)
+
+  if magic != MAGIC or version != VERSION or len(the_packet) != HEADER.size + 2 * num_channels:
+    return None
+  values = struct.unpack_from('<{}H'.format(num_channels), the_packet, HEADER.size)
+  return sequence, timestamp, list(values)
+
+def open_socket(the_port, the_group=None):
+  sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+  sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+  sock.bind(('', the_port))
+
+  if the_group:
+    mreq = struct.pack('4s4s', socket.inet_aton(the_group), socket.inet_aton('0.0.0.0'))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+  return sock
+
+#############################################################
+
+class SequenceTracker(object):
+  """
+  loss-, reorder- and duplicate-accounting for the sequence numbers of one sender.
+  gaps are only counted as lost once they fell out of the reorder-window,
+  late packets filling a gap count as reordered instead.
+  jumping back further than the window means the sender restarted its sequence, e.g. on reboot
+  """
+  WINDOW = 1024
+
+  def __init__(self):
+    self.last = None
+    self.missing = set()
+    self.num_lost = 0
+    self.num_reordered = 0
+    self.num_duplicates = 0
+    self.num_restarts = 0
+
+  def process(self, the_sequence):
+    """returns True for packets newer than all before"""
+    if self.last is None:
+      self.last = the_sequence
+      return True
+
+    diff = (the_sequence - self.last) & 0xFFFFFFFF
+
+    if diff == 0:
+      self.num_duplicates += 1
+      return False
+
+    # too old to be late, the sender starts over. its open gaps won't be filled anymore
+    if diff >= 0x80000000 and 0x100000000 - diff > self.WINDOW:
+      self.num_restarts += 1
+      self.num_lost += len(self.missing)
+      self.missing.clear()
+      self.last = the_sequence
+      return True
+
+    # older than the last one, either filling a gap or seen before
+    if diff >= 0x80000000:
+      if the_sequence in self.missing:
+        self.missing.remove(the_sequence)
+        self.num_reordered += 1
+      else: self.num_duplicates += 1
+      return False
+
+    # gaps beyond the window can't be filled anymore
+    num_tracked = min(diff - 1, self.WINDOW)
+    self.num_lost += diff - 1 - num_tracked
+    self.missing.update((the_sequence - i) & 0xFFFFFFFF for i in range(1, num_tracked + 1))
+    self.last = the_sequence
+
+    expired = [s for s in self.missing if (self.last - s) & 0xFFFFFFFF > self.WINDOW]
+    self.num_lost += len(expired)
+    self.missing.difference_update(expired)
+    return True
+
+  def total_lost(self):
+    """lost so far, including gaps that might still be filled"""
+    return self.num_lost + len(self.missing)
+
+class App(object):
+  def __init__(self, the_port, the_group):
+    self.socket = open_socket(the_port, the_group)
+    self.trackers = {}
+    self.num_packets = 0
+    self.running = True
+
+  def process(self, the_packet, the_sender):
+    ret = decode(the_packet)
+    if ret is None: return
+    sequence, timestamp, values = ret
+    self.num_packets += 1
+
+    # per sender, sequence numbers tell losses from reordering and duplicates
+    tracker = self.trackers.setdefault(the_sender, SequenceTracker())
+    if not tracker.process(sequence): return
+
+    # touch-bitmask and proximity per sensor
+    sensors = ['{:04x} {:.3f}'.format(values[i], values[i + 1] / 65535.0)
+               for i in range(0, len(values) - 1, 2)]
+    sys.stdout.write('\r{} {:10d} | {} | lost: {} missing: {} reordered: {} dup: {} restarts: {} '
+                     .format(the_sender, timestamp, ' | '.join(sensors), tracker.num_lost,
+                             len(tracker.missing), tracker.num_reordered, tracker.num_duplicates,
+                             tracker.num_restarts))
+
+  def run(self):
+    start = time.time()
+
+    while self.running:
+      try:
+        packet, (sender, _) = self.socket.recvfrom(1024)
+        self.process(packet, sender)
+
+      except KeyboardInterrupt:
+        print("\n->keyboard interrupt<-")
+        print("{:.1f} packets/s".format(self.num_packets / (time.time() - start)))
+
+        for sender, t in self.trackers.items():
+          print("{}: lost {}, reordered {}, duplicates {}, restarts {}".format(
+            sender, t.total_lost(), t.num_reordered, t.num_duplicates, t.num_restarts))
+        self.running = False
+        print("ciao\n")
+
+#############################################################
+
+if __name__ == '__main__':
+  port = int(sys.argv[1]) if len(sys.argv) > 1 else DEFAULT_PORT
+  group = sys.argv[2] if len(sys.argv) > 2 else DEFAULT_GROUP
+  App(port, group if group != 'none' else None).run()
@@ -2,14 +2,11 @@
 #include "ModeHelpers.h"
 #include "Timer.hpp"
 #include "LED_Path.h"
-#include "ModeHelpers.h"
+#include "SampleStats.h"
 
 // create an amplitude analyzer to be used with the I2S input
 // AmplitudeAnalyzer g_amplitude_analyzer;
 
-#define ARM_MATH_CM0PLUS
-#include <arm_math.h>
-
 // update rate in Hz
 #define UPDATE_RATE 25
 #define SERIAL_BUFSIZE 128
@@ -75,12 +72,13 @@ void blink_status_led()
     delay(1000);
 }
 
-inline int32_t calculate_amplitude(uint8_t* buffer, size_t num_bytes)
+//! single pass over the raw I2S buffer, interpreted with the configured sample width
+template <typename T> void process_samples(const uint8_t* buffer, size_t num_bytes)
 {
-    sample_t analysis = 0;
-    if(g_bits_per_sample == 16){ arm_rms_q15((q15_t*)buffer, num_bytes / 2, (q15_t*)&analysis); }
-    else if(g_bits_per_sample == 32){ arm_rms_q31((q31_t*)buffer, num_bytes / 4, &analysis); }
-    return analysis;
+    auto stats = kinski::compute_sample_stats((const T*)buffer, num_bytes / sizeof(T));
+    g_amplitude = stats.rms();
+    g_mean = stats.mean();
+    g_peak_to_peak = stats.peak_to_peak();
 }
 
 void on_i2s_receive()
@@ -92,28 +90,9 @@ void on_i2s_receive()
         g_last_mic_reading = millis();
         g_indicator = false;
 
-        // amplitude calculation
-        g_amplitude = calculate_amplitude(g_sample_buffer, num);
-
-        // mean
-        if(g_bits_per_sample == 16){ arm_mean_q15((q15_t*)g_sample_buffer, num / 2, (q15_t*)&g_mean); }
-        else if(g_bits_per_sample == 32){ arm_mean_q31((q31_t*)g_sample_buffer, num / 4, &g_mean); }
-
-        // variance
-        // sample_t variance;
-        // if(g_bits_per_sample == 16){ arm_var_q15((q15_t*)g_sample_buffer, num / 2, (q15_t*)&g_variance); }
-        // else if(g_bits_per_sample == 32){ arm_var_q31((q31_t*)g_sample_buffer, num / 4, &g_variance); }
-
-        // iterate samples
-        // sample_t *ptr = (sample_t*)g_sample_buffer, *end = (sample_t*)(g_sample_buffer + num);
-        // for(; ptr < end; ++ptr){ ptr -= g_mean; }
-
-        // peak to peak
-        uint32_t index;
-        sample_t min, max;
-        arm_min_q31((q31_t*)g_sample_buffer, num / 4, &min, &index);
-        arm_max_q31((q31_t*)g_sample_buffer, num / 4, &max, &index);
-        g_peak_to_peak = abs(max - min);
+        // amplitude, mean and peak to peak
+        if(g_bits_per_sample == 16){ process_samples<int16_t>(g_sample_buffer, num); }
+        else if(g_bits_per_sample == 32){ process_samples<int32_t>(g_sample_buffer, num); }
 
         int16_t* ptr = (int16_t*)g_sample_buffer, *end = (int16_t*)(g_sample_buffer + sizeof(g_sample_buffer));
         for(; ptr < end; ++ptr){ Serial.println(*ptr); }
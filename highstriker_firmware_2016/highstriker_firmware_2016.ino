@@ -15,7 +15,7 @@
 
 #define SERIAL_END_CODE '\n'
 #define SERIAL_BUFSIZE 512
-char g_serial_buf[SERIAL_BUFSIZE], g_num_buf[32];
+char g_serial_buf[SERIAL_BUFSIZE];
 
 long g_last_time_stamp = 0;
 uint32_t g_time_accum = 0;
@@ -101,19 +101,20 @@ void loop()
 
     if(g_time_accum >= g_update_interval)
     {
+        // append in place, no strcat/sprintf
+        char *buf_ptr = g_serial_buf;
+
         for(uint8_t s = 0; s < g_num_sensors; s++)
         {
-            fmt_real_to_str(g_num_buf, g_value_buf[s]);
-            strcat(g_serial_buf, g_num_buf);
-            strcat(g_serial_buf, " ");
+            buf_ptr = kinski::fmt_fixed(buf_ptr, g_value_buf[s]);
+            *buf_ptr++ = ' ';
         }
-        g_serial_buf[strlen(g_serial_buf) - 1] = '\n';
-        // strcat(g_serial_buf, "\n");
 
-        // sprintf(g_serial_buf, "%s\n", g_num_buf);
+        // replace the trailing space
+        if(buf_ptr > g_serial_buf){ buf_ptr--; }
+        kinski::fmt_char(buf_ptr, '\n');
         Serial.write(g_serial_buf);
 
-        g_serial_buf[0] = '\0';
         memset(g_value_buf, 0, sizeof(g_value_buf));
         g_time_accum = 0;
         g_indicator = !g_indicator;
@@ -1,15 +1,13 @@
 #pragma once
 
 #include "Arduino.h"
+#include "Format.h"
 
+//! fixed-point decimal with precision fractional digits
 template <typename T>
 void fmt_real_to_str(char *buf, T val, uint32_t precision = 3)
 {
-    int multiplier = 1;
-    for(int i = 0; i < precision; i++){ multiplier *= 10; }
-    T frac = val - int(val);
-    int32_t fmt = frac * multiplier;
-    sprintf(buf, "%d.%d", (int)val, fmt);
+    kinski::fmt_fixed(buf, val, precision);
 };
 
 template <typename T>
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+
+/*! timing model for the SAMD21 ADC, free of any hardware dependencies.
+ *  usable on host to figure out achievable sample rates for a given configuration.
+ *
+ *  single conversion: sampling (SAMPLEN + 1) / 2 CLK_ADC cycles
+ *                     + propagation (1 + RESOLUTION / 2) CLK_ADC cycles
+ *  resolutions above 12 bits are reached by hardware oversampling and decimation,
+ *  accumulating 4^(resolution - 12) single 12 bit conversions.
+ *  while an oversampled result is accumulated, no other channel can be converted,
+ *  so keep its duration below the timer period of a scan to avoid overruns.
+ */
+
+//! ADC input clock (GCLK0, as configured by the Arduino core)
+constexpr uint32_t g_adc_gclk_hz = 48000000;
+
+//! global ADC timing settings, shared by all channels
+struct adc_config_t
+{
+    //! ADC clock prescaler (4, 8, 16, ... 512), applied to g_adc_gclk_hz
+    uint16_t prescaler;
+
+    //! sample length in 1/2 CLK_ADC cycles (0 ... 63)
+    uint8_t sample_length;
+};
+
+//! the settings ADC_Sampler used before they were configurable: DIV8, SAMPCTRL 0x2F
+constexpr adc_config_t g_adc_default_config = {8, 0x2F};
+
+//! clamp a requested resolution to one of 8, 10, 12, 13, 14, 15, 16. 0 -> 10 bits
+inline uint8_t adc_valid_resolution(uint8_t the_resolution)
+{
+    if(!the_resolution){ return 10; }
+    if(the_resolution >= 16){ return 16; }
+    if(the_resolution > 12){ return the_resolution; }
+    if(the_resolution > 10){ return 12; }
+    if(the_resolution > 8){ return 10; }
+    return 8;
+}
+
+//! number of single conversions accumulated per result for a given resolution
+inline uint32_t adc_num_conversions(uint8_t the_resolution)
+{
+    the_resolution = adc_valid_resolution(the_resolution);
+    return the_resolution > 12 ? 1 << (2 * (the_resolution - 12)) : 1;
+}
+
+//! duration of one result in 1/2 CLK_ADC cycles
+inline uint32_t adc_conversion_half_cycles(uint8_t the_resolution, uint8_t the_sample_length)
+{
+    the_resolution = adc_valid_resolution(the_resolution);
+    uint32_t bits = the_resolution > 12 ? 12 : the_resolution;
+    return adc_num_conversions(the_resolution) * ((the_sample_length + 1) + 2 + bits);
+}
+
+//! duration of one result in microseconds
+inline float adc_conversion_micros(const adc_config_t &the_config, uint8_t the_resolution)
+{
+    float adc_clock = (float)g_adc_gclk_hz / the_config.prescaler;
+    return 1.e6f * adc_conversion_half_cycles(the_resolution, the_config.sample_length) /
+           (2.f * adc_clock);
+}
+
+//! maximum sample rate in Hz for a single channel with the_resolution
+inline float adc_max_sample_rate(const adc_config_t &the_config, uint8_t the_resolution)
+{
+    return 1.e6f / adc_conversion_micros(the_config, the_resolution);
+}
+
+/*! maximum timer-rate for a scan over multiple channels.
+ *  each channel i is converted on every the_decimations[i]-th tick,
+ *  so on average it occupies conversion_time[i] / the_decimations[i] of every tick.
+ */
+inline float adc_max_scan_rate(const adc_config_t &the_config, const uint8_t *the_resolutions,
+                               const uint32_t *the_decimations, uint8_t the_num_channels)
+{
+    float micros_per_tick = 0.f;
+
+    for(uint8_t i = 0; i < the_num_channels; ++i)
+    {
+        uint32_t decimation = the_decimations[i] ? the_decimations[i] : 1;
+        micros_per_tick += adc_conversion_micros(the_config, the_resolutions[i]) / decimation;
+    }
+    return micros_per_tick > 0.f ? 1.e6f / micros_per_tick : 0.f;
+}
@@ -0,0 +1,297 @@
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+//
+// Copyright (C) 2012-2017, Fabian Schmidt <crocdialer@googlemail.com>
+//
+// It is distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+
+//  CommandParser.h
+//
+//  line-accumulation, tokenizing and command-dispatch for text-protocols, without allocations
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace kinski
+{
+
+/*! accumulates characters into lines, across any number of calls.
+ *  '\r' and '\0' are ignored, empty lines are skipped.
+ *  lines exceeding the buffer are dropped as a whole and counted.
+ */
+template <uint16_t N> class LineBuffer
+{
+public:
+
+    explicit LineBuffer(char the_delimiter = '\n'): m_delimiter(the_delimiter){}
+
+    //! feed a single character. returns true, if it completed a line
+    bool feed(char the_char)
+    {
+        if(m_complete){ clear(); }
+
+        if(the_char == m_delimiter)
+        {
+            bool ret = m_length && !m_overflow;
+            if(m_overflow){ m_num_overflows++; }
+
+            m_overflow = false;
+            m_buf[m_length] = '\0';
+            m_complete = ret;
+            if(!ret){ m_length = 0; }
+            return ret;
+        }
+        if(the_char == '\r' || the_char == '\0'){ return false; }
+
+        // keep room for the terminator
+        if(m_length < N - 1){ m_buf[m_length++] = the_char; }
+        else{ m_overflow = true; }
+        return false;
+    }
+
+    //! the completed, null-terminated line. only meaningful after feed() returned true
+    char* line(){ return m_buf; }
+
+    uint16_t length() const { return m_length; }
+
+    //! discard a partial line
+    void clear()
+    {
+        m_length = 0;
+        m_complete = m_overflow = false;
+    }
+
+    //! number of lines dropped for exceeding the buffer
+    uint32_t num_overflows() const { return m_num_overflows; }
+
+private:
+
+    char m_buf[N];
+    uint16_t m_length = 0;
+    char m_delimiter;
+    bool m_complete = false, m_overflow = false;
+    uint32_t m_num_overflows = 0;
+};
+
+//! non-owning reference to a range of characters
+struct token_t
+{
+    const char *data;
+    size_t length;
+};
+
+//! parse a decimal integer, the whole token must be consumed. false on garbage or overflow
+inline bool parse_int(const token_t &the_token, int32_t *the_value)
+{
+    const char *ptr = the_token.data, *end = the_token.data + the_token.length;
+    bool negative = ptr < end && *ptr == '-';
+    if(ptr < end && (*ptr == '-' || *ptr == '+')){ ptr++; }
+    if(ptr == end){ return false; }
+
+    uint32_t limit = negative ? 2147483648UL : 2147483647UL, val = 0;
+
+    for(; ptr < end; ++ptr)
+    {
+        uint8_t digit = *ptr - '0';
+        if(digit > 9 || val > (limit - digit) / 10){ return false; }
+        val = val * 10 + digit;
+    }
+    *the_value = negative ? (int32_t)(0UL - val) : (int32_t)val;
+    return true;
+}
+
+//! parse a decimal number with optional fraction (no exponent), the whole token must be consumed
+inline bool parse_float(const token_t &the_token, float *the_value)
+{
+    const char *ptr = the_token.data, *end = the_token.data + the_token.length;
+    bool negative = ptr < end && *ptr == '-';
+    if(ptr < end && (*ptr == '-' || *ptr == '+')){ ptr++; }
+
+    float val = 0.f, scale = 1.f;
+    bool has_digits = false, has_point = false;
+
+    for(; ptr < end; ++ptr)
+    {
+        if(*ptr == '.' && !has_point){ has_point = true; continue; }
+
+        uint8_t digit = *ptr - '0';
+        if(digit > 9){ return false; }
+
+        if(has_point){ scale *= .1f; val += digit * scale; }
+        else{ val = val * 10.f + digit; }
+        has_digits = true;
+    }
+    if(!has_digits){ return false; }
+    *the_value = negative ? -val : val;
+    return true;
+}
+
+/*! sequential access to the arguments of a command.
+ *  the input is never modified, tokens are separated by any of the_delimiters.
+ */
+class Args
+{
+public:
+
+    Args(const char *the_str, size_t the_length, const char *the_delimiters = " "):
+    m_ptr(the_str), m_end(the_str + the_length), m_delimiters(the_delimiters){}
+
+    explicit Args(const char *the_str, const char *the_delimiters = " "):
+    Args(the_str, strlen(the_str), the_delimiters){}
+
+    //! next token, false if there is none left
+    bool next(token_t *the_token)
+    {
+        skip_delimiters();
+        if(m_ptr == m_end){ return false; }
+
+        const char *start = m_ptr;
+        while(m_ptr < m_end && !is_delimiter(*m_ptr)){ m_ptr++; }
+        *the_token = {start, (size_t)(m_ptr - start)};
+        return true;
+    }
+
+    //! next token as integer. false if there is none left or it did not parse
+    bool next_int(int32_t *the_value)
+    {
+        token_t token;
+        return next(&token) && parse_int(token, the_value);
+    }
+
+    //! next token as float. false if there is none left or it did not parse
+    bool next_float(float *the_value)
+    {
+        token_t token;
+        return next(&token) && parse_float(token, the_value);
+    }
+
+    //! copy the next token, truncated to the_size - 1 characters. returns its length
+    size_t next_str(char *the_buf, size_t the_size)
+    {
+        token_t token = {m_ptr, 0};
+        next(&token);
+        return copy(token, the_buf, the_size);
+    }
+
+    //! copy the remaining input (without leading delimiters), truncated. returns its length
+    size_t rest(char *the_buf, size_t the_size)
+    {
+        skip_delimiters();
+        token_t token = {m_ptr, (size_t)(m_end - m_ptr)};
+        m_ptr = m_end;
+        return copy(token, the_buf, the_size);
+    }
+
+    //! true if no tokens are left
+    bool empty()
+    {
+        skip_delimiters();
+        return m_ptr == m_end;
+    }
+
+private:
+
+    inline bool is_delimiter(char the_char) const
+    {
+        return strchr(m_delimiters, the_char) != nullptr;
+    }
+
+    inline void skip_delimiters()
+    {
+        while(m_ptr < m_end && is_delimiter(*m_ptr)){ m_ptr++; }
+    }
+
+    static size_t copy(const token_t &the_token, char *the_buf, size_t the_size)
+    {
+        if(!the_size){ return 0; }
+        size_t num_bytes = the_token.length < the_size - 1 ? the_token.length : the_size - 1;
+        memcpy(the_buf, the_token.data, num_bytes);
+        the_buf[num_bytes] = '\0';
+        return num_bytes;
+    }
+
+    const char *m_ptr, *m_end;
+    const char *m_delimiters;
+};
+
+/*! an entry in a command-table. handlers receive the device the command came from,
+ *  e.g. for replies, and the arguments following the command-name.
+ */
+template <typename T> struct command_t
+{
+    const char *name;
+    void (*handler)(T &the_device, Args &the_args);
+};
+
+//! compile-time string comparison, for checking command-tables
+constexpr int str_compare(const char *the_lhs, const char *the_rhs)
+{
+    return (*the_lhs != *the_rhs || !*the_lhs) ? (uint8_t)*the_lhs - (uint8_t)*the_rhs :
+                                                 str_compare(the_lhs + 1, the_rhs + 1);
+}
+
+/*! true if the_table is sorted by name, without duplicates.
+ *  use with static_assert on constexpr tables, dispatch_command() relies on it
+ */
+template <typename T, size_t N>
+constexpr bool is_sorted(const command_t<T> (&the_table)[N], size_t the_index = 1)
+{
+    return the_index >= N || (str_compare(the_table[the_index - 1].name,
+                                          the_table[the_index].name) < 0 &&
+                              is_sorted(the_table, the_index + 1));
+}
+
+/*! look up the first token of the_line in a sorted command-table and invoke its handler.
+ *  the command-name ends at ' ' or ':', e.g. "ID", "BRIGHTNESS 0.5" or "SEGMENT: 1 2".
+ *  the_device only needs to convert to the handlers' device-type, e.g. Serial to Print.
+ *  returns false for unknown commands
+ */
+template <typename T, size_t N, typename D>
+bool dispatch_command(const command_t<T> (&the_table)[N], D &the_device, const char *the_line,
+                      size_t the_length, const char *the_delimiters = " ")
+{
+    const char *end = the_line + the_length;
+    while(the_line < end && *the_line == ' '){ the_line++; }
+
+    size_t name_length = 0;
+    while(the_line + name_length < end && the_line[name_length] != ' ' &&
+          the_line[name_length] != ':'){ name_length++; }
+    if(!name_length){ return false; }
+
+    // binary search
+    size_t lo = 0, hi = N;
+
+    while(lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        const char *name = the_table[mid].name;
+        int cmp = strncmp(name, the_line, name_length);
+        if(!cmp && name[name_length]){ cmp = 1; }
+
+        if(!cmp)
+        {
+            const char *args = the_line + name_length;
+            if(args < end && *args == ':'){ args++; }
+
+            Args arg_reader(args, end - args, the_delimiters);
+            the_table[mid].handler(the_device, arg_reader);
+            return true;
+        }
+        if(cmp < 0){ lo = mid + 1; }
+        else{ hi = mid; }
+    }
+    return false;
+}
+
+template <typename T, size_t N, typename D>
+inline bool dispatch_command(const command_t<T> (&the_table)[N], D &the_device, const char *the_line)
+{
+    return dispatch_command(the_table, the_device, the_line, strlen(the_line));
+}
+
+}// namespace
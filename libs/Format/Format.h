@@ -0,0 +1,121 @@
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+//
+// Copyright (C) 2012-2017, Fabian Schmidt <crocdialer@googlemail.com>
+//
+// It is distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+
+//  Format.h
+//
+//  small, printf-free formatting of integers and fixed-point decimals
+
+#pragma once
+
+#include <stdint.h>
+
+namespace kinski
+{
+
+/*! all functions write into a caller-provided buffer and return a pointer to the end
+ *  of the output, where a null-terminator was placed. consecutive calls append in O(1):
+ *
+ *  char *ptr = fmt_int(buf, 42);
+ *  *ptr++ = ' ';
+ *  ptr = fmt_fixed(ptr, 0.25f, 3);
+ *
+ *  digits are produced by subtracting powers of ten, no division is involved
+ *  (neither Cortex-M0 nor AVR have a hardware divider).
+ */
+
+//! maximum number of characters written by fmt_int/fmt_uint, excluding the terminator
+#define FMT_INT_MAX_CHARS 11
+
+//! maximum supported precision for fmt_fixed
+#define FMT_MAX_PRECISION 6
+
+namespace detail
+{
+    static const uint32_t g_pow10[10] =
+    {
+        1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL, 10000UL, 1000UL, 100UL,
+        10UL, 1UL
+    };
+
+    //! write the_val with at least the_min_digits digits (zero-padded), no terminator
+    inline char* write_digits(char *the_buf, uint32_t the_val, uint8_t the_min_digits = 1)
+    {
+        uint8_t i = 0;
+        while(i < 9 && the_val < g_pow10[i] && 10 - i > the_min_digits){ i++; }
+
+        for(; i < 10; ++i)
+        {
+            char digit = '0';
+            while(the_val >= g_pow10[i]){ the_val -= g_pow10[i]; digit++; }
+            *the_buf++ = digit;
+        }
+        return the_buf;
+    }
+}
+
+inline char* fmt_uint(char *the_buf, uint32_t the_val)
+{
+    the_buf = detail::write_digits(the_buf, the_val);
+    *the_buf = '\0';
+    return the_buf;
+}
+
+inline char* fmt_int(char *the_buf, int32_t the_val)
+{
+    uint32_t val = the_val;
+    if(the_val < 0){ *the_buf++ = '-'; val = 0UL - val; }
+    return fmt_uint(the_buf, val);
+}
+
+/*! decimal with the_precision fractional digits (0 - FMT_MAX_PRECISION), correctly rounded.
+ *  magnitudes beyond what fits 32bit after scaling are clamped
+ */
+inline char* fmt_fixed(char *the_buf, float the_val, uint8_t the_precision = 3)
+{
+    if(the_precision > FMT_MAX_PRECISION){ the_precision = FMT_MAX_PRECISION; }
+
+    // NaN fails both comparisons, ends up as zero
+    float mag = the_val < 0.f ? -the_val : the_val;
+    float scaled = mag * detail::g_pow10[9 - the_precision] + .5f;
+    uint32_t fixed = scaled >= 4294967040.f ? 4294967040UL : scaled > 0.f ? (uint32_t)scaled : 0;
+
+    // no "-0.000"
+    if(the_val < 0.f && fixed){ *the_buf++ = '-'; }
+
+    // integer-digits followed by the_precision fractional digits, split by the point
+    char digits[12];
+    char *end = detail::write_digits(digits, fixed, the_precision + 1);
+    const char *point = end - the_precision;
+
+    for(const char *ptr = digits; ptr < end; ++ptr)
+    {
+        if(ptr == point){ *the_buf++ = '.'; }
+        *the_buf++ = *ptr;
+    }
+    *the_buf = '\0';
+    return the_buf;
+}
+
+//! append a null-terminated string
+inline char* fmt_str(char *the_buf, const char *the_str)
+{
+    while(*the_str){ *the_buf++ = *the_str++; }
+    *the_buf = '\0';
+    return the_buf;
+}
+
+//! append a single character
+inline char* fmt_char(char *the_buf, char the_char)
+{
+    *the_buf++ = the_char;
+    *the_buf = '\0';
+    return the_buf;
+}
+
+}// namespace
@@ -17,6 +17,8 @@ NetworkHelper* NetworkHelper::s_instance = nullptr;
 // private constructor
 NetworkHelper::NetworkHelper()
 {
+    for(uint8_t i = 0; i < s_max_num_connections; ++i){ m_connections[i].m_slot = i; }
+
 #ifndef NO_WIFI
     m_wifi_status = WL_IDLE_STATUS;
 
@@ -32,12 +34,18 @@ NetworkHelper* NetworkHelper::get()
 }
 
 void NetworkHelper::send_udp_broadcast(const char* the_string, uint16_t the_port)
+{
+    send_udp((const uint8_t*)the_string, strlen(the_string), m_broadcast_ip, the_port);
+}
+
+void NetworkHelper::send_udp(const uint8_t* the_data, size_t the_num_bytes, uint32_t the_ip,
+                             uint16_t the_port)
 {
 #ifndef NO_ETHERNET
     if(m_has_ethernet)
     {
-        m_ethernet_udp.beginPacket(m_broadcast_ip, the_port);
-        m_ethernet_udp.write(the_string);
+        m_ethernet_udp.beginPacket(the_ip, the_port);
+        m_ethernet_udp.write(the_data, the_num_bytes);
         m_ethernet_udp.endPacket();
     }
 #endif
@@ -45,8 +53,8 @@ void NetworkHelper::send_udp_broadcast(const char* the_string, uint16_t the_port
 #ifndef NO_WIFI
     if(m_wifi_status == WL_CONNECTED)
     {
-        m_wifi_udp.beginPacket(m_broadcast_ip, the_port);
-        m_wifi_udp.write(the_string);
+        m_wifi_udp.beginPacket(the_ip, the_port);
+        m_wifi_udp.write(the_data, the_num_bytes);
         m_wifi_udp.endPacket();
     }
 #endif
@@ -55,54 +63,37 @@ void NetworkHelper::send_udp_broadcast(const char* the_string, uint16_t the_port
 size_t NetworkHelper::write(const uint8_t* the_data, size_t the_num_bytes)
 {
     uint32_t num_connections = 0;
-    auto net_clients = connected_clients(&num_connections);
+    auto connections = connected_clients(&num_connections);
     size_t bytes_written = 0;
 
     for(uint32_t i = 0; i < num_connections; ++i)
     {
-         auto ret = net_clients[i]->write(the_data, the_num_bytes);
+         auto ret = connections[i]->write(the_data, the_num_bytes);
          bytes_written = max(bytes_written, ret);
     }
     return bytes_written;
 }
 
-Client** NetworkHelper::connected_clients(uint32_t *the_num_clients)
+Connection** NetworkHelper::connected_clients(uint32_t *the_num_clients)
 {
-    update_connections();
-    uint8_t num_clients = 0;
+    // connections might have been closed on errors since
+    update_connection_list();
 
-#ifndef NO_WIFI
-    if(m_wifi_status == WL_CONNECTED)
-    {
-        for(uint8_t i = 0; i < s_max_num_clients; ++i)
-        {
-            Client* client = m_wifi_clients + i;
+    if(the_num_clients){ *the_num_clients = m_num_open_connections; }
+    return m_open_connections;
+}
 
-            if(client->connected())
-            {
-                m_clients_scratch[num_clients++] = client;
-            }
-        }
-    }
-#endif
+void NetworkHelper::update_connection_list()
+{
+    m_num_open_connections = 0;
 
-#ifndef NO_ETHERNET
-    if(m_has_ethernet)
+    for(uint8_t i = 0; i < s_max_num_connections; ++i)
     {
-        for(int i = 0; i < s_max_num_clients; ++i)
+        if(m_connections[i].connected())
         {
-            Client* client = m_ethernet_clients + i;
-
-            if(client->connected())
-            {
-                m_clients_scratch[num_clients++] = client;
-            }
+            m_open_connections[m_num_open_connections++] = m_connections + i;
         }
     }
-#endif
-
-    if(the_num_clients){ *the_num_clients = num_clients; }
-    return m_clients_scratch;
 }
 
 bool NetworkHelper::setup_ethernet(const uint8_t* the_mac_adress)
@@ -140,49 +131,226 @@ bool NetworkHelper::setup_wifi(const char** the_known_networks, uint8_t the_num_
         Serial.println("WiFi shield not present");
         return false;
     }
+    m_known_networks = the_known_networks;
+    m_num_known_networks = the_num_networks < s_max_num_networks ? the_num_networks :
+                                                                   s_max_num_networks;
+    // WiFi.begin() returns right away, attempts are polled against s_wifi_connect_timeout
+    WiFi.setTimeout(0);
+
+    if(m_wifi_state == WIFI_OFF)
+    {
+        scan_wifi();
+        start_wifi_round();
+        connect_next_wifi();
+    }
+    return true;
+#endif
+    return false;
+}
+
+void NetworkHelper::update_wifi()
+{
+#ifndef NO_WIFI
+    switch(m_wifi_state)
+    {
+        case WIFI_CONNECTED:
+            m_wifi_status = WiFi.status();
+            if(m_wifi_status != WL_CONNECTED){ wifi_disconnected(); }
+            break;
+
+        case WIFI_CONNECTING:
+            m_wifi_status = WiFi.status();
+
+            if(m_wifi_status == WL_CONNECTED){ wifi_connected(m_wifi_candidate_index - 1); }
+            else if(m_wifi_status == WL_CONNECT_FAILED || m_wifi_status == WL_DISCONNECTED ||
+                    millis() - m_wifi_timestamp >= s_wifi_connect_timeout)
+            {
+                // abandon a pending attempt, before starting the next one
+                WiFi.disconnect();
+                connect_next_wifi();
+            }
+            break;
+
+        case WIFI_BACKOFF:
+            if(millis() - m_wifi_timestamp >= m_wifi_backoff)
+            {
+                m_wifi_backoff = 2 * m_wifi_backoff < s_wifi_max_backoff ? 2 * m_wifi_backoff :
+                                                                           s_wifi_max_backoff;
+                start_wifi_round();
+                connect_next_wifi();
+            }
+            break;
+
+        default:
+            break;
+    }
+#endif
+}
+
+void NetworkHelper::scan_wifi()
+{
+#ifndef NO_WIFI
+    // a single scan, known networks in range are ranked by signal strength
+    int num_found = WiFi.scanNetworks();
+    m_wifi_stats.num_scans++;
+
+    uint8_t num_ranked = 0;
 
-    // attempt to connect to WiFi network:
-    if(m_wifi_status != WL_CONNECTED)
+    for(uint8_t i = 0; i < m_num_known_networks; ++i)
     {
-        for(uint32_t i = 0; i < the_num_networks; ++i)
+        wifi_candidate_t candidate = {i, 0, 0};
+        bool found = false;
+
+        for(int j = 0; j < num_found; ++j)
         {
-            Serial.print("Attempting to connect to SSID: ");
-            Serial.println(the_known_networks[2 * i]);
+            if(!strcmp(WiFi.SSID(j), m_known_networks[2 * i]) &&
+               (!found || WiFi.RSSI(j) > candidate.rssi))
+            {
+                candidate.rssi = WiFi.RSSI(j);
+                candidate.channel = WiFi.channel(j);
+                found = true;
+            }
+        }
+        if(!found){ continue; }
 
-            // Connect to WPA/WPA2 network. Change this line if using open or WEP network:
-            m_wifi_status = WiFi.begin(the_known_networks[2 * i],
-                                       the_known_networks[2 * i + 1]);
+        // insert sorted, strongest first
+        uint8_t pos = num_ranked++;
 
-            // wait 3 seconds for connection:
-            delay(3000);
+        for(; pos > 0 && m_wifi_ranking[pos - 1].rssi < candidate.rssi; --pos)
+        {
+            m_wifi_ranking[pos] = m_wifi_ranking[pos - 1];
+        }
+        m_wifi_ranking[pos] = candidate;
+    }
 
-            if(m_wifi_status == WL_CONNECTED){ break; }
+    // the others follow in order, they might be hidden or come into range later
+    for(uint8_t i = 0; i < m_num_known_networks; ++i)
+    {
+        uint8_t j = 0;
+        while(j < num_ranked && m_wifi_ranking[j].network != i){ j++; }
+        if(j == num_ranked){ m_wifi_ranking[num_ranked++] = {i, 0, 0}; }
+    }
+#endif
+}
+
+void NetworkHelper::start_wifi_round()
+{
+#ifndef NO_WIFI
+    m_num_wifi_candidates = m_wifi_candidate_index = 0;
+
+    // chances are the last good network is still there
+    if(m_has_cached_network){ m_wifi_candidates[m_num_wifi_candidates++] = m_cached_network; }
+
+    for(uint8_t i = 0; i < m_num_known_networks; ++i)
+    {
+        if(m_has_cached_network && m_wifi_ranking[i].network == m_cached_network.network)
+        {
+            continue;
         }
+        m_wifi_candidates[m_num_wifi_candidates++] = m_wifi_ranking[i];
     }
-    if(m_wifi_status == WL_CONNECTED)
+#endif
+}
+
+void NetworkHelper::connect_next_wifi()
+{
+#ifndef NO_WIFI
+    if(m_wifi_candidate_index >= m_num_wifi_candidates)
     {
-        // print the received signal strength:
-        long rssi = WiFi.RSSI();
-        Serial.print("signal strength (RSSI): ");
-        Serial.println(rssi);
-
-         m_tcp_server.begin();
-         m_wifi_udp.begin(33334);
-         m_local_ip = m_broadcast_ip = WiFi.localIP();
-         ((char*) &m_broadcast_ip)[3] = 0xFF;
-         return true;
+        m_wifi_state = WIFI_BACKOFF;
+        m_wifi_timestamp = millis();
+        return;
     }
+    uint8_t index = m_wifi_candidate_index++;
+    const char *ssid = m_known_networks[2 * m_wifi_candidates[index].network];
+
+    Serial.print("Attempting to connect to SSID: ");
+    Serial.println(ssid);
+    m_wifi_stats.num_attempts++;
+
+    // Connect to WPA/WPA2 network. Change this line if using open or WEP network.
+    // with a zero timeout this only starts the attempt, update_wifi() polls for the result
+    m_wifi_status = WiFi.begin(ssid, m_known_networks[2 * m_wifi_candidates[index].network + 1]);
+    m_wifi_state = WIFI_CONNECTING;
+    m_wifi_timestamp = millis();
+
+    if(m_wifi_status == WL_CONNECTED){ wifi_connected(index); }
+#endif
+}
+
+void NetworkHelper::wifi_connected(uint8_t the_candidate)
+{
+#ifndef NO_WIFI
+    uint32_t now = millis();
+
+    m_cached_network = m_wifi_candidates[the_candidate];
+    m_has_cached_network = true;
+
+    m_wifi_state = WIFI_CONNECTED;
+    m_wifi_backoff = s_wifi_min_backoff;
+    m_wifi_stats.num_connects++;
+
+    if(m_wifi_stats.num_connects == 1){ m_wifi_stats.boot_to_network = now; }
+    else
+    {
+        uint32_t outage = now - m_wifi_outage_start;
+        m_wifi_stats.last_outage = outage;
+        m_wifi_stats.total_outage += outage;
+        if(outage > m_wifi_stats.max_outage){ m_wifi_stats.max_outage = outage; }
+    }
+
+    // print the received signal strength:
+    long rssi = WiFi.RSSI();
+    Serial.print("signal strength (RSSI): ");
+    Serial.println(rssi);
+    Serial.print("channel: ");
+    Serial.println((int)m_cached_network.channel);
+    Serial.print("connected after ms: ");
+    Serial.println((unsigned long)(m_wifi_stats.num_connects == 1 ? now : m_wifi_stats.last_outage));
+
+    // sockets were closed with the link
+    m_tcp_server.begin();
+    m_wifi_udp.begin(33334);
+
+    for(uint8_t i = 0; i < m_num_wifi_sockets; ++i)
+    {
+        m_wifi_sockets[i].socket->begin(m_wifi_sockets[i].port);
+    }
+    m_local_ip = m_broadcast_ip = WiFi.localIP();
+    ((char*) &m_broadcast_ip)[3] = 0xFF;
+#endif
+}
+
+void NetworkHelper::wifi_disconnected()
+{
+#ifndef NO_WIFI
+    Serial.println("WiFi connection lost");
+    m_wifi_stats.num_outages++;
+    m_wifi_outage_start = millis();
+
+    if(!m_has_ethernet){ m_local_ip = m_broadcast_ip = 0; }
+
+    // clients are gone with the link
+    for(uint8_t i = 0; i < s_max_num_clients; ++i){ m_connections[i].close(); }
+    update_connection_list();
+
+    m_wifi_udp.stop();
+    for(uint8_t i = 0; i < m_num_wifi_sockets; ++i){ m_wifi_sockets[i].socket->stop(); }
+
+    start_wifi_round();
+    connect_next_wifi();
 #endif
-    return false;
 }
 
 void NetworkHelper::set_tcp_listening_port(uint16_t the_port)
 {
 #ifndef NO_WIFI
-    if(m_wifi_status == WL_CONNECTED)
+    if(m_wifi_state != WIFI_OFF)
     {
         m_tcp_server = WiFiServer(the_port);
-        m_tcp_server.begin();
+
+        // otherwise started once connected
+        if(m_wifi_state == WIFI_CONNECTED){ m_tcp_server.begin(); }
     }
     else
 #endif
@@ -197,8 +365,44 @@ void NetworkHelper::set_tcp_listening_port(uint16_t the_port)
     }
 }
 
+UDP* NetworkHelper::create_udp_socket(uint16_t the_port)
+{
+#ifndef NO_ETHERNET
+    if(m_has_ethernet)
+    {
+        auto udp = new EthernetUDP();
+        if(udp->begin(the_port)){ return udp; }
+        delete udp;
+    }
+#endif
+
+#ifndef NO_WIFI
+    if(m_wifi_state != WIFI_OFF && m_num_wifi_sockets < s_max_num_udp_sockets)
+    {
+        auto udp = new WiFiUDP();
+
+        // otherwise opened once connected
+        if(m_wifi_state != WIFI_CONNECTED || udp->begin(the_port))
+        {
+            m_wifi_sockets[m_num_wifi_sockets++] = {udp, the_port};
+            return udp;
+        }
+        delete udp;
+    }
+#endif
+    return nullptr;
+}
+
 void NetworkHelper::update_connections()
 {
+    for(uint8_t i = 0; i < m_num_open_connections; ++i){ m_open_connections[i]->drain(); }
+
+    uint32_t now = millis();
+    if(now - m_last_poll < s_poll_interval){ return; }
+    m_last_poll = now;
+
+    update_wifi();
+
 #ifndef NO_WIFI
     if(m_wifi_status == WL_CONNECTED)
     {
@@ -224,11 +428,13 @@ void NetworkHelper::update_connections()
             {
                 for(int i = 0; i < s_max_num_clients; ++i)
                 {
-                    if(!m_wifi_clients[i] || !m_wifi_clients[i].connected())
+                    if(!m_connections[i].connected())
                     {
                         // TODO: check if this actually works
                         connection.flush();
                         m_wifi_clients[i] = connection;
+                        m_connections[i].reset(m_wifi_clients + i);
+                        m_connections[i].set_drop_policy(m_drop_policy);
                         break;
                     }
                 }
@@ -237,7 +443,10 @@ void NetworkHelper::update_connections()
         // reset dead connections
         for(int i = 0; i < s_max_num_clients; ++i)
         {
-            if(m_wifi_clients[i] && !m_wifi_clients[i].connected()){ m_wifi_clients[i].stop(); }
+            if(m_connections[i].connected() && !m_wifi_clients[i].connected())
+            {
+                m_connections[i].close();
+            }
         }
     }
 #endif
@@ -266,10 +475,14 @@ void NetworkHelper::update_connections()
             {
                 for(int i = 0; i < s_max_num_clients; ++i)
                 {
-                    if(!m_ethernet_clients[i] || !m_ethernet_clients[i].connected())
+                    Connection &c = m_connections[s_num_wifi_slots + i];
+
+                    if(!c.connected())
                     {
                         connection.flush();
                         m_ethernet_clients[i] = connection;
+                        c.reset(m_ethernet_clients + i);
+                        c.set_drop_policy(m_drop_policy);
                         break;
                     }
                 }
@@ -278,11 +491,148 @@ void NetworkHelper::update_connections()
         // reset dead connections
         for(int i = 0; i < s_max_num_clients; ++i)
         {
-            if(m_ethernet_clients[i] && !m_ethernet_clients[i].connected())
+            Connection &c = m_connections[s_num_wifi_slots + i];
+            if(c.connected() && !m_ethernet_clients[i].connected()){ c.close(); }
+        }
+    }
+#endif
+    update_connection_list();
+}
+
+/////////////////////////////// Connection IMPL ///////////////////////////////////////////
+
+void Connection::reset(Client *the_client)
+{
+    if(the_client){ m_session++; }
+    m_client = the_client;
+    m_rx_pos = m_rx_end = 0;
+    m_tx_head = m_tx_tail = 0;
+    m_writes_head = m_writes_tail = 0;
+    m_stats = {};
+}
+
+void Connection::close()
+{
+    if(m_client){ m_client->stop(); }
+    reset(nullptr);
+}
+
+int Connection::available()
+{
+    if(m_rx_pos == m_rx_end && m_client)
+    {
+        int num_bytes = m_client->available();
+
+        if(num_bytes > 0)
+        {
+            if(num_bytes > s_rx_buffer_size){ num_bytes = s_rx_buffer_size; }
+
+            // one burst instead of byte-wise reads
+            int ret = m_client->read(m_rx_buf, num_bytes);
+
+            if(ret <= 0){ close(); }
+            else
             {
-                 m_ethernet_clients[i].stop();
+                m_rx_pos = 0;
+                m_rx_end = ret;
             }
         }
     }
-#endif
+    return m_rx_end - m_rx_pos;
+}
+
+int Connection::read()
+{
+    if(!available()){ return -1; }
+    return m_rx_buf[m_rx_pos++];
+}
+
+size_t Connection::write(const uint8_t* the_data, size_t the_num_bytes)
+{
+    if(!m_client || !the_num_bytes){ return 0; }
+
+    size_t num_free = s_tx_buffer_size - num_queued();
+
+    if(the_num_bytes > num_free)
+    {
+        m_stats.num_overflows++;
+
+        if(m_drop_policy == DROP_CLIENT)
+        {
+            m_stats.bytes_dropped += num_queued() + the_num_bytes;
+            close();
+            return 0;
+        }
+
+        // discard whole writes, oldest first, a partly sent one has to stay
+        while(the_num_bytes <= s_tx_buffer_size && the_num_bytes > num_free && num_writes() &&
+              m_write_starts[m_writes_tail & (s_max_queued_writes - 1)] == m_tx_tail)
+        {
+            m_writes_tail++;
+            uint16_t end = num_writes() ? m_write_starts[m_writes_tail & (s_max_queued_writes - 1)]
+                                        : m_tx_head;
+            m_stats.bytes_dropped += (uint16_t)(end - m_tx_tail);
+            m_tx_tail = end;
+            num_free = s_tx_buffer_size - num_queued();
+        }
+
+        // never a part of a write
+        if(the_num_bytes > num_free)
+        {
+            m_stats.bytes_dropped += the_num_bytes;
+            return 0;
+        }
+    }
+
+    // out of slots, the write is merged with the newest one
+    if(num_writes() < s_max_queued_writes)
+    {
+        m_write_starts[m_writes_head++ & (s_max_queued_writes - 1)] = m_tx_head;
+    }
+
+    // copy, wrapping around the end of the ring-buffer
+    uint16_t pos = m_tx_head & (s_tx_buffer_size - 1);
+    size_t num_first = s_tx_buffer_size - pos;
+    if(num_first > the_num_bytes){ num_first = the_num_bytes; }
+
+    memcpy(m_tx_buf + pos, the_data, num_first);
+    memcpy(m_tx_buf, the_data + num_first, the_num_bytes - num_first);
+    m_tx_head += the_num_bytes;
+
+    m_stats.bytes_queued += the_num_bytes;
+    if(num_queued() > m_stats.max_queued){ m_stats.max_queued = num_queued(); }
+    return the_num_bytes;
+}
+
+size_t Connection::drain()
+{
+    if(!m_client || !num_queued()){ return 0; }
+
+    // contiguous part only, the remainder follows with the next call
+    uint16_t pos = m_tx_tail & (s_tx_buffer_size - 1);
+    size_t num_bytes = s_tx_buffer_size - pos;
+    if(num_bytes > num_queued()){ num_bytes = num_queued(); }
+    if(num_bytes > s_max_drain_bytes){ num_bytes = s_max_drain_bytes; }
+
+    size_t ret = m_client->write(m_tx_buf + pos, num_bytes);
+
+    // the client gave up, e.g. the peer is gone
+    if(ret < num_bytes)
+    {
+        close();
+        return ret;
+    }
+    m_tx_tail += num_bytes;
+    m_stats.bytes_sent += num_bytes;
+
+    // forget writes sent completely, the oldest remaining one might be partly sent
+    if(!num_queued()){ m_writes_tail = m_writes_head; }
+
+    while(num_writes() > 1)
+    {
+        uint16_t next_start = m_write_starts[(m_writes_tail + 1) & (s_max_queued_writes - 1)];
+        if((int16_t)(next_start - m_tx_tail) > 0){ break; }
+        m_writes_tail++;
+    }
+    return num_bytes;
 }
@@ -3,6 +3,8 @@
 // #define NO_ETHERNET
 #define NO_WIFI
 
+#include <Udp.h>
+
 #ifndef NO_ETHERNET
 #include <EthernetServer.h>
 #include <EthernetClient.h>
@@ -16,25 +18,218 @@
 #include <WiFiUdp.h>
 #endif
 
+//! what to do, when a client can't keep up and its transmit-buffer is full
+enum DropPolicy
+{
+    /*! discard whole queued writes, oldest first, to make room. a write already partly sent
+     *  is kept. if the new write still does not fit, or exceeds the buffer, it is dropped whole.
+     *  the receiver only ever misses complete writes, e.g. lines formatted into one write()
+     */
+    DROP_OLDEST,
+
+    //! close the connection
+    DROP_CLIENT
+};
+
+struct connection_stats_t
+{
+    uint32_t bytes_queued;
+    uint32_t bytes_sent;
+    uint32_t bytes_dropped;
+
+    //! number of writes that did not fit the transmit-buffer
+    uint32_t num_overflows;
+
+    //! high-water mark of the transmit-buffer
+    uint16_t max_queued;
+};
+
+//! states of the WiFi-connection, see NetworkHelper::setup_wifi()
+enum WifiState
+{
+    //! not configured or no shield present
+    WIFI_OFF,
+
+    //! an attempt on one of the candidate-networks is pending, polled on every update
+    WIFI_CONNECTING,
+
+    WIFI_CONNECTED,
+
+    //! all candidates failed, waiting before the next round
+    WIFI_BACKOFF
+};
+
+struct wifi_stats_t
+{
+    //! millis() when first connected, 0 until then
+    uint32_t boot_to_network;
+
+    uint32_t num_connects;
+    uint32_t num_attempts;
+    uint32_t num_scans;
+
+    //! connection-losses and their durations in ms, until reconnected
+    uint32_t num_outages;
+    uint32_t last_outage;
+    uint32_t max_outage;
+    uint32_t total_outage;
+};
+
+/*! a TCP-connection with receive- and transmit-buffers.
+ *  incoming data is fetched in bursts instead of byte-wise transfers.
+ *  writes only queue data, the queue is drained in bounded chunks by drain(),
+ *  so a slow client never stalls the caller. read- or write-errors close the connection.
+ *  being a Print, connections can be used wherever Serial is.
+ */
+class Connection : public Print
+{
+public:
+
+    static constexpr uint16_t s_rx_buffer_size = 128;
+
+    //! size of the transmit ring-buffer, must be a power of two
+    static constexpr uint16_t s_tx_buffer_size = 256;
+
+    static_assert(!(s_tx_buffer_size & (s_tx_buffer_size - 1)),
+                  "Connection: transmit-buffer size must be a power of two");
+
+    //! maximum number of bytes handed to the client per drain()
+    static constexpr uint16_t s_max_drain_bytes = 128;
+
+    //! number of write()-boundaries tracked for DROP_OLDEST, must be a power of two.
+    //  beyond that, further writes are merged with the newest one
+    static constexpr uint8_t s_max_queued_writes = 16;
+
+    static_assert(!(s_max_queued_writes & (s_max_queued_writes - 1)),
+                  "Connection: number of queued writes must be a power of two");
+
+    //! number of buffered bytes, refills the buffer from the client if empty
+    int available();
+
+    //! next buffered byte or -1
+    int read();
+
+    //! queue data for the client, returns the number of bytes queued, all or none
+    size_t write(const uint8_t* the_data, size_t the_num_bytes) override;
+
+    size_t write(uint8_t the_byte) override { return write(&the_byte, 1); }
+
+    using Print::write;
+
+    //! send a chunk of queued data, returns the number of bytes sent
+    size_t drain();
+
+    //! number of bytes waiting to be sent
+    uint16_t num_queued() const { return m_tx_head - m_tx_tail; }
+
+    //! false after the connection was closed, e.g. on errors
+    bool connected() const { return m_client; }
+
+    //! stop the client and drop buffered data
+    void close();
+
+    Client* client() const { return m_client; }
+
+    //! index of this connection's slot, see NetworkHelper::s_max_num_connections
+    uint8_t slot() const { return m_slot; }
+
+    /*! incremented whenever a new client takes over the slot.
+     *  per-client state kept by slot has to be reset when this changes
+     */
+    uint32_t session() const { return m_session; }
+
+    DropPolicy drop_policy() const { return m_drop_policy; }
+    void set_drop_policy(DropPolicy the_policy){ m_drop_policy = the_policy; }
+
+    //! counters since the connection was established
+    const connection_stats_t& stats() const { return m_stats; }
+
+private:
+
+    friend class NetworkHelper;
+
+    void reset(Client *the_client);
+
+    //! number of writes with bytes still queued
+    uint8_t num_writes() const { return m_writes_head - m_writes_tail; }
+
+    Client *m_client = nullptr;
+    uint8_t m_slot = 0;
+    uint32_t m_session = 0;
+
+    uint8_t m_rx_buf[s_rx_buffer_size];
+    uint16_t m_rx_pos = 0, m_rx_end = 0;
+
+    // free-running indices into m_tx_buf
+    uint8_t m_tx_buf[s_tx_buffer_size];
+    uint16_t m_tx_head = 0, m_tx_tail = 0;
+
+    // start of each queued write in m_tx_buf, free-running indices into m_write_starts.
+    // the oldest write was partly sent, if its start lies before m_tx_tail
+    uint16_t m_write_starts[s_max_queued_writes];
+    uint8_t m_writes_head = 0, m_writes_tail = 0;
+
+    DropPolicy m_drop_policy = DROP_OLDEST;
+    connection_stats_t m_stats = {};
+};
+
 class NetworkHelper
 {
 public:
 
     static const uint8_t s_default_mac[6];
 
+    //! maximum number of TCP-clients per interface
+    static constexpr uint8_t s_max_num_clients = 7;
+
+    //! connection-slots per interface, only for those compiled in
+#ifndef NO_WIFI
+    static constexpr uint8_t s_num_wifi_slots = s_max_num_clients;
+#else
+    static constexpr uint8_t s_num_wifi_slots = 0;
+#endif
+#ifndef NO_ETHERNET
+    static constexpr uint8_t s_num_ethernet_slots = s_max_num_clients;
+#else
+    static constexpr uint8_t s_num_ethernet_slots = 0;
+#endif
+
+    //! number of connection-slots, wifi first
+    static constexpr uint8_t s_max_num_connections = s_num_wifi_slots + s_num_ethernet_slots;
+
+    static_assert(s_max_num_connections, "NetworkHelper: neither WiFi nor Ethernet enabled");
+
     //! singleton
     static NetworkHelper* get();
 
     //!
     bool setup_ethernet(const uint8_t* the_mac_adress = nullptr);
 
-    //!
+    /*! start connecting to one of the_known_networks (pairs of SSID and key, which must outlive
+     *  the helper). the only scan happens here, it blocks for a few seconds: known networks
+     *  in range are tried strongest first, the others after them, e.g. hidden ones.
+     *  after drop-outs the last good network is tried first, without scanning again.
+     *  failed rounds are retried with exponential backoff.
+     *
+     *  connection-attempts don't block, they are started here and polled by
+     *  update_connections(). returns false if there is no shield, otherwise true,
+     *  even if not yet connected: listening ports and sockets are (re-)opened whenever
+     *  a connection is established
+     */
     bool setup_wifi(const char** the_known_networks, uint8_t the_num_networks);
 
-    //!
-    Client** connected_clients(uint32_t *num_clients = nullptr);
+    WifiState wifi_state() const { return m_wifi_state; }
+
+    //! connection-metrics, e.g. time to the first connection and outages
+    const wifi_stats_t& wifi_stats() const { return m_wifi_stats; }
 
-    //! send data to all connected connected clients
+    /*! currently open connections, as of the last update_connections().
+     *  the list is maintained incrementally, calling this does not involve any transfers
+     *  with the network-controller
+     */
+    Connection** connected_clients(uint32_t *num_clients = nullptr);
+
+    //! queue data for all connected clients
     size_t write(const uint8_t* the_data, size_t the_num_bytes);
 
     //! send a null-terminated c-string to all connected clients
@@ -43,20 +238,72 @@ public:
         return write((const uint8_t*)the_string, strlen(the_string));
     }
 
-    //! update connections for all interfaces
+    //! drain transmit-buffers, accept new and reap dead connections
+    //  and advance the WiFi-connection (at most every s_poll_interval ms) for all interfaces.
     //  needs to be called periodically
     void update_connections();
 
+    //! drop policy for new connections
+    void set_drop_policy(DropPolicy the_policy){ m_drop_policy = the_policy; }
+
     //!
     void send_udp_broadcast(const char* the_string, uint16_t the_port);
 
+    //! send a single datagram to a unicast- or multicast-address
+    void send_udp(const uint8_t* the_data, size_t the_num_bytes, uint32_t the_ip,
+                  uint16_t the_port);
+
     //!
     void set_tcp_listening_port(uint16_t the_port);
 
+    //! address of the active interface, 0 while not connected
+    uint32_t local_ip() const { return m_local_ip; }
+
+    //! broadcast-address of the active interface
+    uint32_t broadcast_ip() const { return m_broadcast_ip; }
+
+    /*! create a UDP-socket, listening on the_port of the active interface.
+     *  on WiFi, sockets are opened once connected and re-opened after drop-outs.
+     *  returns nullptr if no interface is set up or no socket is left.
+     *  sockets are owned by the helper
+     */
+    UDP* create_udp_socket(uint16_t the_port);
+
 private:
 
     static NetworkHelper* s_instance;
-    static constexpr uint8_t s_max_num_clients = 7;
+
+    //! minimum interval in ms between polls for new connections
+    static constexpr uint32_t s_poll_interval = 100;
+
+    //! deadline for a single WiFi connection-attempt, in ms
+    static constexpr uint32_t s_wifi_connect_timeout = 5000;
+
+    //! backoff between failed rounds of connection-attempts, in ms
+    static constexpr uint32_t s_wifi_min_backoff = 1000;
+    static constexpr uint32_t s_wifi_max_backoff = 60000;
+
+    static constexpr uint8_t s_max_num_networks = 8;
+    static constexpr uint8_t s_max_num_udp_sockets = 4;
+
+    //! rebuild the list of open connections
+    void update_connection_list();
+
+    //! advance the WiFi state-machine
+    void update_wifi();
+
+    //! rank the known networks by signal strength, blocks for the duration of a scan
+    void scan_wifi();
+
+    //! fill the candidate-list, the last good network first, then the ranked ones
+    void start_wifi_round();
+
+    //! start an attempt on the next candidate, back off if there is none left
+    void connect_next_wifi();
+
+    void wifi_connected(uint8_t the_candidate);
+
+    void wifi_disconnected();
 
     NetworkHelper();
 
@@ -66,10 +313,10 @@ private:
     int m_wifi_status;
 
     // local ip address
-    uint32_t m_local_ip;
+    uint32_t m_local_ip = 0;
 
     // udp-broadcast
-    uint32_t m_broadcast_ip;
+    uint32_t m_broadcast_ip = 0;
 
 #ifndef NO_WIFI
     // TCP server
@@ -80,16 +327,62 @@ private:
 
     // UDP util
     WiFiUDP m_wifi_udp;
+
+    // sockets from create_udp_socket(), re-opened on every connect
+    struct udp_socket_t
+    {
+        WiFiUDP *socket;
+        uint16_t port;
+    };
+    udp_socket_t m_wifi_sockets[s_max_num_udp_sockets];
+    uint8_t m_num_wifi_sockets = 0;
 #endif
 
+    // known networks, as pairs of SSID and key
+    const char** m_known_networks = nullptr;
+    uint8_t m_num_known_networks = 0;
+
+    // known networks, as ranked by the scan in setup_wifi(). those not found have no channel
+    struct wifi_candidate_t
+    {
+        uint8_t network;
+        uint8_t channel;
+        int32_t rssi;
+    };
+    wifi_candidate_t m_wifi_ranking[s_max_num_networks];
+
+    // networks to try in the current round, the pending attempt is at m_wifi_candidate_index - 1
+    wifi_candidate_t m_wifi_candidates[s_max_num_networks];
+    uint8_t m_num_wifi_candidates = 0, m_wifi_candidate_index = 0;
+
+    // last good network, tried first after drop-outs.
+    // WiFi101 can't be pinned to a BSSID or channel, the latter is only logged
+    wifi_candidate_t m_cached_network;
+    bool m_has_cached_network = false;
+
+    WifiState m_wifi_state = WIFI_OFF;
+
+    // start of the pending attempt or of the backoff, in ms
+    uint32_t m_wifi_timestamp = 0;
+    uint32_t m_wifi_outage_start = 0, m_wifi_backoff = s_wifi_min_backoff;
+    wifi_stats_t m_wifi_stats = {};
+
 #ifndef NO_ETHERNET
     ////// Ethernet assets ///////////
     EthernetServer m_ethernet_tcp{33333};
     EthernetUDP m_ethernet_udp;
     EthernetClient m_ethernet_clients[s_max_num_clients];
 #endif
-    // scratch space for refs to active TCP connections
-    Client* m_clients_scratch[2 * s_max_num_clients];
+    // one connection per client-slot, wifi first
+    Connection m_connections[s_max_num_connections];
+
+    // open connections
+    Connection* m_open_connections[s_max_num_connections];
+    uint8_t m_num_open_connections = 0;
+
+    uint32_t m_last_poll = 0;
+
+    DropPolicy m_drop_policy = DROP_OLDEST;
 
     bool m_has_ethernet = false;
 };
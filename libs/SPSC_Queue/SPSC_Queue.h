@@ -0,0 +1,109 @@
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+//
+// Copyright (C) 2012-2017, Fabian Schmidt <crocdialer@googlemail.com>
+//
+// It is distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+
+//  SPSC_Queue.h
+//
+//  wait-free single-producer/single-consumer ring buffer
+
+#pragma once
+
+#include <stdint.h>
+
+namespace kinski
+{
+
+/*! fixed-size, wait-free queue for exactly one producer and one consumer,
+ *  e.g. an ISR pushing samples or events and loop() draining them in batches.
+ *  neither side ever masks interrupts or blocks.
+ *
+ *  head and tail are free-running counters, each written by one side only.
+ *  the element-data is published with release-stores and picked up with acquire-loads,
+ *  on Cortex-M this results in plain loads/stores plus DMB where required.
+ */
+template <typename T, uint32_t N>
+class SPSC_Queue
+{
+    static_assert(N && !(N & (N - 1)), "SPSC_Queue: capacity must be a power of two");
+
+public:
+
+    static constexpr uint32_t capacity(){ return N; }
+
+    //! producer side: add an element. returns false (and counts a drop) if the queue is full
+    bool push(const T &the_value)
+    {
+        uint32_t head = m_head;
+
+        if(head - load_acquire(&m_tail) >= N)
+        {
+            // read from the consumer-side as well
+            store_release(&m_num_dropped, m_num_dropped + 1);
+            return false;
+        }
+        m_data[head & s_mask] = the_value;
+        store_release(&m_head, head + 1);
+        return true;
+    }
+
+    //! consumer side: remove the oldest element. returns false if the queue is empty
+    bool pop(T &the_value)
+    {
+        uint32_t tail = m_tail;
+        if(load_acquire(&m_head) == tail){ return false; }
+
+        the_value = m_data[tail & s_mask];
+        store_release(&m_tail, tail + 1);
+        return true;
+    }
+
+    //! consumer side: remove up to the_max_num elements at once, returns the number copied
+    uint32_t pop(T *the_dst, uint32_t the_max_num)
+    {
+        uint32_t tail = m_tail;
+        uint32_t num = load_acquire(&m_head) - tail;
+        num = num < the_max_num ? num : the_max_num;
+
+        for(uint32_t i = 0; i < num; ++i){ the_dst[i] = m_data[(tail + i) & s_mask]; }
+        store_release(&m_tail, tail + num);
+        return num;
+    }
+
+    //! number of queued elements, a snapshot when called from either side
+    uint32_t size() const { return load_acquire(&m_head) - load_acquire(&m_tail); }
+
+    bool empty() const { return !size(); }
+
+    //! number of elements rejected by push() because the queue was full
+    uint32_t num_dropped() const { return load_acquire(&m_num_dropped); }
+
+private:
+
+    static constexpr uint32_t s_mask = N - 1;
+
+    static inline uint32_t load_acquire(const uint32_t *the_ptr)
+    {
+        return __atomic_load_n(the_ptr, __ATOMIC_ACQUIRE);
+    }
+
+    static inline void store_release(uint32_t *the_ptr, uint32_t the_value)
+    {
+        __atomic_store_n(the_ptr, the_value, __ATOMIC_RELEASE);
+    }
+
+    T m_data[N];
+
+    // written by producer only
+    uint32_t m_head = 0;
+    uint32_t m_num_dropped = 0;
+
+    // written by consumer only
+    uint32_t m_tail = 0;
+};
+
+}// namespace
@@ -0,0 +1,147 @@
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+//
+// Copyright (C) 2012-2017, Fabian Schmidt <crocdialer@googlemail.com>
+//
+// It is distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+
+//  SampleStats.h
+//
+//  single-pass block statistics for audio/ADC sample buffers
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+namespace kinski
+{
+
+/*! accumulator types per sample type.
+ *  sums must not overflow for reasonable block sizes (<= 64k samples)
+ */
+template <typename T> struct sample_traits;
+
+template <> struct sample_traits<int16_t>
+{
+    using sum_t = int32_t;
+    using sum_sq_t = uint64_t;
+    static constexpr int16_t min_val = INT16_MIN, max_val = INT16_MAX;
+};
+
+template <> struct sample_traits<uint16_t>
+{
+    using sum_t = uint32_t;
+    using sum_sq_t = uint64_t;
+    static constexpr uint16_t min_val = 0, max_val = UINT16_MAX;
+};
+
+template <> struct sample_traits<int32_t>
+{
+    using sum_t = int64_t;
+    using sum_sq_t = float;
+    static constexpr int32_t min_val = INT32_MIN, max_val = INT32_MAX;
+};
+
+template <> struct sample_traits<float>
+{
+    using sum_t = float;
+    using sum_sq_t = float;
+    static constexpr float min_val = -INFINITY, max_val = INFINITY;
+};
+
+template <typename T> struct sample_stats_t
+{
+    using sum_t = typename sample_traits<T>::sum_t;
+    using sum_sq_t = typename sample_traits<T>::sum_sq_t;
+
+    T min = sample_traits<T>::max_val;
+    T max = sample_traits<T>::min_val;
+    sum_t sum = 0;
+    sum_sq_t sum_sq = 0;
+    uint32_t num_samples = 0;
+    uint32_t zero_crossings = 0;
+
+    inline float mean() const { return num_samples ? (float)sum / num_samples : 0.f; }
+
+    inline float rms() const { return num_samples ? sqrtf((float)sum_sq / num_samples) : 0.f; }
+
+    //! population variance, E[x²] - E[x]²
+    inline float variance() const
+    {
+        float m = mean();
+        return num_samples ? (float)sum_sq / num_samples - m * m : 0.f;
+    }
+
+    inline float peak_to_peak() const { return num_samples ? (float)max - (float)min : 0.f; }
+};
+
+/*! compute min, max, sum, sum-of-squares and zero-crossings
+ *  for a block of samples in a single pass.
+ *  zero-crossings are counted as sign changes between consecutive samples,
+ *  the sign of <the_prev_sample> allows continuation across block boundaries.
+ */
+template <typename T>
+sample_stats_t<T> compute_sample_stats(const T *the_samples, size_t the_num_samples,
+                                       T the_prev_sample = T(0))
+{
+    using sum_t = typename sample_traits<T>::sum_t;
+    using sum_sq_t = typename sample_traits<T>::sum_sq_t;
+
+    sample_stats_t<T> ret;
+    if(!the_samples || !the_num_samples){ return ret; }
+
+    T min_val = ret.min, max_val = ret.max;
+    sum_t sum = 0;
+    sum_sq_t sum_sq = 0;
+    uint32_t crossings = 0;
+    bool prev_neg = the_prev_sample < T(0);
+
+    const T *ptr = the_samples, *end = the_samples + (the_num_samples & ~size_t(3));
+
+    // unrolled by 4
+    for(; ptr < end; ptr += 4)
+    {
+        T s0 = ptr[0], s1 = ptr[1], s2 = ptr[2], s3 = ptr[3];
+
+        T lo = s0 < s1 ? s0 : s1, hi = s0 < s1 ? s1 : s0;
+        T lo2 = s2 < s3 ? s2 : s3, hi2 = s2 < s3 ? s3 : s2;
+        lo = lo < lo2 ? lo : lo2;
+        hi = hi < hi2 ? hi2 : hi;
+        min_val = lo < min_val ? lo : min_val;
+        max_val = hi > max_val ? hi : max_val;
+
+        sum += (sum_t)s0 + (sum_t)s1 + (sum_t)s2 + (sum_t)s3;
+        sum_sq += (sum_sq_t)((sum_t)s0 * s0) + (sum_sq_t)((sum_t)s1 * s1) +
+                  (sum_sq_t)((sum_t)s2 * s2) + (sum_sq_t)((sum_t)s3 * s3);
+
+        bool n0 = s0 < T(0), n1 = s1 < T(0), n2 = s2 < T(0), n3 = s3 < T(0);
+        crossings += (n0 != prev_neg) + (n1 != n0) + (n2 != n1) + (n3 != n2);
+        prev_neg = n3;
+    }
+
+    // remainder
+    for(end = the_samples + the_num_samples; ptr < end; ++ptr)
+    {
+        T s = *ptr;
+        min_val = s < min_val ? s : min_val;
+        max_val = s > max_val ? s : max_val;
+        sum += s;
+        sum_sq += (sum_sq_t)((sum_t)s * s);
+        bool n = s < T(0);
+        crossings += n != prev_neg;
+        prev_neg = n;
+    }
+    ret.min = min_val;
+    ret.max = max_val;
+    ret.sum = sum;
+    ret.sum_sq = sum_sq;
+    ret.num_samples = the_num_samples;
+    ret.zero_crossings = crossings;
+    return ret;
+}
+
+}// namespace
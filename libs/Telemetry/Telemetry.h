@@ -0,0 +1,93 @@
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+//
+// Copyright (C) 2012-2017, Fabian Schmidt <crocdialer@googlemail.com>
+//
+// It is distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+
+//  Telemetry.h
+//
+//  compact binary packets for streaming sensor-values
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TELEMETRY_MAGIC_0 'K'
+#define TELEMETRY_MAGIC_1 'T'
+#define TELEMETRY_VERSION 1
+
+namespace kinski
+{
+
+/*! fixed-layout telemetry packet, sized for exactly one datagram.
+ *
+ *  | magic (2) | version (1) | num_channels (1) | sequence (4) | timestamp (4) | values (2 * N) |
+ *
+ *  multi-byte fields are little-endian. the timestamp is in microseconds,
+ *  the sequence number increments per packet, so receivers can tell losses from reordering.
+ *  the host-side decoder lives in cap_sense_mpr/telemetry_receiver.py
+ */
+template <uint8_t N> class TelemetryPacket
+{
+public:
+
+    static constexpr uint8_t s_header_size = 12;
+
+    TelemetryPacket()
+    {
+        m_data[0] = TELEMETRY_MAGIC_0;
+        m_data[1] = TELEMETRY_MAGIC_1;
+        m_data[2] = TELEMETRY_VERSION;
+        m_data[3] = N;
+    }
+
+    //! raw 16bit value for the_channel
+    inline void set_value(uint8_t the_channel, uint16_t the_value)
+    {
+        write_u16(m_data + s_header_size + 2 * the_channel, the_value);
+    }
+
+    //! normalized value for the_channel, clamped to [0, 1] and scaled to 16bit
+    inline void set_value(uint8_t the_channel, float the_value)
+    {
+        if(the_value < 0.f){ the_value = 0.f; }
+        else if(the_value > 1.f){ the_value = 1.f; }
+        set_value(the_channel, (uint16_t)(the_value * 65535.f + .5f));
+    }
+
+    //! stamp the header with the next sequence number and the_timestamp, before sending
+    inline void stamp(uint32_t the_timestamp)
+    {
+        write_u32(m_data + 4, m_sequence++);
+        write_u32(m_data + 8, the_timestamp);
+    }
+
+    const uint8_t* data() const { return m_data; }
+
+    constexpr size_t size() const { return sizeof(m_data); }
+
+    uint32_t sequence() const { return m_sequence; }
+
+private:
+
+    static inline void write_u16(uint8_t *the_ptr, uint16_t the_value)
+    {
+        the_ptr[0] = the_value & 0xFF;
+        the_ptr[1] = the_value >> 8;
+    }
+
+    static inline void write_u32(uint8_t *the_ptr, uint32_t the_value)
+    {
+        write_u16(the_ptr, the_value & 0xFFFF);
+        write_u16(the_ptr + 2, the_value >> 16);
+    }
+
+    uint8_t m_data[s_header_size + 2 * N];
+    uint32_t m_sequence = 0;
+};
+
+}// namespace
@@ -0,0 +1,339 @@
+#include <string.h>
+#include "TimeSync.h"
+
+namespace kinski
+{
+
+namespace
+{
+    // | magic (2) | version (1) | type (1) | payload |, multi-byte fields are little-endian
+    constexpr uint8_t TIMESYNC_MAGIC_0 = 'K';
+    constexpr uint8_t TIMESYNC_MAGIC_1 = 'S';
+    constexpr uint8_t TIMESYNC_VERSION = 1;
+    constexpr uint8_t HEADER_SIZE = 4;
+
+    enum PacketType : uint8_t
+    {
+        // | flags (1) | device-id (up to s_max_id_length) |
+        TYPE_ANNOUNCE = 1,
+
+        // | t1 (8) |
+        TYPE_REQUEST = 2,
+
+        // | t1 (8) | t2 (8) | t3 (8) |
+        TYPE_RESPONSE = 3
+    };
+    constexpr uint8_t FLAG_SYNCED = 1 << 0;
+
+    // share of the offset-error corrected per sample
+    constexpr float g_phase_gain = .5f;
+
+    // drift is measured across samples at least this far apart (us), and smoothed
+    constexpr uint32_t g_drift_interval = 32000000;
+    constexpr float g_drift_gain = .5f;
+
+    // crystals are good to about 50ppm, anything beyond is noise
+    constexpr float g_max_drift = 500e-6f;
+
+    inline void write_u64(uint8_t *the_ptr, uint64_t the_value)
+    {
+        for(uint8_t i = 0; i < 8; ++i){ the_ptr[i] = (the_value >> (8 * i)) & 0xFF; }
+    }
+
+    inline uint64_t read_u64(const uint8_t *the_ptr)
+    {
+        uint64_t ret = 0;
+        for(uint8_t i = 0; i < 8; ++i){ ret |= (uint64_t)the_ptr[i] << (8 * i); }
+        return ret;
+    }
+}
+
+TimeSync::TimeSync(const char *the_device_id)
+{
+    strncpy(m_device_id, the_device_id, s_max_id_length);
+    m_device_id[s_max_id_length] = '\0';
+}
+
+void TimeSync::set_addresses(uint32_t the_local_ip, uint32_t the_broadcast_ip)
+{
+    m_local_ip = the_local_ip;
+    m_broadcast_ip = the_broadcast_ip;
+}
+
+uint64_t TimeSync::local_time(uint32_t the_now) const
+{
+    if(!m_has_clock)
+    {
+        m_has_clock = true;
+        m_last_now = the_now;
+        m_local_time = the_now;
+    }
+    int32_t diff = the_now - m_last_now;
+
+    // slightly older timestamps are fine, e.g. taken before a poll
+    if(diff <= 0){ return m_local_time + diff; }
+
+    m_last_now = the_now;
+    m_local_time += diff;
+    return m_local_time;
+}
+
+uint64_t TimeSync::global_micros(uint32_t the_now) const
+{
+    uint64_t local = local_time(the_now);
+    return local + offset_at(local);
+}
+
+size_t TimeSync::process(const uint8_t *the_data, size_t the_num_bytes, uint32_t the_ip,
+                         uint32_t the_now, uint8_t *the_reply)
+{
+    if(the_num_bytes < HEADER_SIZE || the_data[0] != TIMESYNC_MAGIC_0 ||
+       the_data[1] != TIMESYNC_MAGIC_1 || the_data[2] != TIMESYNC_VERSION)
+    {
+        return 0;
+    }
+
+    // our own broadcasts
+    if(the_ip == m_local_ip){ return 0; }
+
+    uint64_t local = local_time(the_now);
+
+    switch(the_data[3])
+    {
+        case TYPE_ANNOUNCE:
+            receive_announce(the_data + HEADER_SIZE, the_num_bytes - HEADER_SIZE, the_ip, the_now);
+            break;
+
+        case TYPE_REQUEST:
+        {
+            if(the_num_bytes < HEADER_SIZE + 8 || !m_synced){ return 0; }
+
+            // the_reply may alias the_data, read before writing
+            uint64_t t1 = read_u64(the_data + HEADER_SIZE);
+            uint64_t t2 = local + offset_at(local);
+
+            size_t pos = write_header(the_reply, TYPE_RESPONSE);
+            write_u64(the_reply + pos, t1);
+            write_u64(the_reply + pos + 8, t2);
+
+            // processing is short enough to send t2 as t3
+            write_u64(the_reply + pos + 16, t2);
+            m_num_requests++;
+            return pos + 24;
+        }
+
+        case TYPE_RESPONSE:
+            if(the_num_bytes < HEADER_SIZE + 24 || the_ip != m_master_ip){ return 0; }
+            receive_response(the_data + HEADER_SIZE, local);
+            break;
+
+        default:
+            break;
+    }
+    return 0;
+}
+
+size_t TimeSync::update(uint32_t the_now, uint8_t *the_out, uint32_t *the_ip)
+{
+    // no interface up
+    if(!m_local_ip){ return 0; }
+
+    uint64_t local = local_time(the_now);
+
+    if(!m_started)
+    {
+        m_started = true;
+        m_start_time = local;
+    }
+    elect_master(the_now, local);
+
+    // announce periodically and right after becoming synced
+    if(!m_has_announced || m_announced_synced != m_synced ||
+       local - m_last_announce >= s_announce_interval)
+    {
+        m_has_announced = true;
+        m_announced_synced = m_synced;
+        m_last_announce = local;
+
+        size_t pos = write_header(the_out, TYPE_ANNOUNCE);
+        the_out[pos++] = m_synced ? FLAG_SYNCED : 0;
+
+        size_t id_length = strlen(m_device_id);
+        memcpy(the_out + pos, m_device_id, id_length);
+        *the_ip = m_broadcast_ip;
+        return pos + id_length;
+    }
+
+    if(m_master_ip && m_master_ip != m_local_ip)
+    {
+        uint32_t interval = m_num_samples < s_num_samples ? s_fast_request_interval :
+                                                            s_request_interval;
+        if(local - m_last_request >= interval)
+        {
+            // an unanswered request is superseded
+            m_last_request = m_pending_request = local;
+
+            size_t pos = write_header(the_out, TYPE_REQUEST);
+            write_u64(the_out + pos, local);
+            *the_ip = m_master_ip;
+            return pos + 8;
+        }
+    }
+    return 0;
+}
+
+void TimeSync::receive_announce(const uint8_t *the_data, size_t the_num_bytes, uint32_t the_ip,
+                                uint32_t the_now)
+{
+    if(!the_num_bytes){ return; }
+    bool synced = the_data[0] & FLAG_SYNCED;
+
+    for(uint8_t i = 0; i < m_num_peers; ++i)
+    {
+        if(m_peers[i].ip == the_ip)
+        {
+            m_peers[i].last_seen = the_now;
+            m_peers[i].synced = synced;
+            return;
+        }
+    }
+    if(m_num_peers < s_max_num_peers){ m_peers[m_num_peers++] = {the_ip, the_now, synced}; }
+}
+
+void TimeSync::receive_response(const uint8_t *the_data, uint64_t the_local_time)
+{
+    uint64_t t1 = read_u64(the_data), t2 = read_u64(the_data + 8), t3 = read_u64(the_data + 16);
+    uint64_t t4 = the_local_time;
+
+    // duplicated, or answering a superseded request
+    if(!m_pending_request || t1 != m_pending_request)
+    {
+        m_num_rejected++;
+        return;
+    }
+    m_pending_request = 0;
+    m_num_responses++;
+
+    int64_t rtt = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+    if(rtt < 0){ rtt = 0; }
+
+    if(rtt > s_max_rtt)
+    {
+        m_num_rejected++;
+        return;
+    }
+    int64_t offset = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+
+    m_samples[m_sample_index] = {offset, (uint32_t)rtt, t4};
+    m_sample_index = (m_sample_index + 1) % s_num_samples;
+    if(m_num_samples < s_num_samples){ m_num_samples++; }
+
+    filter_samples();
+}
+
+void TimeSync::filter_samples()
+{
+    const sample_t *best = m_samples;
+
+    for(uint8_t i = 1; i < m_num_samples; ++i)
+    {
+        if(m_samples[i].rtt < best->rtt){ best = m_samples + i; }
+    }
+
+    // using a sample twice would count its error twice
+    if(m_synced && best->time <= m_last_update){ return; }
+    discipline(*best);
+}
+
+void TimeSync::discipline(const sample_t &the_sample)
+{
+    int64_t current = offset_at(the_sample.time);
+    int64_t error = the_sample.offset - current;
+
+    m_rtt = the_sample.rtt;
+    m_last_update = the_sample.time;
+
+    if(!m_synced || error > (int64_t)s_step_threshold || error < -(int64_t)s_step_threshold)
+    {
+        m_offset = the_sample.offset;
+        m_reference = the_sample.time;
+        m_drift_anchor = the_sample;
+        m_synced = true;
+        m_num_steps++;
+        return;
+    }
+
+    // slew the phase, rebased to the sample
+    m_offset = current + (int64_t)(g_phase_gain * error);
+    m_reference = the_sample.time;
+
+    // measured offsets drift apart linearly, the slope is our frequency-error.
+    // single samples are too noisy for this, a long baseline averages them out
+    if(!m_drift_anchor.time){ m_drift_anchor = the_sample; }
+    uint64_t dt = the_sample.time - m_drift_anchor.time;
+
+    if(dt >= g_drift_interval)
+    {
+        float drift = (float)(the_sample.offset - m_drift_anchor.offset) / dt;
+        m_drift += g_drift_gain * (drift - m_drift);
+
+        if(m_drift > g_max_drift){ m_drift = g_max_drift; }
+        else if(m_drift < -g_max_drift){ m_drift = -g_max_drift; }
+        m_drift_anchor = the_sample;
+    }
+}
+
+void TimeSync::elect_master(uint32_t the_now, uint64_t the_local_time)
+{
+    for(uint8_t i = 0; i < m_num_peers;)
+    {
+        if(the_now - m_peers[i].last_seen > s_peer_timeout){ m_peers[i] = m_peers[--m_num_peers]; }
+        else{ i++; }
+    }
+
+    // nobody to synchronise to, after listening for a while
+    if(!m_synced && the_local_time - m_start_time >= s_listen_time)
+    {
+        bool lowest = true;
+
+        for(uint8_t i = 0; i < m_num_peers; ++i)
+        {
+            if(m_peers[i].synced || m_peers[i].ip < m_local_ip){ lowest = false; }
+        }
+
+        // start a timebase on our local clock
+        if(lowest)
+        {
+            m_offset = 0;
+            m_reference = m_last_update = the_local_time;
+            m_synced = true;
+        }
+    }
+
+    uint32_t master = m_synced ? m_local_ip : 0;
+
+    for(uint8_t i = 0; i < m_num_peers; ++i)
+    {
+        if(m_peers[i].synced && (!master || m_peers[i].ip < master)){ master = m_peers[i].ip; }
+    }
+
+    // samples against another clock are worthless
+    if(master != m_master_ip)
+    {
+        m_master_ip = master;
+        m_num_samples = m_sample_index = 0;
+        m_pending_request = 0;
+        m_drift_anchor = {};
+    }
+}
+
+size_t TimeSync::write_header(uint8_t *the_out, uint8_t the_type) const
+{
+    the_out[0] = TIMESYNC_MAGIC_0;
+    the_out[1] = TIMESYNC_MAGIC_1;
+    the_out[2] = TIMESYNC_VERSION;
+    the_out[3] = the_type;
+    return HEADER_SIZE;
+}
+
+}// namespace
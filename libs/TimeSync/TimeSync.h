@@ -0,0 +1,252 @@
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+//
+// Copyright (C) 2012-2017, Fabian Schmidt <crocdialer@googlemail.com>
+//
+// It is distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+
+//  TimeSync.h
+//
+//  UDP device-discovery and clock-synchronisation between nodes
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TIMESYNC_PORT 55557
+
+namespace kinski
+{
+
+/*! discovers other nodes and maintains a timebase shared by all of them.
+ *
+ *  every node broadcasts an announcement (device-id and sync-state) every s_announce_interval.
+ *  the synced node with the lowest ip-address is the master, all others synchronise to it,
+ *  using NTP-style request/response exchanges:
+ *
+ *  offset = ((t2 - t1) + (t3 - t4)) / 2, rtt = (t4 - t1) - (t3 - t2)
+ *
+ *  of the last s_num_samples exchanges, only the one with the lowest round-trip is used,
+ *  it suffers least from queueing-delays. small errors are slewed, large ones (e.g. a new master)
+ *  are stepped. the drift of the local clock is measured across samples far apart and
+ *  extrapolated between them.
+ *
+ *  the master serves its own global time, so a newly elected master continues the timebase.
+ *  if nobody is synced after s_listen_time, the node with the lowest address starts one.
+ *
+ *  all times are in microseconds, as returned by micros(). it wraps, internally 64bit are used.
+ */
+class TimeSync
+{
+public:
+
+    static constexpr uint8_t s_max_num_peers = 64;
+
+    //! interval between announcements
+    static constexpr uint32_t s_announce_interval = 2000000;
+
+    //! peers are forgotten, if they did not announce themselves for this long
+    static constexpr uint32_t s_peer_timeout = 3 * s_announce_interval;
+
+    //! time to wait for synced peers after startup, before starting a timebase
+    static constexpr uint32_t s_listen_time = 5000000;
+
+    //! interval between sync-requests, faster until the sample-window is filled
+    static constexpr uint32_t s_request_interval = 1000000;
+    static constexpr uint32_t s_fast_request_interval = 250000;
+
+    //! size of the sample-window for the minimum-rtt filter
+    static constexpr uint8_t s_num_samples = 8;
+
+    //! exchanges with longer round-trips are discarded
+    static constexpr uint32_t s_max_rtt = 50000;
+
+    //! offset-errors beyond this are stepped instead of slewed
+    static constexpr uint32_t s_step_threshold = 10000;
+
+    //! maximum length of device-ids in announcements
+    static constexpr uint8_t s_max_id_length = 31;
+
+    struct peer_t
+    {
+        uint32_t ip;
+        uint32_t last_seen;
+        bool synced;
+    };
+
+    TimeSync(const char *the_device_id = "");
+
+    //! addresses of the active interface, see NetworkHelper::local_ip() / broadcast_ip()
+    void set_addresses(uint32_t the_local_ip, uint32_t the_broadcast_ip);
+
+    /*! process all pending packets on the_socket (an Arduino UDP-object bound to TIMESYNC_PORT)
+     *  and send announcements and requests when due. needs to be called periodically,
+     *  with a fresh micros()-timestamp, since it is used for the exchanges
+     */
+    template <typename T> void poll(T &the_socket, uint32_t the_now);
+
+    //! true once a timebase has been established, either as master or from one
+    bool synced() const { return m_synced; }
+
+    bool is_master() const { return m_synced && m_master_ip == m_local_ip; }
+
+    //! address of the current master, 0 if there is none
+    uint32_t master_ip() const { return m_master_ip; }
+
+    //! global time in microseconds, for a local micros() timestamp
+    uint64_t global_micros(uint32_t the_now) const;
+
+    //! global time in milliseconds, for a local micros() timestamp
+    uint32_t global_millis(uint32_t the_now) const
+    {
+        return global_micros(the_now) / 1000;
+    }
+
+    //! current offset global - local in microseconds
+    int64_t offset(uint32_t the_now) const { return offset_at(local_time(the_now)); }
+
+    //! round-trip of the last applied sample
+    uint32_t rtt() const { return m_rtt; }
+
+    //! estimated frequency-error of the local clock, relative to the master
+    float drift() const { return m_drift; }
+
+    uint8_t num_peers() const { return m_num_peers; }
+
+    const peer_t& peer(uint8_t the_index) const { return m_peers[the_index]; }
+
+    //! number of answered and received sync-responses
+    uint32_t num_requests() const { return m_num_requests; }
+    uint32_t num_responses() const { return m_num_responses; }
+
+    //! number of responses discarded as stale or for long round-trips
+    uint32_t num_rejected() const { return m_num_rejected; }
+
+    //! number of times the clock was stepped
+    uint32_t num_steps() const { return m_num_steps; }
+
+    /*! process a single packet from the_ip, received at the_now.
+     *  if a reply is due, it is written to the_reply and its size returned
+     */
+    size_t process(const uint8_t *the_data, size_t the_num_bytes, uint32_t the_ip,
+                   uint32_t the_now, uint8_t *the_reply);
+
+    /*! housekeeping, timeouts and elections. if a packet is due, it is written to the_out
+     *  and its size returned, the_ip is set to its destination
+     */
+    size_t update(uint32_t the_now, uint8_t *the_out, uint32_t *the_ip);
+
+    //! size of the largest packet
+    static constexpr size_t s_max_packet_size = 4 + 1 + s_max_id_length;
+
+private:
+
+    struct sample_t
+    {
+        int64_t offset;
+        uint32_t rtt;
+        uint64_t time;
+    };
+
+    //! extend a micros()-timestamp to 64bit, relative to the newest one seen so far
+    uint64_t local_time(uint32_t the_now) const;
+
+    int64_t offset_at(uint64_t the_local_time) const
+    {
+        return m_offset + (int64_t)(m_drift * (int64_t)(the_local_time - m_reference));
+    }
+
+    void receive_announce(const uint8_t *the_data, size_t the_num_bytes, uint32_t the_ip,
+                          uint32_t the_now);
+
+    void receive_response(const uint8_t *the_data, uint64_t the_local_time);
+
+    //! apply the sample with the lowest round-trip, if it was not used before
+    void filter_samples();
+
+    void discipline(const sample_t &the_sample);
+
+    //! forget silent peers, start a timebase if nobody else does and pick the master
+    void elect_master(uint32_t the_now, uint64_t the_local_time);
+
+    size_t write_header(uint8_t *the_out, uint8_t the_type) const;
+
+    char m_device_id[s_max_id_length + 1];
+    uint32_t m_local_ip = 0, m_broadcast_ip = 0;
+
+    peer_t m_peers[s_max_num_peers];
+    uint8_t m_num_peers = 0;
+    uint32_t m_master_ip = 0;
+
+    // local 64bit clock
+    mutable uint32_t m_last_now = 0;
+    mutable uint64_t m_local_time = 0;
+    mutable bool m_has_clock = false;
+
+    uint64_t m_start_time = 0;
+    bool m_started = false;
+
+    uint64_t m_last_announce = 0, m_last_request = 0;
+    bool m_has_announced = false, m_announced_synced = false;
+
+    //! t1 of the outstanding request, responses to others are stale
+    uint64_t m_pending_request = 0;
+
+    sample_t m_samples[s_num_samples];
+    uint8_t m_num_samples = 0, m_sample_index = 0;
+
+    // global = local + m_offset + m_drift * (local - m_reference)
+    int64_t m_offset = 0;
+    uint64_t m_reference = 0;
+    float m_drift = 0.f;
+    uint64_t m_last_update = 0;
+
+    //! earlier sample, the drift is measured against
+    sample_t m_drift_anchor = {};
+    uint32_t m_rtt = 0;
+    bool m_synced = false;
+
+    uint32_t m_num_requests = 0;
+    uint32_t m_num_responses = 0;
+    uint32_t m_num_rejected = 0;
+    uint32_t m_num_steps = 0;
+};
+
+template <typename T> void TimeSync::poll(T &the_socket, uint32_t the_now)
+{
+    uint8_t buf[s_max_packet_size];
+
+    while(int num_bytes = the_socket.parsePacket())
+    {
+        if(num_bytes <= 0){ continue; }
+
+        uint32_t ip = the_socket.remoteIP();
+        uint16_t port = the_socket.remotePort();
+
+        // replies are written in place
+        int ret = the_socket.read(buf, sizeof(buf));
+        size_t reply_size = ret > 0 ? process(buf, ret, ip, the_now, buf) : 0;
+
+        if(reply_size)
+        {
+            the_socket.beginPacket(ip, port);
+            the_socket.write(buf, reply_size);
+            the_socket.endPacket();
+        }
+    }
+
+    uint32_t ip = 0;
+    size_t num_bytes = update(the_now, buf, &ip);
+
+    if(num_bytes)
+    {
+        the_socket.beginPacket(ip, TIMESYNC_PORT);
+        the_socket.write(buf, num_bytes);
+        the_socket.endPacket();
+    }
+}
+
+}// namespace
@@ -0,0 +1,246 @@
+#include <string.h>
+#include "UniverseReceiver.h"
+
+namespace kinski
+{
+
+namespace
+{
+    // Art-Net, little-endian opcodes
+    const uint8_t g_artnet_id[8] = {'A', 'r', 't', '-', 'N', 'e', 't', 0};
+    constexpr uint16_t ARTNET_OP_DMX = 0x5000;
+    constexpr uint16_t ARTNET_OP_SYNC = 0x5200;
+    constexpr uint8_t ARTNET_DMX_HEADER_SIZE = 18;
+    constexpr uint8_t ARTNET_SYNC_SIZE = 14;
+
+    // sACN (E1.31), big-endian
+    const uint8_t g_acn_id[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+    constexpr uint32_t VECTOR_ROOT_E131_DATA = 0x00000004;
+    constexpr uint32_t VECTOR_ROOT_E131_EXTENDED = 0x00000008;
+    constexpr uint32_t VECTOR_E131_DATA_PACKET = 0x00000002;
+    constexpr uint32_t VECTOR_E131_EXTENDED_SYNCHRONIZATION = 0x00000001;
+    constexpr uint8_t VECTOR_DMP_SET_PROPERTY = 0x02;
+    constexpr uint8_t SACN_FRAMING_VECTOR_END = 44;
+    constexpr uint8_t SACN_DATA_HEADER_SIZE = 126;
+    constexpr uint8_t SACN_SYNC_SIZE = 49;
+    constexpr uint8_t SACN_OPTION_PREVIEW = 1 << 7;
+    constexpr uint8_t SACN_OPTION_TERMINATED = 1 << 6;
+
+    // sequence-numbers this far behind the last one are out of order, anything else restarts
+    constexpr int8_t g_sequence_window = -20;
+
+    inline uint16_t read_u16_be(const uint8_t *the_ptr){ return (the_ptr[0] << 8) | the_ptr[1]; }
+
+    inline uint32_t read_u32_be(const uint8_t *the_ptr)
+    {
+        return ((uint32_t)the_ptr[0] << 24) | ((uint32_t)the_ptr[1] << 16) |
+               ((uint32_t)the_ptr[2] << 8) | the_ptr[3];
+    }
+}
+
+//! reads from packets in memory
+struct UniverseReceiver::buffer_reader_t : public reader_t
+{
+    const uint8_t *data;
+    size_t num_bytes;
+
+    buffer_reader_t(const uint8_t *the_data, size_t the_num_bytes):
+    data(the_data), num_bytes(the_num_bytes){}
+
+    size_t read(uint8_t *the_dst, size_t the_num_bytes) override
+    {
+        if(the_num_bytes > num_bytes){ the_num_bytes = num_bytes; }
+        memcpy(the_dst, data, the_num_bytes);
+        data += the_num_bytes;
+        num_bytes -= the_num_bytes;
+        return the_num_bytes;
+    }
+};
+
+bool UniverseReceiver::add_universe(uint16_t the_universe, uint8_t *the_data,
+                                    uint16_t the_num_bytes)
+{
+    if(m_num_universes >= s_max_num_universes || find_universe(the_universe)){ return false; }
+    if(the_num_bytes > s_max_num_slots){ the_num_bytes = s_max_num_slots; }
+
+    m_universes[m_num_universes++] = {the_data, the_universe, the_num_bytes, 0, false};
+    m_received = 0;
+    return true;
+}
+
+void UniverseReceiver::clear()
+{
+    m_num_universes = 0;
+    m_received = 0;
+}
+
+bool UniverseReceiver::parse(const uint8_t *the_data, size_t the_num_bytes, uint32_t the_now)
+{
+    buffer_reader_t reader(the_data, the_num_bytes);
+    return process(reader, the_num_bytes, the_now);
+}
+
+UniverseReceiver::universe_t* UniverseReceiver::find_universe(uint16_t the_universe)
+{
+    for(uint8_t i = 0; i < m_num_universes; ++i)
+    {
+        if(m_universes[i].universe == the_universe){ return m_universes + i; }
+    }
+    return nullptr;
+}
+
+bool UniverseReceiver::read_header(reader_t &the_reader, size_t the_num_bytes)
+{
+    if(the_num_bytes > m_packet_size){ return false; }
+
+    if(the_num_bytes > m_header_pos)
+    {
+        m_header_pos += the_reader.read(m_header + m_header_pos, the_num_bytes - m_header_pos);
+    }
+    return m_header_pos >= the_num_bytes;
+}
+
+bool UniverseReceiver::process(reader_t &the_reader, size_t the_num_bytes, uint32_t the_now)
+{
+    m_num_packets++;
+    m_header_pos = 0;
+    m_packet_size = the_num_bytes;
+
+    // enough to tell Art-Net from sACN, shorter than the smallest valid packet
+    if(!read_header(the_reader, ARTNET_SYNC_SIZE)){ m_num_errors++; return false; }
+
+    // Art-Net
+    if(!memcmp(m_header, g_artnet_id, sizeof(g_artnet_id)))
+    {
+        uint16_t op_code = m_header[8] | (m_header[9] << 8);
+
+        if(op_code == ARTNET_OP_SYNC){ return receive_sync(the_now); }
+
+        if(op_code == ARTNET_OP_DMX)
+        {
+            if(!read_header(the_reader, ARTNET_DMX_HEADER_SIZE)){ m_num_errors++; return false; }
+
+            uint16_t universe = m_header[14] | ((m_header[15] & 0x7F) << 8);
+            uint16_t num_slots = read_u16_be(m_header + 16);
+
+            if(num_slots > m_packet_size - ARTNET_DMX_HEADER_SIZE){ m_num_errors++; return false; }
+            return receive_dmx(the_reader, PROTOCOL_ARTNET, universe, m_header[12], num_slots,
+                               true, the_now);
+        }
+        // polls, diagnostics, etc. are not handled
+        return false;
+    }
+
+    // sACN
+    if(!read_header(the_reader, SACN_FRAMING_VECTOR_END) ||
+       memcmp(m_header + 4, g_acn_id, sizeof(g_acn_id)))
+    {
+        m_num_errors++;
+        return false;
+    }
+    uint32_t root_vector = read_u32_be(m_header + 18);
+    uint32_t framing_vector = read_u32_be(m_header + 40);
+
+    if(root_vector == VECTOR_ROOT_E131_EXTENDED &&
+       framing_vector == VECTOR_E131_EXTENDED_SYNCHRONIZATION)
+    {
+        if(!read_header(the_reader, SACN_SYNC_SIZE)){ m_num_errors++; return false; }
+        return receive_sync(the_now);
+    }
+
+    if(root_vector == VECTOR_ROOT_E131_DATA && framing_vector == VECTOR_E131_DATA_PACKET)
+    {
+        if(!read_header(the_reader, SACN_DATA_HEADER_SIZE) ||
+           m_header[117] != VECTOR_DMP_SET_PROPERTY)
+        {
+            m_num_errors++;
+            return false;
+        }
+        uint16_t sync_address = read_u16_be(m_header + 109);
+        uint8_t options = m_header[112];
+        uint16_t universe = read_u16_be(m_header + 113);
+
+        // property-value count includes the start-code
+        uint16_t num_slots = read_u16_be(m_header + 123);
+        num_slots = num_slots ? num_slots - 1 : 0;
+
+        if(num_slots > m_packet_size - SACN_DATA_HEADER_SIZE){ m_num_errors++; return false; }
+
+        // only NULL start-code carries dimmer-data
+        if(m_header[125] || options & (SACN_OPTION_PREVIEW | SACN_OPTION_TERMINATED))
+        {
+            return false;
+        }
+        return receive_dmx(the_reader, PROTOCOL_SACN, universe, m_header[111], num_slots,
+                           sync_address != 0, the_now);
+    }
+    return false;
+}
+
+bool UniverseReceiver::receive_dmx(reader_t &the_reader, Protocol the_protocol,
+                                   uint16_t the_universe, uint8_t the_sequence,
+                                   uint16_t the_num_slots, bool the_synchronized,
+                                   uint32_t the_now)
+{
+    universe_t *u = find_universe(the_universe);
+    if(!u){ return false; }
+
+    // Art-Net uses sequence 0 to disable sequencing, sACN just wraps through it
+    bool sequenced = the_protocol == PROTOCOL_SACN || the_sequence;
+
+    if(u->has_sequence && sequenced)
+    {
+        int8_t diff = the_sequence - u->sequence;
+
+        if(diff <= 0 && diff > g_sequence_window)
+        {
+            m_num_out_of_order++;
+            return false;
+        }
+    }
+    u->sequence = the_sequence;
+    u->has_sequence = sequenced;
+
+    // zero-copy, straight into the mapped range
+    uint16_t num_bytes = the_num_slots < u->num_bytes ? the_num_slots : u->num_bytes;
+    the_reader.read(u->data, num_bytes);
+
+    uint32_t bit = 1UL << (u - m_universes), all = (1UL << m_num_universes) - 1;
+
+    // wait for the sync-packet, unsynchronized sACN-data is shown without one
+    if(the_synchronized && synchronous(the_now))
+    {
+        m_received |= bit;
+        return false;
+    }
+
+    // a repeated universe means the others did not make it, don't wait for them
+    if(m_received & bit)
+    {
+        m_received = bit;
+        m_num_frames++;
+        return true;
+    }
+    m_received |= bit;
+
+    if(m_received == all)
+    {
+        m_received = 0;
+        m_num_frames++;
+        return true;
+    }
+    return false;
+}
+
+bool UniverseReceiver::receive_sync(uint32_t the_now)
+{
+    m_has_sync = true;
+    m_last_sync = the_now;
+
+    if(!m_received){ return false; }
+    m_received = 0;
+    m_num_frames++;
+    return true;
+}
+
+}// namespace
@@ -0,0 +1,170 @@
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+//
+// Copyright (C) 2012-2017, Fabian Schmidt <crocdialer@googlemail.com>
+//
+// It is distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+//  http://www.boost.org/LICENSE_1_0.txt
+// __ ___ ____ _____ ______ _______ ________ _______ ______ _____ ____ ___ __
+
+//  UniverseReceiver.h
+//
+//  Art-Net / sACN (E1.31) DMX-universe receiver
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ARTNET_PORT 6454
+#define SACN_PORT 5568
+
+namespace kinski
+{
+
+/*! receives DMX-universes via Art-Net (ArtDmx, ArtSync) and sACN (E1.31 data- and sync-packets).
+ *
+ *  universes are mapped to byte-ranges, usually parts of LED-buffers.
+ *  slot-data is read from the socket straight into those ranges, only headers are staged.
+ *
+ *  synchronous mode is entered by receiving ArtSync or sACN sync-packets.
+ *  while synchronous, frames are complete on sync-packets only. otherwise a frame is complete
+ *  when all mapped universes were received, or when a universe repeats before that.
+ *  without sync-packets for s_sync_timeout ms, the receiver falls back to the latter.
+ *  sACN-data with synchronization-address 0 is not synchronized, it always follows the latter.
+ *
+ *  Art-Net sequence 0 disables sequencing, for sACN it is a regular sequence-number.
+ *
+ *  parse() takes complete packets from memory, e.g. from recorded captures.
+ */
+class UniverseReceiver
+{
+public:
+
+    static constexpr uint8_t s_max_num_universes = 16;
+
+    //! maximum number of DMX-slots per universe
+    static constexpr uint16_t s_max_num_slots = 512;
+
+    //! fall back to non-synchronous mode, after this many ms without sync-packets
+    static constexpr uint32_t s_sync_timeout = 4000;
+
+    //! map the_universe to the_num_bytes at the_data. returns false if the table is full
+    bool add_universe(uint16_t the_universe, uint8_t *the_data, uint16_t the_num_bytes);
+
+    //! remove all mappings
+    void clear();
+
+    uint8_t num_universes() const { return m_num_universes; }
+
+    /*! read all pending packets from the_socket (an Arduino UDP-object).
+     *  returns true, if a frame was completed and should be shown
+     */
+    template <typename T> bool poll(T &the_socket, uint32_t the_now);
+
+    /*! process a single, complete packet from memory.
+     *  returns true, if a frame was completed and should be shown
+     */
+    bool parse(const uint8_t *the_data, size_t the_num_bytes, uint32_t the_now);
+
+    //! true while sync-packets are expected
+    bool synchronous(uint32_t the_now) const
+    {
+        return m_has_sync && (the_now - m_last_sync) < s_sync_timeout;
+    }
+
+    //! number of processed packets
+    uint32_t num_packets() const { return m_num_packets; }
+
+    //! number of completed frames
+    uint32_t num_frames() const { return m_num_frames; }
+
+    //! number of malformed packets
+    uint32_t num_errors() const { return m_num_errors; }
+
+    //! number of DMX-packets discarded for arriving out of order
+    uint32_t num_out_of_order() const { return m_num_out_of_order; }
+
+private:
+
+    struct universe_t
+    {
+        uint8_t *data;
+        uint16_t universe;
+        uint16_t num_bytes;
+        uint8_t sequence;
+        bool has_sequence;
+    };
+
+    //! size of the largest header we stage (sACN data, up to and including the start-code)
+    static constexpr uint8_t s_header_size = 126;
+
+    //! sequential access to the current packet, either in memory or on a socket
+    struct reader_t
+    {
+        virtual size_t read(uint8_t *the_dst, size_t the_num_bytes) = 0;
+    };
+
+    struct buffer_reader_t;
+
+    enum Protocol : uint8_t { PROTOCOL_ARTNET, PROTOCOL_SACN };
+
+    template <typename T> struct socket_reader_t : public reader_t
+    {
+        T &socket;
+        socket_reader_t(T &the_socket): socket(the_socket){}
+
+        size_t read(uint8_t *the_dst, size_t the_num_bytes) override
+        {
+            int ret = socket.read(the_dst, the_num_bytes);
+            return ret > 0 ? ret : 0;
+        }
+    };
+
+    bool process(reader_t &the_reader, size_t the_num_bytes, uint32_t the_now);
+
+    //! stage header-bytes up to the_num_bytes, false if the packet is too short
+    bool read_header(reader_t &the_reader, size_t the_num_bytes);
+
+    /*! read DMX-slots into the mapped range and update the frame-state.
+     *  the_synchronized: the packet waits for a sync-packet, while synchronous
+     */
+    bool receive_dmx(reader_t &the_reader, Protocol the_protocol, uint16_t the_universe,
+                     uint8_t the_sequence, uint16_t the_num_slots, bool the_synchronized,
+                     uint32_t the_now);
+
+    bool receive_sync(uint32_t the_now);
+
+    universe_t* find_universe(uint16_t the_universe);
+
+    universe_t m_universes[s_max_num_universes];
+    uint8_t m_num_universes = 0;
+
+    //! bitmask of universes received for the current frame
+    uint32_t m_received = 0;
+
+    uint8_t m_header[s_header_size];
+    size_t m_header_pos = 0, m_packet_size = 0;
+
+    uint32_t m_last_sync = 0;
+    bool m_has_sync = false;
+
+    uint32_t m_num_packets = 0;
+    uint32_t m_num_frames = 0;
+    uint32_t m_num_errors = 0;
+    uint32_t m_num_out_of_order = 0;
+};
+
+template <typename T> bool UniverseReceiver::poll(T &the_socket, uint32_t the_now)
+{
+    bool frame_complete = false;
+
+    while(int num_bytes = the_socket.parsePacket())
+    {
+        socket_reader_t<T> reader(the_socket);
+        if(num_bytes > 0 && process(reader, num_bytes, the_now)){ frame_complete = true; }
+    }
+    return frame_complete;
+}
+
+}// namespace
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Arduino.h"
+#include "Format.h"
 
 class no_interrupt
 {
@@ -9,17 +10,11 @@ public:
     ~no_interrupt(){ interrupts(); }
 };
 
+//! fixed-point decimal with precision fractional digits
 template <typename T>
 void fmt_real_to_str(char *buf, T val, uint32_t precision = 3)
 {
-    int multiplier = 1;
-    char fmt_string[8];
-    // sprintf(fmt_string, "%d.%03d")
-    for(int i = 0; i < precision; i++){ multiplier *= 10; }
-    T frac = val - (int)val;
-    frac = frac < 0 ? -frac : frac;
-    int32_t fmt = frac * multiplier;
-    sprintf(buf, "%d.%03d", (int)val, fmt);
+    kinski::fmt_fixed(buf, val, precision);
 };
 
 template <typename T>
@@ -1,29 +1,73 @@
 #include "Arduino.h"
+#include "ADC_Timing.h"
 
 #pragma once
 
 //! stripped-down fast analogue read.
 //  the_pin is the analog input pin number to be read.
+//  not to be used while an ADC_Sampler is running.
 uint32_t adc_read(uint8_t the_pin);
 
 //! signature for a ADC-value callback
 typedef void (*adc_callback_t)(uint32_t the_value);
 
+//! description of a single input channel for ADC_Sampler
+struct adc_channel_t
+{
+    //! analog input pin
+    uint8_t pin;
+
+    //! sample this channel on every n-th timer tick (1 -> full sample rate)
+    uint32_t decimation;
+
+    //! optional callback, invoked from ISR for every new sample on this channel
+    adc_callback_t callback;
+
+    //! effective resolution in bits (8, 10, 12 or 13 - 16 using hardware oversampling).
+    //  0 -> 10 bits. see ADC_Timing.h for the conversion time
+    uint8_t resolution;
+};
+
 /*! this helper class performs a kind of ADC free-running,
-/*  taking continous samples from a given ADC pin with a given sample rate
+/*  taking continous samples from a list of ADC channels with a given sample rate.
+ *  conversions are started by a timer and chained in the ADC's result-ready interrupt,
+ *  so slower channels are scanned in between without busy-waiting or masking interrupts.
+ *  the channel-list order defines the scan priority.
  */
 class ADC_Sampler
 {
  public:
+     static constexpr uint8_t s_max_num_channels = 8;
+
      ADC_Sampler();
      ~ADC_Sampler();
 
      //! start continuous sampling with the given ADC pin and samplerate
      void begin(int the_pin, uint32_t the_sample_rate);
 
+     //! start continuous round-robin sampling for a list of channels.
+     //  the_sample_rate is the timer-rate, each channel is sampled at the_sample_rate / decimation.
+     //  the_config provides ADC clock-prescaler and sample length for all channels.
+     //  the_sample_rate is limited to adc_max_scan_rate(), see sample_rate() for the actual one
+     void begin(const adc_channel_t *the_channels, uint8_t the_num_channels,
+                uint32_t the_sample_rate,
+                const adc_config_t &the_config = g_adc_default_config);
+
      //! stop continuous sampling
      void end();
 
-     //! pass a callback-function pointer to be called when a new sample is taken
+     //! pass a callback-function pointer to be called when a new sample is taken (channel 0)
      void set_adc_callback(adc_callback_t the_callback);
+
+     //! the most recent value for a channel
+     uint32_t value(uint8_t the_channel) const;
+
+     //! total number of samples taken for a channel
+     uint32_t num_samples(uint8_t the_channel) const;
+
+     //! number of conversions that were still pending, when a channel was due again
+     uint32_t num_overruns() const;
+
+     //! the actual timer-rate in Hz
+     uint32_t sample_rate() const;
 };
@@ -1,65 +1,65 @@
 #include "LED_Path.h"
 
-Segment::Segment(uint32_t the_length):
+Segment::Segment(uint8_t *the_data, uint32_t the_length):
+m_data(the_data),
 m_length(the_length)
 {
 
 }
 
-LED_Path::LED_Path(uint32_t the_pin, uint32_t the_num_segments):
-m_num_segments(the_num_segments)
+LED_Path::LED_Path(uint32_t the_pin, uint32_t the_num_segments, uint32_t the_seg_length):
+m_num_segments(the_num_segments),
+m_segment_length(the_seg_length)
 {
-    m_segments = new Segment*[the_num_segments];
+    m_strip = new LedType(the_seg_length * the_num_segments, the_pin, CURRENT_LED_TYPE);
+    m_strip->begin();
 
-    for(uint32_t i = 0; i < the_num_segments; ++i)
-    {
-        m_segments[i] = new Segment(SEGMENT_LENGTH);
-    }
+    // we're scaling the brightness ourselves
+    m_strip->setBrightness(255);
 
-    m_strip = new Adafruit_NeoPixel(SEGMENT_LENGTH * the_num_segments, the_pin, NEO_GRBW + NEO_KHZ800);
-    m_strip->begin();
-    m_strip->setBrightness(255 * m_brightness);
-    m_strip->show(); // Initialize all pixels to 'off'
+    // initialize all pixels to 0
+    m_strip->show();
 
     m_data = (uint8_t*)m_strip->getPixels();
-
     m_current_max = num_leds();
+
+    m_segments = new Segment*[the_num_segments];
+
+    for(uint32_t i = 0; i < the_num_segments; ++i)
+    {
+        m_segments[i] = new Segment(m_data + i * m_segment_length * BYTES_PER_PIXEL,
+                                    the_seg_length);
+    }
 }
 
 LED_Path::~LED_Path()
 {
-    delete m_strip;
-    for(uint32_t i = 0; i < m_num_segments; ++i){ delete m_segments[i]; }
-    delete[] m_segments;
+    if(m_strip){ delete m_strip; }
+    if(m_segments)
+    {
+        for(uint32_t i = 0; i < m_num_segments; ++i){ delete m_segments[i]; }
+        delete[] m_segments;
+    }
 }
 
 void LED_Path::clear()
 {
-    memset(m_data, 0, num_leds() * 4);
+    memset(m_data, 0, num_leds() * BYTES_PER_PIXEL);
 }
 
 void LED_Path::update(uint32_t the_delta_time)
 {
-    clear();
+    static_assert(BYTES_PER_PIXEL == 4, "LED_Path: requires 32bit pixels");
 
-    for(uint32_t i = 0; i < m_num_segments; ++i)
+    // modulate the rendered frame with the sinus-pattern, blank pixels not yet flashed in
+    uint32_t *ptr = (uint32_t*)m_data;
+    uint32_t num_lit = m_current_max < num_leds() ? m_current_max : num_leds();
+
+    for(uint32_t i = 0; i < num_lit; ++i)
     {
-        if(!m_segments[i]->active()){ continue; }
-        uint32_t c = m_segments[i]->color();
-        uint32_t *ptr = (uint32_t*)m_data + i * SEGMENT_LENGTH;
-        uint32_t *end_ptr = ptr + SEGMENT_LENGTH;
-
-        for(;ptr < end_ptr;++ptr)
-        {
-            uint32_t current_index = ptr - (uint32_t*)m_data;
-            if(current_index >= m_current_max){ goto finished; }
-
-            float sin_val = create_sinus_val(current_index);
-            *ptr = fade_color(c, m_brightness * sin_val);
-        }
+        if(ptr[i]){ ptr[i] = scale_color(ptr[i], 256 * create_sinus_val(i)); }
     }
-
-finished:
+    memset(ptr + num_lit, 0, (num_leds() - num_lit) * BYTES_PER_PIXEL);
 
     m_strip->show();
     m_current_max = min(num_leds(), m_current_max + m_flash_speed * the_delta_time / 1000.f);
@@ -71,16 +71,4 @@ finished:
     }
 }
 
-void LED_Path::set_brightness(float the_brightness)
-{
-     m_brightness = the_brightness;
-     m_strip->setBrightness(255 * m_brightness);
-}
-
-void LED_Path::set_all_segments(uint32_t the_color)
-{
-    for(uint32_t i = 0; i < m_num_segments; ++i)
-    {
-        m_segments[i]->set_color(the_color);
-    }
-}
+void LED_Path::set_brightness(float the_brightness){ m_brightness = the_brightness; }
@@ -3,22 +3,38 @@
 
 #include "utils.h"
 #include "ColorDefines.h"
+// #include <Adafruit_NeoPixel_ZeroDMA.h>
 #include <Adafruit_NeoPixel.h>
 
-#define TUBE_LENGTH 1
-#define SEGMENT_LENGTH TUBE_LENGTH // (2 tubes, each 58 px)
-#define PATH_LENGTH 8
+// using LedType = Adafruit_NeoPixel_ZeroDMA;
+using LedType = Adafruit_NeoPixel;
+
+// #define CURRENT_LED_TYPE (NEO_RGB + NEO_KHZ800)
+// #define BYTES_PER_PIXEL 3
+
+#define CURRENT_LED_TYPE (NEO_GRBW + NEO_KHZ800)
+#define BYTES_PER_PIXEL 4
+#define DEFAULT_SEGMENT_LENGTH 1
+
+//! scale all 4 channels of a color by the_scale / 256, two channels per multiply
+static inline uint32_t scale_color(uint32_t the_color, uint32_t the_scale)
+{
+    return (((the_color & 0x00FF00FF) * the_scale >> 8) & 0x00FF00FF) |
+           (((the_color >> 8) & 0x00FF00FF) * the_scale & 0xFF00FF00);
+}
 
 class Segment
 {
 public:
-    Segment(uint32_t the_length);
-    inline uint32_t length(){return m_length; }
+    Segment(uint8_t *the_data, uint32_t the_length);
+    inline uint32_t length() const {return m_length; }
     inline uint32_t color() const { return m_color; }
     inline void set_color(uint32_t the_color){ m_color = the_color; }
     inline void set_active(bool b){ m_active = b; }
     inline bool active() const{ return m_active; }
+    inline uint8_t* data() { return m_data; };
 private:
+    uint8_t* m_data = nullptr;
     uint32_t m_length;
     uint32_t m_color = AQUA;
     bool m_active = true;
@@ -27,25 +43,29 @@ private:
 class LED_Path
 {
 public:
-    LED_Path(uint32_t the_pin, uint32_t the_num_segments);
+    LED_Path(){};
+    LED_Path(uint32_t the_pin, uint32_t the_num_segments,
+             uint32_t the_seg_length = DEFAULT_SEGMENT_LENGTH);
     ~LED_Path();
 
-    inline uint32_t num_leds() const{ return num_segments() * SEGMENT_LENGTH; }
-    inline uint32_t num_segments() const{ return m_num_segments; };
+    inline uint32_t num_leds() const { return num_segments() * m_segment_length; }
+    inline uint32_t num_segments() const { return m_num_segments; };
     inline Segment* segment(uint32_t the_index){ return m_segments[the_index]; };
 
-    void set_all_segments(uint32_t the_color);
     inline float brightness(){ return m_brightness; }
     void set_brightness(float the_brightness);
 
     void clear();
     void update(uint32_t the_delta_time);
 
-    inline const uint8_t* data() const { return m_data; };
+    inline uint8_t* data() { return m_data; };
+    inline uint32_t num_bytes() const { return num_leds() * BYTES_PER_PIXEL; };
+    inline LedType* strip() { return m_strip; }
 
-    void set_current_max(uint32_t the_max){ m_current_max = the_max; }
-    void set_flash_speed(float the_speed){ m_flash_speed = the_speed; }
-    void set_flash_direction(bool b){ m_flash_forward = b; }
+    //! pixels beyond current_max stay dark, it grows with flash_speed (pixels per sec)
+    inline uint32_t current_max() const{ return m_current_max; }
+    inline void set_current_max(uint32_t the_max){ m_current_max = the_max; }
+    inline void set_flash_speed(float the_speed){ m_flash_speed = the_speed; }
 
 private:
 
@@ -53,8 +73,7 @@ private:
     float m_sinus_speeds[2] = {-7.5f, .5f};
     float m_sinus_offsets[2] = {0, 211};
 
-    FastSinus m_fast_sin;
-
+    //! travelling sinus-pattern, modulating the rendered pixels
     inline float create_sinus_val(uint32_t the_index)
     {
         float ret = 1.f;
@@ -62,19 +81,19 @@ private:
         for(uint32_t i = 0; i < 2; ++i)
         {
             float val = m_sinus_factors[i] * (the_index + m_sinus_offsets[i]) / 16;
-            ret *= (m_fast_sin(val) + 1.f) / 2.f;
+            ret *= (sinf(val) + 1.f) / 2.f;
         }
         return clamp(ret, 0.05f, 1.f);
     }
 
-    uint8_t* m_data;
-    Adafruit_NeoPixel* m_strip;
-    uint32_t m_num_segments;
-    Segment** m_segments;
+    uint8_t* m_data = nullptr;
+    LedType* m_strip = nullptr;
+    uint32_t m_num_segments = 0;
+    uint32_t m_segment_length = 0;
+    Segment** m_segments = nullptr;
     float m_brightness = .4f;
 
     float m_current_max;
     float m_flash_speed = 800.f;
-    bool m_flash_forward = true;
 };
 #endif
@@ -0,0 +1,76 @@
+#include "ModeHelpers.h"
+
+ModeHelper::ModeHelper(){}
+
+void ModeHelper::set_trigger_time(uint32_t the_min, uint32_t the_max)
+{
+    m_trigger_time_min = the_min;
+    m_trigger_time_max = the_max;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Mode_VU::Mode_VU(level_source_t the_source, uint32_t the_color, uint32_t the_peak_color):
+ModeHelper(),
+m_level_source(the_source),
+m_color(the_color),
+m_peak_color(the_peak_color)
+{
+
+}
+
+void Mode_VU::process(LED_Path* the_path, uint32_t the_delta_time)
+{
+    static_assert(BYTES_PER_PIXEL == 4, "Mode_VU: requires 32bit pixels");
+
+    // level and peak with falloff
+    float lvl = m_level_source ? clamp<float>(m_level_source(), 0.f, 1.f) : 0.f;
+    float delta_secs = the_delta_time / 1000.f;
+    m_level = max(lvl, m_level - m_bar_falloff * delta_secs);
+    m_time_accum += the_delta_time;
+
+    if(m_level >= m_peak)
+    {
+        m_peak = m_level;
+        m_time_accum = 0;
+    }
+    else if(m_time_accum > m_peak_hold)
+    {
+        m_peak = max(m_level, m_peak - m_peak_falloff * delta_secs);
+    }
+
+    // bar length in 1/256 pixels
+    uint32_t num_leds = the_path->num_leds();
+    uint32_t bar_length = m_level * num_leds * 256;
+    uint32_t num_full = min(bar_length >> 8, num_leds);
+    uint32_t fraction = bar_length & 0xFF;
+
+    // brightness applied once per frame, not per pixel
+    uint32_t scale = 256 * the_path->brightness();
+    uint32_t col = scale_color(m_color, scale);
+
+    // fill the bar with plain word-stores
+    uint32_t *ptr = (uint32_t*)the_path->data(), *end_ptr = ptr + num_full;
+    for(; ptr < end_ptr; ++ptr){ *ptr = col; }
+
+    // anti-aliased tip, blended with what is underneath (e.g. another bar)
+    if(fraction && num_full < num_leds)
+    {
+        *ptr = scale_color(col, fraction) + scale_color(*ptr, 256 - fraction);
+    }
+
+    // peak-marker
+    uint32_t peak_index = m_peak * num_leds;
+
+    if(m_peak_color && m_peak > 0.f && peak_index >= num_full)
+    {
+        peak_index = min(peak_index, num_leds - 1);
+        ((uint32_t*)the_path->data())[peak_index] = scale_color(m_peak_color, scale);
+    }
+}
+
+void Mode_VU::reset(LED_Path* the_path)
+{
+    m_time_accum = 0;
+    m_level = m_peak = 0.f;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "utils.h"
+#include "LED_Path.h"
+#include "ColorDefines.h"
+
+class ModeHelper
+{
+public:
+    ModeHelper();
+    virtual void process(LED_Path* the_path, uint32_t the_delta_time) = 0;
+    virtual void reset(LED_Path* the_path) = 0;
+    virtual void set_trigger_time(uint32_t the_min, uint32_t the_max);
+
+protected:
+
+    uint32_t m_time_accum = 0;
+    uint32_t m_trigger_time = 0;
+    uint32_t m_trigger_time_min = 0, m_trigger_time_max = 0;
+};
+
+//! signature for a level-source, returning values in range [0, 1]
+typedef float (*level_source_t)();
+
+/*! renders a pixel-accurate level-bar with anti-aliased tip,
+ *  a peak-hold marker and timed falloff for both.
+ *  does not clear the path, so several bars can be stacked
+ */
+class Mode_VU : public ModeHelper
+{
+public:
+    Mode_VU(level_source_t the_source = nullptr, uint32_t the_color = AQUA,
+            uint32_t the_peak_color = WHITE);
+    void process(LED_Path* the_path, uint32_t the_delta_time) override;
+    void reset(LED_Path* the_path) override;
+
+    inline void set_level_source(level_source_t the_source){ m_level_source = the_source; }
+    inline void set_color(uint32_t the_color){ m_color = the_color; }
+
+    //! set color for the peak-marker, BLACK disables the marker
+    inline void set_peak_color(uint32_t the_color){ m_peak_color = the_color; }
+
+    //! time in millis, the peak-marker is held before it starts falling
+    inline void set_peak_hold(uint32_t the_millis){ m_peak_hold = the_millis; }
+
+    //! falloff for bar and peak-marker in levels per second
+    inline void set_falloff(float the_bar_falloff, float the_peak_falloff)
+    {
+        m_bar_falloff = the_bar_falloff;
+        m_peak_falloff = the_peak_falloff;
+    }
+
+    inline float level() const { return m_level; }
+    inline float peak() const { return m_peak; }
+
+private:
+    level_source_t m_level_source = nullptr;
+    uint32_t m_color, m_peak_color;
+    float m_level = 0.f, m_peak = 0.f;
+    uint32_t m_peak_hold = 800;
+    float m_bar_falloff = 1.5f, m_peak_falloff = .5f;
+};
@@ -1,7 +1,9 @@
-#include "RunningMedian.h"
 #include "utils.h"
 #include "ADC_Sampler.h"
 #include "LED_Path.h"
+#include "ModeHelpers.h"
+#include "SPSC_Queue.h"
+#include "SampleStats.h"
 
 #define ARM_MATH_CM0
 #include "arm_math.h"
@@ -11,6 +13,9 @@
 
 #define ADC_BITS 10
 
+// poti and battery use hardware oversampling
+#define ADC_BITS_SLOW 13
+
 // some pin defines
 #define POTI_PIN A0
 #define MIC_PIN A1
@@ -20,14 +25,18 @@
 #define SERIAL_BUFSIZE 128
 
 constexpr float ADC_MAX = (1 << ADC_BITS) - 1.f;
+constexpr float ADC_MAX_SLOW = (1 << ADC_BITS_SLOW) - 1.f;
 
 char g_serial_buf[SERIAL_BUFSIZE];
 uint32_t g_buf_index = 0;
 
 // mic sampling
 const uint32_t g_mic_sample_window = 100;
-volatile uint32_t g_mic_signal_max = 0;
-volatile uint32_t g_mic_signal_min = ADC_MAX;
+uint32_t g_mic_signal_max = 0;
+uint32_t g_mic_signal_min = ADC_MAX;
+
+// mic samples, pushed from ADC_Sampler ISR and drained in loop()
+kinski::SPSC_Queue<uint16_t, 1024> g_mic_samples;
 
 // start of sample window
 uint32_t g_mic_start_millis = 0;
@@ -46,6 +55,10 @@ float g_mic_decay = 2.f;
 // continuous sampling with timer interrupts and custom ADC settings
 ADC_Sampler g_adc_sampler;
 
+// scanned ADC channels, mic at full rate, poti and battery at 50Hz
+constexpr uint32_t g_adc_sample_rate = 22050;
+enum AdcChannel{ ADC_CHANNEL_MIC = 0, ADC_CHANNEL_POTI = 1, ADC_CHANNEL_BATTERY = 2 };
+
 // Run FFT on sample data.
 arm_cfft_radix4_instance_f32 fft_inst;
 
@@ -63,37 +76,41 @@ bool g_indicator = false;
 // LEDs
 LED_Path g_path(LED_PIN, 8);
 
-// Poti
-constexpr uint8_t g_num_poti_samples = 3;
-RunningMedian g_pot_vals(g_num_poti_samples);
+// level-meters for battery and mic
+ModeHelper *g_mode_bat = nullptr, *g_mode_mic = nullptr;
 
 float battery_lvl()
 {
-    constexpr uint32_t measure_interval = 10000;
-    static uint32_t last_measure = measure_interval;
-    static float ret = 0.f;
-    uint32_t delta_time = millis() - last_measure;
-    
-    if(delta_time >= measure_interval)
-    {
-        ret = analogRead(BATTERY_PIN);
-        last_measure = millis();
-        // voltage is divided by 2, so multiply back
-        ret *= 2 * 3.3f / ADC_MAX;
-        ret = map_value<float>(ret, 3.3f, 4.2f, 0.f, 1.f);
-        // Serial.print("VBat: " );
-        // Serial.println(measuredvbat);
-    }
+    float ret = g_adc_sampler.value(ADC_CHANNEL_BATTERY);
+
+    // voltage is divided by 2, so multiply back
+    ret *= 2 * 3.3f / ADC_MAX_SLOW;
+    ret = map_value<float>(ret, 3.3f, 4.2f, 0.f, 1.f);
+    // Serial.print("VBat: " );
+    // Serial.println(measuredvbat);
     return ret;
 }
 
+float mic_lvl(){ return g_mic_lvl; }
+
 //! value callback from ADC_Sampler ISR
 void adc_callback(uint32_t the_sample)
 {
-    if(the_sample <= ADC_MAX)
+    if(the_sample <= ADC_MAX){ g_mic_samples.push(the_sample); }
+}
+
+//! consume queued mic samples in batches and update min/max for the current window
+void drain_mic_samples()
+{
+    constexpr uint32_t batch_size = 64;
+    uint16_t samples[batch_size];
+    uint32_t num_samples;
+
+    while((num_samples = g_mic_samples.pop(samples, batch_size)))
     {
-        g_mic_signal_min = min(g_mic_signal_min, the_sample);
-        g_mic_signal_max = max(g_mic_signal_max, the_sample);
+        auto stats = kinski::compute_sample_stats(samples, num_samples);
+        g_mic_signal_min = min(g_mic_signal_min, (uint32_t)stats.min);
+        g_mic_signal_max = max(g_mic_signal_max, (uint32_t)stats.max);
     }
 }
 
@@ -111,9 +128,18 @@ void setup()
     // while(!Serial){ delay(10); }
     Serial.begin(115200);
 
-    // start mic sampling
-    g_adc_sampler.set_adc_callback(&adc_callback);
-    // g_adc_sampler.begin(MIC_PIN, 22050);
+    // start mic, poti and battery sampling
+    const adc_channel_t adc_channels[] =
+    {
+        {MIC_PIN, 1, &adc_callback, ADC_BITS},
+        {POTI_PIN, g_adc_sample_rate / 50, nullptr, ADC_BITS_SLOW},
+        {BATTERY_PIN, g_adc_sample_rate / 50, nullptr, ADC_BITS_SLOW}
+    };
+    g_adc_sampler.begin(adc_channels, 3, g_adc_sample_rate);
+
+    // battery bar without peak-marker, mic bar on top
+    g_mode_bat = new Mode_VU(&battery_lvl, ORANGE, BLACK);
+    g_mode_mic = new Mode_VU(&mic_lvl, AQUA, WHITE);
 }
 
 void loop()
@@ -123,24 +149,9 @@ void loop()
     g_last_time_stamp = millis();
     g_time_accum += delta_time;
 
-    float bat_lvl = 0.f;
-
-    adc_callback(analogRead(MIC_PIN));
-
-    // scope is interrupt free
-    // {
-    //     no_interrupt ni;
-    //
-    //     // update poti-lvl
-    //     for(int i = 0; i < g_num_poti_samples; ++i)
-    //     {
-    //         g_pot_vals.add(analogRead(POTI_PIN));
-    //     }
-    //
-    //     bat_lvl = battery_lvl();
-    // }
-    // float current_pot = map_value<float>(g_pot_vals.getMedian(), 133, 858, 0.f, 1.f);
-    // Serial.println((int)g_pot_vals.getMedian());
+    // update poti-lvl (oversampled in hardware, no median needed)
+    // float current_pot = map_value<float>(g_adc_sampler.value(ADC_CHANNEL_POTI) / 8.f,
+    //                                      133, 858, 0.f, 1.f);
 
     if(g_time_accum >= g_update_interval)
     {
@@ -155,15 +166,9 @@ void loop()
         process_mic_input(g_time_accum);
 
         // logic goes here
-        g_path.set_all_segments(BLACK);
-        int segs_bat = battery_lvl() * g_path.num_segments();
-        int segs_mic = g_mic_lvl * g_path.num_segments();
-
-        for(int i = 0; i < g_path.num_segments(); ++i)
-        {
-            if(i < segs_bat){ g_path.segment(i)->set_color(ORANGE); }
-            if(i < segs_mic){ g_path.segment(i)->set_color(AQUA); }
-        }
+        g_path.clear();
+        g_mode_bat->process(&g_path, g_time_accum);
+        g_mode_mic->process(&g_path, g_time_accum);
         g_path.update(g_time_accum);
 
         // clear time accumulator
@@ -173,6 +178,8 @@ void loop()
 
 void process_mic_input(uint32_t the_delta_time)
 {
+    drain_mic_samples();
+
     // decay
     float decay = g_mic_decay * the_delta_time / 1000.f;
     g_mic_lvl = max(0, g_mic_lvl - decay);
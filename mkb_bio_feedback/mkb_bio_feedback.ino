@@ -10,6 +10,7 @@
 #include "RunningMedian.h"
 #include "utils.h"
 #include "vec3.h"
+#include "CommandParser.h"
 
 #define CMD_QUERY_ID "ID"
 #define CMD_START "START"
@@ -23,6 +24,9 @@
 #define SERIAL_END_CODE '\n'
 #define SERIAL_BUFSIZE 512
 char g_serial_buf[SERIAL_BUFSIZE];
+
+// incoming text-commands
+kinski::LineBuffer<128> g_serial_lines;
 
 #define ADC_BITS 10
 const float ADC_MAX = (1 << ADC_BITS) - 1.f;
@@ -122,18 +126,20 @@ void loop()
 
     if(g_time_accum >= g_update_interval)
     {
+        // append in place, no strcat/sprintf
+        char *buf_ptr = g_serial_buf;
+
         for(uint8_t s = 0; s < g_num_sensors; s++)
         {
-            strcat(g_serial_buf, fmt_real_to_str(g_value_buf[s]));
-            strcat(g_serial_buf, " ");
+            buf_ptr = kinski::fmt_fixed(buf_ptr, g_value_buf[s]);
+            *buf_ptr++ = ' ';
         }
-        strcat(g_serial_buf, fmt_real_to_str(g_hall_current_value));
-        strcat(g_serial_buf, "\n");
+        buf_ptr = kinski::fmt_fixed(buf_ptr, g_hall_current_value);
+        kinski::fmt_char(buf_ptr, '\n');
 
         // write to serial
         Serial.print(g_serial_buf);
 
-        g_serial_buf[0] = '\0';
         memset(g_value_buf, 0, sizeof(g_value_buf));
         g_time_accum = 0;
         g_indicator = !g_indicator;
@@ -143,55 +149,27 @@ void loop()
     }
 }
 
-template <typename T> void process_serial_input(T& the_serial)
+void cmd_query_id(Print &the_device, kinski::Args &the_args)
 {
-    uint16_t buf_idx = 0;
-
-    while(the_serial.available())
-    {
-        // get the new byte:
-        char c = the_serial.read();
-
-        switch(c)
-        {
-            case '\r':
-            case '\0':
-                continue;
-
-            case '\n':
-                g_serial_buf[buf_idx] = '\0';
-                buf_idx = 0;
-                parse_line(g_serial_buf);
-                break;
-
-            default:
-                g_serial_buf[buf_idx++] = c;
-                break;
-        }
-    }
+    the_device.write(CMD_QUERY_ID " " DEVICE_ID "\n");
 }
 
-bool check_for_cmd(const char* the_str)
+//! sorted by name
+constexpr kinski::command_t<Print> g_commands[] =
 {
-    if(strcmp(the_str, CMD_QUERY_ID) == 0)
-    {
-        char buf[32];
-        sprintf(buf, "%s %s\n", the_str, DEVICE_ID);
-        Serial.write(buf);
-        return true;
-    }
-    return false;
-}
+    {CMD_QUERY_ID, &cmd_query_id}
+};
+static_assert(kinski::is_sorted(g_commands), "command-table must be sorted by name");
 
-void parse_line(char *the_line)
+template <typename T> void process_serial_input(T& the_serial)
 {
-    const char* delim = " ";
-    const size_t elem_count = 3;
-    char *token = strtok(the_line, delim);
-
-    while(token)
+    // partial lines are kept in g_serial_lines until their newline arrives
+    while(the_serial.available())
     {
-        if(check_for_cmd(token)){ break; }
-        token = strtok(nullptr, delim);
+        if(g_serial_lines.feed(the_serial.read()))
+        {
+            kinski::dispatch_command(g_commands, the_serial, g_serial_lines.line(),
+                                     g_serial_lines.length());
+        }
     }
 }
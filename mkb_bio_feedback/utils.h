@@ -1,17 +1,14 @@
 #pragma once
 
 #include "Arduino.h"
+#include "Format.h"
 
+//! fixed-point decimal with precision fractional digits, in a static buffer
 template <typename T>
 const char* fmt_real_to_str(T val, uint32_t precision = 3)
 {
-    static char ret[32], fmt_buf[32];
-    int multiplier = 1;
-    for(int i = 0; i < precision; i++){ multiplier *= 10; }
-    T frac = val - int(val);
-    int32_t fmt = frac * multiplier;
-    sprintf(fmt_buf, "%%d.%%%02dd", (int)precision);
-    sprintf(ret, fmt_buf, (int)val, fmt);
+    static char ret[32];
+    kinski::fmt_fixed(ret, val, precision);
     return ret;
 };
 
@@ -5,6 +5,7 @@
 */
 
 #include <Adafruit_NeoPixel.h>
+#include "CommandParser.h"
 
 #define CMD_QUERY_ID "ID"
 #define CMD_START "START"
@@ -14,7 +15,9 @@
 
 #define SERIAL_END_CODE '\n'
 #define SERIAL_BUFSIZE 512
-char g_serial_buf[SERIAL_BUFSIZE];
+
+// incoming lines, kept across calls until their SERIAL_END_CODE arrives
+kinski::LineBuffer<SERIAL_BUFSIZE> g_serial_lines(SERIAL_END_CODE);
 
 long g_last_time_stamp = 0;
 uint32_t g_time_accum = 0;
@@ -71,8 +74,6 @@ void setup()
     Serial.begin(57600);
     // Serial.println(DEVICE_ID);
 
-    memset(g_serial_buf, 0, SERIAL_BUFSIZE);
-
     for(int i = 0; i < g_num_stripes; i++)
     {
         g_stripes[i] = new Adafruit_NeoPixel(g_led_counts[i], g_led_pins[i], NEO_GRBW + NEO_KHZ800);
@@ -106,61 +107,44 @@ void loop()
     }
 }
 
-template <typename T> void process_serial_input(T& the_serial)
+void cmd_query_id(Print &the_device, kinski::Args &the_args)
 {
-    uint32_t bytes_to_read = min(the_serial.available(), SERIAL_BUFSIZE);
-    the_serial.readBytes(g_serial_buf, bytes_to_read);
-    char* buf_ptr = g_serial_buf;
-
-    for(uint32_t i = 0; i < bytes_to_read; i++)
-    {
-        switch(g_serial_buf[i])
-        {
-            case '\n':
-                g_serial_buf[i] = '\0';
-                parse_line(buf_ptr);
-                buf_ptr = g_serial_buf + i + 1;
-                break;
-
-            default:
-            // case '\r':
-            // case '\0':
-                break;
-        }
-    }
+    char buf[32];
+    sprintf(buf, "%s %s\n", CMD_QUERY_ID, DEVICE_ID);
+    the_device.write(buf);
 }
 
-bool check_for_cmd(const char* the_str)
+//! sorted by name
+constexpr kinski::command_t<Print> g_commands[] =
+{
+    {CMD_QUERY_ID, &cmd_query_id}
+};
+static_assert(kinski::is_sorted(g_commands), "command-table must be sorted by name");
+
+template <typename T> void process_serial_input(T& the_serial)
 {
-    if(strcmp(the_str, CMD_QUERY_ID) == 0)
+    while(the_serial.available())
     {
-        char buf[32];
-        sprintf(buf, "%s %s\n", the_str, DEVICE_ID);
-        Serial.write(buf);
-        return true;
+        if(!g_serial_lines.feed(the_serial.read())){ continue; }
+
+        if(!kinski::dispatch_command(g_commands, the_serial, g_serial_lines.line(),
+                                     g_serial_lines.length()))
+        {
+            kinski::Args args(g_serial_lines.line(), g_serial_lines.length());
+            parse_color(args);
+        }
     }
-    return false;
 }
 
-void parse_line(char *the_line)
+//! "<w>", "<r> <g> <b>" or "<r> <g> <b> <w>"
+void parse_color(kinski::Args &the_args)
 {
-    const char* delim = " ";
-
-    // we expect 4 ints
+    // we expect up to 4 ints
     const size_t elem_count = 4;
-    int parsed_ints[elem_count];
-
-    char *token = strtok(the_line, delim);
+    int32_t parsed_ints[elem_count];
     uint32_t num_tokens = 0;
 
-    for(; token && (num_tokens < elem_count);)
-    {
-        if(check_for_cmd(token)){ break; }
-        else{ parsed_ints[num_tokens] = atoi(token); ++num_tokens; }
-
-        // fetch next token
-        token = strtok(nullptr, delim);
-    }
+    while(num_tokens < elem_count && the_args.next_int(parsed_ints + num_tokens)){ ++num_tokens; }
 
     switch(num_tokens)
     {
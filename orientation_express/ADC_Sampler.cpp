@@ -3,9 +3,42 @@
 
 namespace
 {
+    struct channel_state_t
+    {
+        adc_channel_t config;
+
+        // ADC input number (MUXPOS) for config.pin
+        uint32_t mux;
+
+        // register values for resolution and hardware averaging
+        uint8_t ressel;
+        uint8_t avgctrl;
+
+        // timer ticks since last sample
+        uint32_t ticks;
+
+        volatile uint32_t value;
+        volatile uint32_t num_samples;
+    };
+
     adc_callback_t g_adc_callback = nullptr;
-    uint8_t g_sample_pin = 0;
-    uint32_t g_sample_rate = 0;
+    uint32_t g_sample_rate = 22050;
+    adc_config_t g_adc_config = g_adc_default_config;
+
+    // currently applied resolution settings
+    uint8_t g_ressel = ADC_CTRLB_RESSEL_10BIT_Val;
+    uint8_t g_avgctrl = 0;
+
+    channel_state_t g_channels[ADC_Sampler::s_max_num_channels];
+    uint8_t g_num_channels = 0;
+
+    // bitmask for channels due for conversion
+    volatile uint32_t g_pending = 0;
+
+    // channel with a running conversion, -1 when idle
+    volatile int8_t g_current_channel = -1;
+
+    volatile uint32_t g_num_overruns = 0;
 };
 
 static __inline__ void adc_sync() __attribute__((always_inline, unused));
@@ -49,6 +82,83 @@ static inline void adc_enable()
 void adc_configure();
 void tc_configure();
 
+//! CTRLB.RESSEL and AVGCTRL register values for a resolution
+static void adc_resolution_regs(uint8_t the_resolution, uint8_t *the_ressel, uint8_t *the_avgctrl)
+{
+    // oversampling 4^n samples yields n additional bits. results of more than 16 samples
+    // are right-shifted by (SAMPLENUM - 4) in hardware, ADJRES fixes up the rest
+    switch(adc_valid_resolution(the_resolution))
+    {
+        case 8:
+            *the_ressel = ADC_CTRLB_RESSEL_8BIT_Val;
+            *the_avgctrl = 0;
+            break;
+        case 12:
+            *the_ressel = ADC_CTRLB_RESSEL_12BIT_Val;
+            *the_avgctrl = 0;
+            break;
+        case 13:
+            *the_ressel = ADC_CTRLB_RESSEL_16BIT_Val;
+            *the_avgctrl = ADC_AVGCTRL_SAMPLENUM_4 | ADC_AVGCTRL_ADJRES(1);
+            break;
+        case 14:
+            *the_ressel = ADC_CTRLB_RESSEL_16BIT_Val;
+            *the_avgctrl = ADC_AVGCTRL_SAMPLENUM_16 | ADC_AVGCTRL_ADJRES(2);
+            break;
+        case 15:
+            *the_ressel = ADC_CTRLB_RESSEL_16BIT_Val;
+            *the_avgctrl = ADC_AVGCTRL_SAMPLENUM_64 | ADC_AVGCTRL_ADJRES(1);
+            break;
+        case 16:
+            *the_ressel = ADC_CTRLB_RESSEL_16BIT_Val;
+            *the_avgctrl = ADC_AVGCTRL_SAMPLENUM_256 | ADC_AVGCTRL_ADJRES(0);
+            break;
+        default:
+            *the_ressel = ADC_CTRLB_RESSEL_10BIT_Val;
+            *the_avgctrl = 0;
+            break;
+    }
+}
+
+//! select input for the_channel and trigger a conversion, result arrives in ADC_Handler
+static inline void adc_start(uint8_t the_channel)
+{
+    const channel_state_t &channel = g_channels[the_channel];
+    g_current_channel = the_channel;
+
+    // only touch resolution settings, when they differ from the last conversion
+    if(channel.ressel != g_ressel)
+    {
+        adc_sync();
+        ADC->CTRLB.bit.RESSEL = g_ressel = channel.ressel;
+    }
+    if(channel.avgctrl != g_avgctrl)
+    {
+        adc_sync();
+        ADC->AVGCTRL.reg = g_avgctrl = channel.avgctrl;
+    }
+
+    adc_sync();
+    ADC->INPUTCTRL.bit.MUXPOS = channel.mux;
+
+    adc_sync();
+    ADC->SWTRIG.bit.START = 1;
+}
+
+//! start a conversion for the pending channel with highest priority, if any
+static inline void adc_start_pending()
+{
+    uint32_t pending = g_pending;
+
+    if(pending)
+    {
+        uint8_t i = 0;
+        while(!(pending & (1 << i))){ ++i; }
+        adc_start(i);
+    }
+    else{ g_current_channel = -1; }
+}
+
 uint32_t adc_read(uint8_t the_pin)
 {
     // Selection for the positive ADC input
@@ -86,20 +196,33 @@ void adc_configure()
     // adc_sync();
     // ADC->INPUTCTRL.bit.GAIN = ADC_INPUTCTRL_GAIN_8X_Val;
 
-    // single conversion no averaging
+    // single conversion no averaging, channels with higher resolution apply their own settings
     adc_sync();
-    ADC->AVGCTRL.reg = 0x00;
+    ADC->AVGCTRL.reg = g_avgctrl = 0x00;
 
     adc_sync();
-    ADC->CTRLB.bit.RESSEL = ADC_CTRLB_RESSEL_10BIT_Val;
+    ADC->CTRLB.bit.RESSEL = g_ressel = ADC_CTRLB_RESSEL_10BIT_Val;
+
+    // prescaler DIV4 ... DIV512 -> register values 0 ... 7
+    uint8_t prescaler = 0;
+    while(prescaler < ADC_CTRLB_PRESCALER_DIV512_Val &&
+          (4U << prescaler) < g_adc_config.prescaler){ prescaler++; }
 
-    // Divide Clock by 8 -> ~100kHz
     adc_sync();
-    ADC->CTRLB.bit.PRESCALER = ADC_CTRLB_PRESCALER_DIV8_Val;
+    ADC->CTRLB.bit.PRESCALER = prescaler;
 
     // sample length in 1/2 CLK_ADC cycles. default: 3F
     adc_sync();
-    ADC->SAMPCTRL.reg = 0x2F;
+    ADC->SAMPCTRL.reg = g_adc_config.sample_length & 0x3F;
+
+    // result-ready interrupt drives the channel scan
+    ADC->INTFLAG.reg = ADC_INTFLAG_RESRDY;
+    ADC->INTENSET.bit.RESRDY = 1;
+
+    NVIC_DisableIRQ(ADC_IRQn);
+    NVIC_ClearPendingIRQ(ADC_IRQn);
+    NVIC_SetPriority(ADC_IRQn, 0x00);
+    NVIC_EnableIRQ(ADC_IRQn);
 }
 
 void tc_configure(uint32_t the_sample_rate)
@@ -136,12 +259,47 @@ void tc_configure(uint32_t the_sample_rate)
 
 void TC5_Handler(void)
 {
-    auto v = adc_read(g_sample_pin);
+    uint32_t due = 0;
+
+    for(uint8_t i = 0; i < g_num_channels; ++i)
+    {
+        if(++g_channels[i].ticks >= g_channels[i].config.decimation)
+        {
+            g_channels[i].ticks = 0;
+            due |= 1 << i;
+        }
+    }
+
+    // a channel is due again before its last conversion even started
+    if(g_pending & due){ g_num_overruns++; }
+    g_pending |= due;
+
+    // ADC idle -> kick off a new scan
+    if(g_current_channel < 0){ adc_start_pending(); }
 
     // Clear interrupt
     TC5->COUNT16.INTFLAG.bit.MC0 = 1;
+}
+
+void ADC_Handler(void)
+{
+    // reading the result also clears the RESRDY flag
+    uint32_t value = ADC->RESULT.reg;
+    int8_t index = g_current_channel;
 
-    if(g_adc_callback){ (*g_adc_callback)(v); }
+    if(index >= 0)
+    {
+        channel_state_t &channel = g_channels[index];
+        channel.value = value;
+        channel.num_samples++;
+        g_pending &= ~(1 << index);
+
+        // chain the next conversion before running user-code
+        adc_start_pending();
+
+        if(channel.config.callback){ (*channel.config.callback)(value); }
+    }
+    else{ ADC->INTFLAG.reg = ADC_INTFLAG_RESRDY; }
 }
 
 ADC_Sampler::ADC_Sampler(){}
@@ -153,8 +311,51 @@ ADC_Sampler::~ADC_Sampler()
 
 void ADC_Sampler::begin(int the_pin, uint32_t the_sample_rate)
 {
-    g_sample_pin = the_pin;
-    analogRead(the_pin);
+    adc_channel_t channel = {(uint8_t)the_pin, 1, g_adc_callback, 10};
+    begin(&channel, 1, the_sample_rate);
+}
+
+void ADC_Sampler::begin(const adc_channel_t *the_channels, uint8_t the_num_channels,
+                        uint32_t the_sample_rate, const adc_config_t &the_config)
+{
+    tc_disable();
+    g_num_channels = 0;
+    g_pending = 0;
+    g_current_channel = -1;
+    g_num_overruns = 0;
+    g_adc_config = the_config;
+
+    if(the_num_channels > s_max_num_channels){ the_num_channels = s_max_num_channels; }
+
+    uint8_t resolutions[s_max_num_channels];
+    uint32_t decimations[s_max_num_channels];
+
+    for(uint8_t i = 0; i < the_num_channels; ++i)
+    {
+        channel_state_t &channel = g_channels[i];
+        channel.config = the_channels[i];
+        if(!channel.config.decimation){ channel.config.decimation = 1; }
+        channel.mux = g_APinDescription[channel.config.pin].ulADCChannelNumber;
+        channel.config.resolution = adc_valid_resolution(channel.config.resolution);
+        adc_resolution_regs(channel.config.resolution, &channel.ressel, &channel.avgctrl);
+
+        // sample every channel on the first tick
+        channel.ticks = channel.config.decimation - 1;
+        channel.value = 0;
+        channel.num_samples = 0;
+
+        // configures pin-mux for analog input
+        analogRead(channel.config.pin);
+        g_num_channels++;
+
+        resolutions[i] = channel.config.resolution;
+        decimations[i] = channel.config.decimation;
+    }
+
+    // faster than the channels can be converted on average, every tick would add to the overruns
+    float max_rate = adc_max_scan_rate(the_config, resolutions, decimations, g_num_channels);
+    if(max_rate > 0.f && the_sample_rate > max_rate){ the_sample_rate = max_rate; }
+
     adc_disable();
     adc_configure();
     adc_enable();
@@ -164,12 +365,37 @@ void ADC_Sampler::begin(int the_pin, uint32_t the_sample_rate)
 
 void ADC_Sampler::end()
 {
+    NVIC_DisableIRQ(ADC_IRQn);
+    ADC->INTENCLR.bit.RESRDY = 1;
     adc_disable();
     tc_disable();
     tc_reset();
+    g_pending = 0;
+    g_current_channel = -1;
 }
 
 void ADC_Sampler::set_adc_callback(adc_callback_t the_callback)
 {
     g_adc_callback = the_callback;
+    g_channels[0].config.callback = the_callback;
+}
+
+uint32_t ADC_Sampler::value(uint8_t the_channel) const
+{
+    return the_channel < g_num_channels ? g_channels[the_channel].value : 0;
+}
+
+uint32_t ADC_Sampler::num_samples(uint8_t the_channel) const
+{
+    return the_channel < g_num_channels ? g_channels[the_channel].num_samples : 0;
+}
+
+uint32_t ADC_Sampler::num_overruns() const
+{
+    return g_num_overruns;
+}
+
+uint32_t ADC_Sampler::sample_rate() const
+{
+    return g_sample_rate;
 }
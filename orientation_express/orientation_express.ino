@@ -31,6 +31,10 @@
 #define POTI_PIN A1
 
 #define ADC_BITS 10
+
+// poti uses hardware oversampling
+#define ADC_BITS_SLOW 13
+
 const float ADC_MAX = (1 << ADC_BITS) - 1.f;
 
 // #define ARM_MATH_CM0
@@ -50,6 +54,10 @@ float g_mic_lvl = 0.f; // 0.0 ... 1.0
 
 ADC_Sampler g_adc_sampler;
 
+// scanned ADC channels, mic at full rate, poti at 50Hz
+constexpr uint32_t g_adc_sample_rate = 22050;
+enum AdcChannel{ ADC_CHANNEL_MIC = 0, ADC_CHANNEL_POTI = 1 };
+
 //! time management
 const uint32_t g_update_interval_params = 2000;
 uint32_t g_time_accum = 0, g_time_accum_params = 0;
@@ -276,8 +284,12 @@ void setup()
     analogReadResolution(ADC_BITS);
     digitalWrite(13, LOW);
 
-    g_adc_sampler.set_adc_callback(&adc_callback);
-    g_adc_sampler.begin(MIC_PIN, 22050);
+    const adc_channel_t adc_channels[] =
+    {
+        {MIC_PIN, 1, &adc_callback, ADC_BITS},
+        {POTI_PIN, g_adc_sample_rate / 50, nullptr, ADC_BITS_SLOW}
+    };
+    g_adc_sampler.begin(adc_channels, 2, g_adc_sample_rate);
 }
 
 void loop()
@@ -303,14 +315,10 @@ void loop()
     {
         g_time_accum = 0;
 
-        float gain = 12.f;
-        uint32_t pot_val = 0;
-        {
-            // scope is interrupt free
-            no_interrupt ni;
-            pot_val = adc_read(POTI_PIN);
-            gain = map_value<float>(pot_val, 145, 885, 0.f, 12.f);
-        }
+        // poti is scanned in the background by g_adc_sampler, oversampled to ADC_BITS_SLOW
+        float pot_val = g_adc_sampler.value(ADC_CHANNEL_POTI) /
+                        (float)(1 << (ADC_BITS_SLOW - ADC_BITS));
+        float gain = map_value<float>(pot_val, 145, 885, 0.f, 12.f);
         float val = smoothstep(0.f, 1.f, clamp<float>(g_mic_lvl * gain, 0.f, 1.f));
         int num_leds = val * NUM_LEDS;
 
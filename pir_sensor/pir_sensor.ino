@@ -3,6 +3,7 @@
 * light an indicator-LED, send status via Serial
 */
 #include "RunningMedian.h"
+#include "CommandParser.h"
 
 #define CMD_QUERY_ID "ID"
 #define CMD_START "START"
@@ -19,6 +20,9 @@ const uint8_t g_pir_pins[g_num_pirs] = {6};
 
 char g_serial_buf[512];
 
+// incoming text-commands
+kinski::LineBuffer<128> g_serial_lines;
+
 enum State
 {
     STATE_INACTIVE = 0,
@@ -101,55 +105,29 @@ void loop()
     digitalWrite(LED_PIN, g_state_buf);
 }
 
-template <typename T> void process_serial_input(T& the_serial)
+void cmd_query_id(Print &the_device, kinski::Args &the_args)
 {
-    uint16_t buf_idx = 0;
-
-    while(the_serial.available())
-    {
-        // get the new byte:
-        char c = the_serial.read();
-
-        switch(c)
-        {
-            case '\r':
-            case '\0':
-                continue;
-
-            case '\n':
-                g_serial_buf[buf_idx] = '\0';
-                buf_idx = 0;
-                parse_line(g_serial_buf);
-                break;
-
-            default:
-                g_serial_buf[buf_idx++] = c;
-                break;
-        }
-    }
+    char buf[32];
+    sprintf(buf, "%s %s\n", CMD_QUERY_ID, DEVICE_ID);
+    the_device.write(buf);
 }
 
-bool check_for_cmd(const char* the_str)
+//! sorted by name
+constexpr kinski::command_t<Print> g_commands[] =
 {
-    if(strcmp(the_str, CMD_QUERY_ID) == 0)
-    {
-        char buf[32];
-        sprintf(buf, "%s %s\n", the_str, DEVICE_ID);
-        Serial.write(buf);
-        return true;
-    }
-    return false;
-}
+    {CMD_QUERY_ID, &cmd_query_id}
+};
+static_assert(kinski::is_sorted(g_commands), "command-table must be sorted by name");
 
-void parse_line(char *the_line)
+template <typename T> void process_serial_input(T& the_serial)
 {
-    const char* delim = " ";
-    char *token = strtok(the_line, delim);
-    uint16_t i = 0;
-
-    while(token)
+    // partial lines are kept in g_serial_lines until their newline arrives
+    while(the_serial.available())
     {
-        if(check_for_cmd(token)){ break; }
-        token = strtok(nullptr, delim);
+        if(g_serial_lines.feed(the_serial.read()))
+        {
+            kinski::dispatch_command(g_commands, the_serial, g_serial_lines.line(),
+                                     g_serial_lines.length());
+        }
     }
 }
@@ -1,72 +1,66 @@
 #include "LED_Tunnel.h"
 #include "utils.h"
 
-//! the default-value will cause no brightness adjustment
-uint8_t g_brightness = 150;
+//! scales gamma-corrected output, 255 -> full brightness
+uint8_t g_brightness = 30;
 
 Tunnel::Tunnel()
 {
     memset(m_strips, 0, sizeof(m_strips));
+    update_output_lut();
 }
 
-void Tunnel::init()
+bool Tunnel::init()
 {
-    for(uint8_t i = 0; i < g_num_pins; ++i)
+    for(uint8_t i = 0; i < g_num_strips; ++i)
     {
         if(m_strips[i]){ delete m_strips[i]; m_strips[i] = nullptr; }
     }
-
-    m_strips[0] = new Adafruit_NeoPixel(m_num_gates * 15, g_led_pins[0], NEO_GRBW + NEO_KHZ800);
-    // m_strips[1] = new Adafruit_NeoPixel(42 + 34 + 42, g_led_pins[1], NEO_GRBW + NEO_KHZ800);
-    // m_strips[2] = new Adafruit_NeoPixel(6 * 3 * 42, g_led_pins[2], NEO_GRBW + NEO_KHZ800);
-    uint8_t* data_start[g_num_pins];
+    uint8_t* data_start[g_num_strips];
+    bool success = true;
 
     char buf[128], *ptr = buf;
 
-    for(uint8_t i = 0; i < g_num_pins; ++i)
+    for(uint8_t i = 0; i < g_num_strips; ++i)
     {
-        m_strips[i]->begin();
-        m_strips[i]->setBrightness(50);
+        m_strips[i] = new LedType(g_strip_config[i].num_leds, g_strip_config[i].pin,
+                                  NEO_GRBW + NEO_KHZ800);
+
+        // no free SERCOM or DMA-channel for this pin, or out of memory
+        if(!m_strips[i]->begin() || !m_strips[i]->getPixels())
+        {
+            delete m_strips[i];
+            m_strips[i] = nullptr;
+            data_start[i] = nullptr;
+            success = false;
+            ptr += sprintf(ptr, "strip[%d]: failed on pin %d\n", i, g_strip_config[i].pin);
+            continue;
+        }
+        m_strips[i]->setBrightness(255); // brightness is part of m_output_lut
         m_strips[i]->show(); // Initialize all pixels to 'off'
         data_start[i] = (uint8_t*)m_strips[i]->getPixels();
         ptr += sprintf(ptr, "strip[%d]: %d\n", i, (int)data_start[i]);
     }
     Serial.write(buf);
 
-    const size_t gate_num_bytes = 15 * sizeof(uint32_t);
+    m_num_gates = g_num_gates;
 
-    for(int i = 0; i < m_num_gates; ++i)
+    // gates on a failed strip stay empty
+    for(uint32_t i = 0; i < m_num_gates; ++i)
     {
-        m_gates[i] = Gate(data_start[0] + i * gate_num_bytes, 5, 5, 5, Gate::NORMAL);
+        const gate_config_t &cfg = g_gate_config[i];
+        m_gates[i] = data_start[cfg.strip] ?
+            Gate(data_start[cfg.strip] + cfg.offset * sizeof(uint32_t),
+                 cfg.num_left, cfg.num_top, cfg.num_right, cfg.direction) : Gate();
     }
 
-    // PIN 10
-    // m_gates[0] = Gate(data_start[0] + 5 * gate_num_bytes, 42, 42, 42, Gate::REVERSE);
-    // m_gates[1] = Gate(data_start[0] + 4 * gate_num_bytes, 42, 42, 42, Gate::NORMAL);
-    // m_gates[2] = Gate(data_start[0] + 3 * gate_num_bytes, 42, 42, 42, Gate::REVERSE);
-    // m_gates[3] = Gate(data_start[0] + 2 * gate_num_bytes, 42, 42, 42, Gate::NORMAL);
-    // m_gates[4] = Gate(data_start[0] + 1 * gate_num_bytes, 42, 42, 42, Gate::REVERSE);
-    // m_gates[5] = Gate(data_start[0] + 0 * gate_num_bytes, 42, 42, 42, Gate::NORMAL);
-    //
-    // // PIN 11
-    // m_gates[6] = Gate(data_start[1], 42, 34, 42, Gate::NORMAL);
-    //
-    // // PIN 12
-    // m_gates[7] = Gate(data_start[2] + 0 * gate_num_bytes, 42, 42, 42, Gate::NORMAL);
-    // m_gates[8] = Gate(data_start[2] + 1 * gate_num_bytes, 42, 42, 42, Gate::REVERSE);
-    // m_gates[9] = Gate(data_start[2] + 2 * gate_num_bytes, 42, 42, 42, Gate::NORMAL);
-    // m_gates[10] = Gate(data_start[2] + 3 * gate_num_bytes, 42, 42, 42, Gate::REVERSE);
-    // m_gates[11] = Gate(data_start[2] + 4 * gate_num_bytes, 42, 42, 42, Gate::NORMAL);
-    // m_gates[12] = Gate(data_start[2] + 5 * gate_num_bytes, 42, 42, 42, Gate::REVERSE);
-
     m_num_leds = 0;
     for(uint32_t i = 0; i < m_num_gates; ++i){ m_num_leds += m_gates[i].num_leds(); }
-    if(m_pixel_time_buf){ delete[] m_pixel_time_buf; }
-    m_pixel_time_buf = new unsigned long[m_num_leds];
-    memset(m_pixel_time_buf, 0, m_num_leds * sizeof(unsigned long));
+    m_num_sparkles = 0;
 
     sprintf(buf, "num leds: %d\n", m_num_leds);
     Serial.write(buf);
+    return success;
 }
 
 uint8_t Tunnel::brightness() const
@@ -76,7 +70,17 @@ uint8_t Tunnel::brightness() const
 
 void Tunnel::set_brightness(uint8_t the_brightness)
 {
+    if(the_brightness == g_brightness){ return; }
     g_brightness = the_brightness;
+    update_output_lut();
+}
+
+void Tunnel::update_output_lut()
+{
+    for(uint32_t i = 0; i < 256; ++i)
+    {
+        m_output_lut[i] = (g_gamma[i] * (g_brightness + 1)) >> 8;
+    }
 }
 
 void Tunnel::clear()
@@ -87,40 +91,93 @@ void Tunnel::clear()
     }
 }
 
-void Tunnel::add_random_pixels(uint16_t the_count, uint32_t the_delay_millis)
+void Tunnel::add_random_pixels(uint16_t the_count, uint32_t the_delay_millis,
+                               uint32_t the_color)
 {
-    if(!m_pixel_time_buf){ return; }
+    if(!m_num_leds){ return; }
     unsigned long time_stamp = millis();
 
-    for(uint16_t i = 0; i < the_count; ++i)
+    for(uint16_t i = 0; i < the_count && m_num_sparkles < s_max_num_sparkles; ++i)
     {
-        int rnd_index = random<int>(0, m_num_leds);
-        int rnd_time = random<int>(0, the_delay_millis / 2);
-        m_pixel_time_buf[rnd_index] = time_stamp + the_delay_millis + rnd_time;
+        uint32_t rnd_index = random<uint32_t>(0, m_num_leds - 1);
+        uint32_t rnd_time = random<uint32_t>(0, the_delay_millis / 2);
+
+        // global pixel-index -> gate / led
+        uint8_t gate = 0;
+        while(rnd_index >= m_gates[gate].num_leds()){ rnd_index -= m_gates[gate++].num_leds(); }
+
+        sparkle_t &s = m_sparkles[m_num_sparkles++];
+        s.birth = time_stamp;
+        s.lifetime = the_delay_millis + rnd_time < 0xFFFF ? the_delay_millis + rnd_time : 0xFFFF;
+        s.led = rnd_index;
+        s.gate = gate;
+        s.color = the_color;
+    }
+}
+
+void Tunnel::set_pixel_layout(float the_gate_start, float the_gate_step, float the_arch_lag)
+{
+    m_gate_start = the_gate_start;
+    m_gate_step = the_gate_step;
+    m_arch_lag = the_arch_lag;
+}
+
+void Tunnel::pixel_positions(uint32_t the_gate, float *the_positions) const
+{
+    if(the_gate >= m_num_gates){ return; }
+    const Gate &gate = m_gates[the_gate];
+    float gate_pos = m_gate_start + the_gate * m_gate_step;
+
+    gate.pixel_heights(the_positions);
+
+    for(uint32_t i = 0; i < gate.num_leds(); ++i)
+    {
+        the_positions[i] = gate_pos + m_arch_lag * the_positions[i];
     }
 }
 
 void Tunnel::update(uint32_t the_delta_time)
 {
-    uint32_t pix_idx = 0;
     uint32_t time_stamp = millis();
 
-    // iterate timestamp array and set pixel colors
-    for(uint32_t i = 0; i < m_num_gates; ++i)
+    // only live sparkles are touched, expired ones are swap-removed
+    for(uint32_t i = 0; i < m_num_sparkles;)
     {
-        uint32_t num_gate_leds = m_gates[i].num_leds();
-        uint32_t *gate_data = (uint32_t*)m_gates[i].data();
+        sparkle_t &s = m_sparkles[i];
+        uint32_t age = time_stamp - s.birth;
 
-        for(uint32_t j = 0; j < num_gate_leds; ++j)
+        if(age >= s.lifetime)
         {
-            if(m_pixel_time_buf[pix_idx] > time_stamp)
-            {
-                gate_data[j] = gate_data[j] ? color_add(gate_data[j], ORANGE) : ORANGE;
-            }
-            pix_idx++;
+            s = m_sparkles[--m_num_sparkles];
+            continue;
         }
+
+        // linear fade in and out, both limited to half the lifetime
+        uint32_t half_life = s.lifetime / 2, fade_in = s_sparkle_fade_in_millis,
+            fade_out = s_sparkle_fade_out_millis;
+        if(fade_in > half_life){ fade_in = half_life; }
+        if(fade_out > half_life){ fade_out = half_life; }
+        uint32_t remaining = s.lifetime - age;
+        float envelope = 1.f;
+
+        if(age < fade_in){ envelope = (float)age / fade_in; }
+        else if(remaining < fade_out){ envelope = (float)remaining / fade_out; }
+
+        uint32_t *pixel = (uint32_t*)m_gates[s.gate].data() + s.led;
+        uint32_t color = fade_color(s.color, envelope);
+        *pixel = *pixel ? color_add(*pixel, color) : color;
+        ++i;
     }
-    for(int i = 0; i < g_num_pins; ++i){ m_strips[i]->show(); }
+    // linear -> output, one pass over all channel-bytes
+    for(uint32_t i = 0; i < m_num_gates; ++i)
+    {
+        uint8_t *ptr = (uint8_t*)m_gates[i].data(),
+            *end_ptr = ptr + m_gates[i].num_leds() * sizeof(uint32_t);
+        for(; ptr < end_ptr; ++ptr){ *ptr = m_output_lut[*ptr]; }
+    }
+
+    // DMA transfers, strips are sent in parallel
+    for(int i = 0; i < g_num_strips; ++i){ if(m_strips[i]){ m_strips[i]->show(); } }
 }
 
 Gate::Gate():
@@ -140,6 +197,45 @@ m_direction(the_dir)
     m_seq_length[2] = num_right;
 }
 
+void Gate::pixel_heights(float *the_heights) const
+{
+    if(!m_num_leds){ return; }
+
+    // physical order, starting at the bottom of the left sequence, one divide per sequence
+    int32_t step = 1;
+    if(m_direction == REVERSE){ the_heights += m_num_leds - 1; step = -1; }
+
+    float inc = m_seq_length[LEFT] ? 1.f / m_seq_length[LEFT] : 0.f, h = .5f * inc;
+    for(uint32_t i = 0; i < m_seq_length[LEFT]; ++i, h += inc, the_heights += step)
+    {
+        *the_heights = h;
+    }
+    for(uint32_t i = 0; i < m_seq_length[TOP]; ++i, the_heights += step){ *the_heights = 1.f; }
+
+    inc = m_seq_length[RIGHT] ? 1.f / m_seq_length[RIGHT] : 0.f;
+    h = 1.f - .5f * inc;
+    for(uint32_t i = 0; i < m_seq_length[RIGHT]; ++i, h -= inc, the_heights += step)
+    {
+        *the_heights = h;
+    }
+}
+
+void Gate::set_pixels_faded(uint32_t the_color, const float *the_intensities)
+{
+    uint32_t *ptr = (uint32_t*)m_data, *end_ptr = ptr + m_num_leds;
+
+    for(; ptr < end_ptr; ++ptr, ++the_intensities)
+    {
+        *ptr = fade_color(the_color, *the_intensities);
+    }
+}
+
+void Gate::set_pixels_mapped(const uint32_t *the_palette, const uint8_t *the_values)
+{
+    uint32_t *ptr = (uint32_t*)m_data, *end_ptr = ptr + m_num_leds;
+    for(; ptr < end_ptr; ++ptr, ++the_values){ *ptr = the_palette[*the_values >> 2]; }
+}
+
 void Gate::set_pixel(uint32_t the_index, uint32_t the_color)
 {
     if(m_data && the_index < m_num_leds)
@@ -147,7 +243,6 @@ void Gate::set_pixel(uint32_t the_index, uint32_t the_color)
         the_index = m_direction == NORMAL ?
             the_index : (m_num_leds - 1 - the_index);
 
-        the_color = fade_color(the_color, g_brightness / 255.f);
         uint32_t *ptr = (uint32_t*)m_data;
         ptr[the_index] = the_color;
     }
@@ -156,7 +251,6 @@ void Gate::set_pixel(uint32_t the_index, uint32_t the_color)
 void Gate::set_all_pixels(uint32_t the_color)
 {
     if(!m_data) return;
-    the_color = fade_color(the_color, g_brightness / 255.f);
     uint32_t *ptr = (uint32_t*)m_data,
     *end_ptr = ptr + m_num_leds;
 
@@ -1,10 +1,10 @@
-#include <Adafruit_NeoPixel.h>
-#ifdef __AVR__
-  #include <avr/power.h>
-#endif
+#include <Adafruit_NeoPixel_ZeroDMA.h>
+
+//! strips are driven by DMA, so show() returns immediately and all strips transmit concurrently
+using LedType = Adafruit_NeoPixel_ZeroDMA;
 
-const uint8_t g_num_pins = 1;
-const uint8_t g_led_pins[] = {6};
+// uncomment for the 13-gate build on 3 strips
+// #define TUNNEL_FULL_BUILD
 
 class Gate;
 class Tunnel;
@@ -54,6 +54,22 @@ public:
 
     const uint16_t num_leds() const { return m_num_leds; }
 
+    //! number of pixels for LEFT, TOP or RIGHT sequence
+    const uint16_t seq_length(Sequment the_seq) const { return the_seq < ALL ? m_seq_length[the_seq] : m_num_leds; }
+
+    const Direction direction() const { return m_direction; }
+
+    /*! relative heights for all pixels (data order) in range [0, 1],
+     *  rising along the LEFT sequence, 1 on TOP, falling along RIGHT
+     */
+    void pixel_heights(float *the_heights) const;
+
+    //! set all pixels to the_color, faded by per-pixel intensities (data order)
+    void set_pixels_faded(uint32_t the_color, const float *the_intensities);
+
+    //! set all pixels from a 64-entry palette, indexed by the upper 6 bits of per-pixel values
+    void set_pixels_mapped(const uint32_t *the_palette, const uint8_t *the_values);
+
 private:
     uint8_t *m_data = nullptr;
     uint16_t m_num_leds = 0;
@@ -61,29 +77,188 @@ private:
     Direction m_direction = NORMAL;
 };
 
+/*! a LED-strip on a single (DMA-capable) pin. each strip needs a SERCOM of its own,
+ *  so pins have to be picked from distinct SERCOMs
+ */
+struct strip_config_t
+{
+    uint8_t pin;
+    uint16_t num_leds;
+};
+
+//! a gate, occupying a range of pixels on one of the strips
+struct gate_config_t
+{
+    uint8_t strip;
+    uint16_t offset;
+    uint16_t num_left, num_top, num_right;
+    Gate::Direction direction;
+};
+
+#ifdef TUNNEL_FULL_BUILD
+
+/*  Feather M0: D10-D13 only reach SERCOM1 and SERCOM3, so they can't drive three strips.
+ *  D5 -> SERCOM2, D6 -> SERCOM5, SDA -> SERCOM3 (no I2C in this build),
+ *  SERCOM0 and SERCOM4 stay with Serial1 and SPI
+ */
+constexpr strip_config_t g_strip_config[] =
+{
+    {5, 6 * 126}, {6, 42 + 34 + 42}, {PIN_WIRE_SDA, 6 * 126}
+};
+
+// gates in tunnel order
+constexpr gate_config_t g_gate_config[] =
+{
+    {0, 5 * 126, 42, 42, 42, Gate::REVERSE},
+    {0, 4 * 126, 42, 42, 42, Gate::NORMAL},
+    {0, 3 * 126, 42, 42, 42, Gate::REVERSE},
+    {0, 2 * 126, 42, 42, 42, Gate::NORMAL},
+    {0, 1 * 126, 42, 42, 42, Gate::REVERSE},
+    {0, 0 * 126, 42, 42, 42, Gate::NORMAL},
+    {1, 0, 42, 34, 42, Gate::NORMAL},
+    {2, 0 * 126, 42, 42, 42, Gate::NORMAL},
+    {2, 1 * 126, 42, 42, 42, Gate::REVERSE},
+    {2, 2 * 126, 42, 42, 42, Gate::NORMAL},
+    {2, 3 * 126, 42, 42, 42, Gate::REVERSE},
+    {2, 4 * 126, 42, 42, 42, Gate::NORMAL},
+    {2, 5 * 126, 42, 42, 42, Gate::REVERSE}
+};
+
+#else
+
+constexpr strip_config_t g_strip_config[] = { {6, 16 * 15} };
+
+// gates in tunnel order
+constexpr gate_config_t g_gate_config[] =
+{
+    {0, 0 * 15, 5, 5, 5, Gate::NORMAL}, {0, 1 * 15, 5, 5, 5, Gate::NORMAL},
+    {0, 2 * 15, 5, 5, 5, Gate::NORMAL}, {0, 3 * 15, 5, 5, 5, Gate::NORMAL},
+    {0, 4 * 15, 5, 5, 5, Gate::NORMAL}, {0, 5 * 15, 5, 5, 5, Gate::NORMAL},
+    {0, 6 * 15, 5, 5, 5, Gate::NORMAL}, {0, 7 * 15, 5, 5, 5, Gate::NORMAL},
+    {0, 8 * 15, 5, 5, 5, Gate::NORMAL}, {0, 9 * 15, 5, 5, 5, Gate::NORMAL},
+    {0, 10 * 15, 5, 5, 5, Gate::NORMAL}, {0, 11 * 15, 5, 5, 5, Gate::NORMAL},
+    {0, 12 * 15, 5, 5, 5, Gate::NORMAL}, {0, 13 * 15, 5, 5, 5, Gate::NORMAL},
+    {0, 14 * 15, 5, 5, 5, Gate::NORMAL}, {0, 15 * 15, 5, 5, 5, Gate::NORMAL}
+};
+
+#endif
+
+const uint8_t g_num_strips = sizeof(g_strip_config) / sizeof(strip_config_t);
+const uint8_t g_num_gates = sizeof(g_gate_config) / sizeof(gate_config_t);
+
+//! pixel-count of the largest gate, sizes the per-gate scratch-buffers used for rendering
+constexpr uint16_t max_gate_leds(uint32_t the_index = 0)
+{
+    return the_index >= g_num_gates ? 0 :
+        (g_gate_config[the_index].num_left + g_gate_config[the_index].num_top +
+         g_gate_config[the_index].num_right > max_gate_leds(the_index + 1) ?
+         g_gate_config[the_index].num_left + g_gate_config[the_index].num_top +
+         g_gate_config[the_index].num_right : max_gate_leds(the_index + 1));
+}
+
+/*! RAM held by the ZeroDMA-driver: per RGBW pixel 4 bytes of pixel-data plus
+ *  12 bytes for its SPI-encoded copy, and ~100 bytes of preamble and latch per strip
+ */
+constexpr uint32_t strip_ram_bytes(uint32_t the_index = 0)
+{
+    return the_index >= g_num_strips ? 0 :
+        16 * g_strip_config[the_index].num_leds + 100 + strip_ram_bytes(the_index + 1);
+}
+
+/*  RAM budget (SAMD21, 32KB), estimated from allocation sizes, no link-map:
+ *    strips (1630 pixels, full build)        ~25.8KB
+ *    core, USB-CDC and UART buffers           ~2.5KB
+ *    Tunnel (48 sparkles, lut, gates)         ~1.3KB
+ *    WaveSimulation(16), Nebula, palette      ~1.2KB
+ *    stack, incl. per-gate scratch (126 px)   ~1.5KB
+ *  there is no room for per-pixel buffers besides the strips', so positions, intensities and
+ *  noise-values are computed gate by gate into small buffers on the stack
+ */
+static_assert(strip_ram_bytes() <= 26 * 1024, "LED-strips exceed their RAM budget");
+
 class Tunnel
 {
 public:
 
     Tunnel();
 
-    void init();
+    //! create and start all strips, false if a strip failed to start (reported on Serial)
+    bool init();
+
+    //! global brightness, applied together with g_gamma when a frame is sent
     uint8_t brightness() const;
     void set_brightness(uint8_t the_brightness);
+
     void clear();
-    void add_random_pixels(uint16_t the_count, uint32_t the_delay_millis);
+
+    /*! spawn the_count sparkles on random pixels, each living the_delay_millis plus
+     *  a random extra of up to half that time. dropped when the sparkle-pool is full
+     */
+    void add_random_pixels(uint16_t the_count, uint32_t the_delay_millis,
+                           uint32_t the_color = ORANGE);
+
+    //! number of currently live sparkles
+    uint32_t num_sparkles() const { return m_num_sparkles; }
 
     Gate* gates(){ return m_gates; }
     const uint16_t num_gates() const { return m_num_gates; }
+    const uint32_t num_leds() const { return m_num_leds; }
+
+    /*! add sparkles, map the composed frame through gamma and brightness and send it.
+     *  pixel-buffers hold linear, full-scale colours until then and are mapped in place,
+     *  so a new frame has to be composed before the next call
+     */
     void update(uint32_t the_delta_time);
 
+    /*! set the physical layout along the tunnel, in meters.
+     *  pixels are shifted by up to the_arch_lag towards the apex of each gate,
+     *  so a passing wave climbs the arches instead of lighting whole gates at once
+     */
+    void set_pixel_layout(float the_gate_start, float the_gate_step, float the_arch_lag);
+
+    /*! positions along the tunnel for all pixels of gate the_gate in data order,
+     *  the_positions has to hold max_gate_leds() values
+     */
+    void pixel_positions(uint32_t the_gate, float *the_positions) const;
+
 private:
 
-    const uint16_t m_num_gates = 16;
-    Gate m_gates[16];
-    Adafruit_NeoPixel* m_strips[1];
+    //! capacity of the sparkle-pool, smaller for the full build to fit its RAM budget
+#ifdef TUNNEL_FULL_BUILD
+    static constexpr uint32_t s_max_num_sparkles = 48;
+#else
+    static constexpr uint32_t s_max_num_sparkles = 128;
+#endif
+
+    //! envelope durations, shortened for short-lived sparkles
+    static constexpr uint32_t s_sparkle_fade_in_millis = 80;
+    static constexpr uint32_t s_sparkle_fade_out_millis = 250;
+
+    struct sparkle_t
+    {
+        uint32_t birth;
+        uint32_t color;
+        uint16_t lifetime;
+        uint16_t led;
+        uint8_t gate;
+    };
+
+    uint16_t m_num_gates = 0;
+    Gate m_gates[g_num_gates];
+    LedType* m_strips[g_num_strips];
+
+    //! rebuild m_output_lut from g_gamma and the current brightness
+    void update_output_lut();
+
+    //! per channel-value mapping for output: g_gamma[v] * brightness / 255
+    uint8_t m_output_lut[256];
+
+    // live sparkles, unordered
+    sparkle_t m_sparkles[s_max_num_sparkles];
+    uint32_t m_num_sparkles = 0;
 
-    // timestamps for every pixel, needed for random blinky
-    unsigned long *m_pixel_time_buf = nullptr;
     uint32_t m_num_leds = 0;
+
+    // physical layout, see set_pixel_layout()
+    float m_gate_start = 0.f, m_gate_step = 1.f, m_arch_lag = 0.f;
 };
@@ -0,0 +1,111 @@
+#include "utils.h"
+#include "Nebula.h"
+
+// 8 gradient directions, (x, y) components
+static const int8_t g_grad[8][2] =
+{
+    {1, 1}, {-1, 1}, {1, -1}, {-1, -1}, {1, 0}, {-1, 0}, {0, 1}, {0, -1}
+};
+
+Nebula::Nebula()
+{
+    // fixed shuffle (LCG), so the nebula looks the same after every boot
+    uint32_t seed = 0x5A17;
+    for(uint32_t i = 0; i < 256; ++i){ m_perm[i] = i; }
+
+    for(uint32_t i = 255; i > 0; --i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        uint32_t j = (seed >> 16) % (i + 1);
+        uint8_t tmp = m_perm[i]; m_perm[i] = m_perm[j]; m_perm[j] = tmp;
+    }
+
+    // quintic fade 6t^5 - 15t^4 + 10t^3
+    for(uint32_t i = 0; i < 256; ++i)
+    {
+        float t = i / 256.f;
+        m_fade[i] = 256.f * t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+    }
+}
+
+void Nebula::update(uint32_t the_delta_time)
+{
+    float delta_secs = the_delta_time / 1000.f;
+    m_x_offset -= m_drift_speed * m_scale * 256.f * delta_secs;
+    m_y_offset += m_evolve_speed * 256.f * delta_secs;
+
+    // keep offsets small, the lattice repeats every 256 cells
+    if(m_x_offset < 0.f){ m_x_offset += 256.f * 256.f; }
+    if(m_y_offset >= 256.f * 256.f){ m_y_offset -= 256.f * 256.f; }
+}
+
+inline int32_t Nebula::eval_octave(octave_t &the_octave, uint32_t the_coord) const
+{
+    uint32_t x = (the_coord << the_octave.shift) + the_octave.x;
+    uint32_t cell = x >> 8;
+    int32_t fx = x & 0xFF;
+
+    // entering another cell, fetch its corner gradients
+    if(cell != the_octave.cell)
+    {
+        the_octave.cell = cell;
+        uint32_t y0 = the_octave.y0;
+        int32_t fy = the_octave.fy;
+        uint8_t h0 = m_perm[cell & 0xFF], h1 = m_perm[(cell + 1) & 0xFF];
+        const int8_t *g00 = g_grad[m_perm[(h0 + y0) & 0xFF] & 7];
+        const int8_t *g10 = g_grad[m_perm[(h1 + y0) & 0xFF] & 7];
+        const int8_t *g01 = g_grad[m_perm[(h0 + y0 + 1) & 0xFF] & 7];
+        const int8_t *g11 = g_grad[m_perm[(h1 + y0 + 1) & 0xFF] & 7];
+
+        the_octave.cx00 = g00[0]; the_octave.cy00 = g00[1] * fy;
+        the_octave.cx10 = g10[0]; the_octave.cy10 = g10[1] * fy;
+        the_octave.cx01 = g01[0]; the_octave.cy01 = g01[1] * (fy - 256);
+        the_octave.cx11 = g11[0]; the_octave.cy11 = g11[1] * (fy - 256);
+    }
+
+    // dot-products with the offsets to all 4 corners, Q8
+    int32_t n00 = the_octave.cx00 * fx + the_octave.cy00;
+    int32_t n10 = the_octave.cx10 * (fx - 256) + the_octave.cy10;
+    int32_t n01 = the_octave.cx01 * fx + the_octave.cy01;
+    int32_t n11 = the_octave.cx11 * (fx - 256) + the_octave.cy11;
+
+    int32_t u = m_fade[fx];
+    int32_t a = n00 + (((n10 - n00) * u) >> 8);
+    int32_t b = n01 + (((n11 - n01) * u) >> 8);
+    return (a + (((b - a) * the_octave.v) >> 8)) >> the_octave.shift;
+}
+
+void Nebula::render(const float *the_positions, uint32_t the_num_positions,
+                    uint8_t *the_values)
+{
+    uint32_t x = m_x_offset, y = m_y_offset;
+
+    // base octave plus one at double frequency and half amplitude, moving in another direction
+    octave_t base, detail;
+    init_octave(base, 0, x, y);
+    init_octave(detail, 1, 2 * x, 3 * y + (97 << 8));
+
+    // meters -> lattice-coordinates, Q8
+    float coord_scale = m_scale * 256.f;
+
+    for(uint32_t i = 0; i < the_num_positions; ++i)
+    {
+        uint32_t coord = clamp<float>(the_positions[i] * coord_scale, 0.f, 32767.f);
+        int32_t sum = eval_octave(base, coord) + eval_octave(detail, coord);
+
+        // sum of octaves rarely exceeds +-170, stretch it a bit
+        int32_t val = 128 + (sum * 3) / 4;
+        the_values[i] = val < 0 ? 0 : (val > 255 ? 255 : val);
+    }
+}
+
+void Nebula::init_octave(octave_t &the_octave, uint8_t the_shift, uint32_t the_x,
+                         uint32_t the_y) const
+{
+    the_octave.shift = the_shift;
+    the_octave.x = the_x;
+    the_octave.fy = the_y & 0xFF;
+    the_octave.y0 = (the_y >> 8) & 0xFF;
+    the_octave.v = m_fade[the_octave.fy];
+    the_octave.cell = 0xFFFFFFFF;
+}
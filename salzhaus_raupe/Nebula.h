@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+
+/*! slowly drifting nebula, built from two octaves of 2D gradient-noise.
+ *  1st axis is the pixel position along the tunnel, 2nd axis is time.
+ *  everything runs in fixed-point (Q8 lattice coordinates), with precomputed
+ *  permutation- and fade-tables. both octaves are evaluated per pixel in a single pass,
+ *  each caching its lattice corners per noise-cell, so neighbouring pixels inside one cell
+ *  only cost a few integer ops.
+ */
+class Nebula
+{
+public:
+
+    Nebula();
+
+    //! advance drift and evolution by the_delta_time (ms)
+    void update(uint32_t the_delta_time);
+
+    /*! evaluate the noise-field for an array of positions (meters), values in range [0, 255].
+     *  positions are converted on the fly, so a frame can be rendered in chunks
+     */
+    void render(const float *the_positions, uint32_t the_num_positions, uint8_t *the_values);
+
+    //! noise-cells per meter for the base octave
+    float scale() const { return m_scale; }
+    void set_scale(float the_scale){ m_scale = the_scale; }
+
+    //! drift along the tunnel in meters per second
+    float drift_speed() const { return m_drift_speed; }
+    void set_drift_speed(float the_speed){ m_drift_speed = the_speed; }
+
+    //! change rate of the pattern, in noise-cells per second
+    float evolve_speed() const { return m_evolve_speed; }
+    void set_evolve_speed(float the_speed){ m_evolve_speed = the_speed; }
+
+private:
+
+    //! one octave while walking along the positions, corner gradients are cached per noise-cell
+    struct octave_t
+    {
+        //! frequency is multiplied, amplitude divided by 2^shift
+        uint8_t shift;
+
+        //! lattice-offset along the tunnel, Q8
+        uint32_t x;
+
+        // row of lattice-cells and vertical fade, constant for all positions
+        uint32_t y0;
+        int32_t fy, v;
+
+        //! lattice-cell of the cached corners
+        uint32_t cell;
+
+        // gradients at the 4 corners, split into x-coefficient and constant y-term
+        int32_t cx00, cx10, cx01, cx11, cy00, cy10, cy01, cy11;
+    };
+
+    //! setup an octave at lattice-offsets the_x, the_y (Q8)
+    void init_octave(octave_t &the_octave, uint8_t the_shift, uint32_t the_x, uint32_t the_y) const;
+
+    //! noise-value of the_octave at lattice-coordinate the_coord (Q8)
+    int32_t eval_octave(octave_t &the_octave, uint32_t the_coord) const;
+
+    float m_scale = 0.6f;
+    float m_drift_speed = 0.3f;
+    float m_evolve_speed = 0.25f;
+
+    // lattice offsets, Q8
+    float m_x_offset = 0.f, m_y_offset = 0.f;
+
+    uint8_t m_perm[256];
+    uint8_t m_fade[256];
+};
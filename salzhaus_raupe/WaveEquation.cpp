@@ -0,0 +1,206 @@
+#include "utils.h"
+#include "WaveEquation.h"
+
+static inline int16_t saturate_int16(int32_t the_value)
+{
+    return the_value > 32767 ? 32767 : (the_value < -32768 ? -32768 : the_value);
+}
+
+WaveEquation::WaveEquation(uint32_t the_num_cells):
+m_track_length(12.f),
+m_propagation_speed(15.f),
+m_decay_secs(2.f),
+m_num_cells(the_num_cells)
+{
+    m_current = new int16_t[m_num_cells + 2];
+    m_previous = new int16_t[m_num_cells + 2];
+    clear();
+    update_coefficients();
+}
+
+WaveEquation::~WaveEquation()
+{
+    delete[](m_current);
+    delete[](m_previous);
+}
+
+void WaveEquation::clear()
+{
+    memset(m_current, 0, (m_num_cells + 2) * sizeof(int16_t));
+    memset(m_previous, 0, (m_num_cells + 2) * sizeof(int16_t));
+    m_time_accum = 0.f;
+}
+
+void WaveEquation::update_coefficients()
+{
+    m_cell_size = m_track_length / m_num_cells;
+
+    // c * dt / dx == sqrt(s_courant_sq)
+    float courant = sqrtf((float)s_courant_sq / (1 << s_courant_bits));
+    m_step_secs = courant * m_cell_size / m_propagation_speed;
+
+    // amplitude factor for a number of steps, reaching 1/255 after m_decay_secs
+    float decay_per_step = logf(255.f) * m_step_secs / m_decay_secs;
+
+    for(uint32_t i = 0; i <= s_max_steps_per_update; ++i)
+    {
+        m_damping[i] = expf(-decay_per_step * i) * (1 << s_damping_bits);
+    }
+}
+
+void WaveEquation::set_track_length(float the_track_length)
+{
+    m_track_length = the_track_length;
+    update_coefficients();
+}
+
+void WaveEquation::set_propagation_speed(float the_propagation_speed)
+{
+    m_propagation_speed = the_propagation_speed;
+    update_coefficients();
+}
+
+void WaveEquation::set_decay_secs(float the_decay_secs)
+{
+    m_decay_secs = the_decay_secs;
+    update_coefficients();
+}
+
+void WaveEquation::update(uint32_t the_delta_time)
+{
+    m_time_accum += the_delta_time / 1000.f;
+    uint32_t num_steps = m_time_accum / m_step_secs;
+
+    if(num_steps > s_max_steps_per_update)
+    {
+        num_steps = s_max_steps_per_update;
+        m_time_accum = 0.f;
+    }
+    else{ m_time_accum -= num_steps * m_step_secs; }
+
+    if(!num_steps){ return; }
+
+    for(uint32_t i = 0; i < num_steps; ++i){ step(); }
+    apply_damping(m_damping[num_steps]);
+}
+
+void WaveEquation::step()
+{
+    int16_t *cur = m_current, *prev = m_previous;
+
+    // reflective ends via ghost-cells
+    cur[0] = cur[1];
+    cur[m_num_cells + 1] = cur[m_num_cells];
+
+    // 3-point stencil, next state overwrites prev in place
+    for(uint32_t i = 1; i <= m_num_cells; ++i)
+    {
+        int32_t u = cur[i];
+        int32_t laplace = cur[i - 1] + cur[i + 1] - 2 * u;
+        int32_t next = 2 * u - prev[i] + s_courant_sq * laplace / (1 << s_courant_bits);
+        prev[i] = saturate_int16(next);
+    }
+    m_current = prev;
+    m_previous = cur;
+}
+
+int16_t WaveEquation::damp(int32_t the_value, int32_t the_factor)
+{
+    // rounding to nearest, symmetric around zero
+    constexpr int32_t half = 1 << (s_damping_bits - 1);
+    int32_t ret = the_value * the_factor;
+    ret = (ret >= 0 ? ret + half : ret - half) / (1 << s_damping_bits);
+
+    // too small to change by rounding, step towards zero instead of lingering forever
+    if(ret == the_value && ret){ ret -= ret > 0 ? 1 : -1; }
+    return ret;
+}
+
+void WaveEquation::apply_damping(int32_t the_factor)
+{
+    // undamped
+    if(the_factor >= (1 << s_damping_bits)){ return; }
+
+    // scaling both states equally damps all frequencies alike without touching the propagation
+    for(uint32_t i = 1; i <= m_num_cells; ++i)
+    {
+        m_current[i] = damp(m_current[i], the_factor);
+        m_previous[i] = damp(m_previous[i], the_factor);
+    }
+}
+
+bool WaveEquation::emit_wave(float the_start_intesity, float the_start_pos)
+{
+    // raised-cosine pulse. the previous state holds the same pulse, shifted back by the distance
+    // travelled in one step (courant number in cells) -> the pulse travels forward
+    float courant = sqrtf((float)s_courant_sq / (1 << s_courant_bits));
+    float radius = s_pulse_radius / m_cell_size;
+    float center = the_start_pos / m_cell_size + 0.5f;
+    float amplitude = the_start_intesity * (1 << s_value_bits);
+
+    int32_t first = max(1, (int32_t)(center - radius - courant)),
+            last = min((int32_t)m_num_cells, (int32_t)(center + radius) + 1);
+
+    for(int32_t i = first; i <= last; ++i)
+    {
+        float d = i - center, d_prev = d + courant;
+
+        if(fabsf(d) < radius)
+        {
+            int32_t val = amplitude * 0.5f * (1.f + cosf(PI * d / radius));
+            m_current[i] = saturate_int16(m_current[i] + val);
+        }
+        if(fabsf(d_prev) < radius)
+        {
+            int32_t val = amplitude * 0.5f * (1.f + cosf(PI * d_prev / radius));
+            m_previous[i] = saturate_int16(m_previous[i] + val);
+        }
+    }
+    return true;
+}
+
+float WaveEquation::intensity_at_position(float the_position)
+{
+    float ret = 0.f;
+    intensities_at_positions(&the_position, &ret, 1);
+    return ret;
+}
+
+void WaveEquation::intensities_at_positions(const float *the_positions, float *the_intensities,
+                                            uint32_t the_num_positions)
+{
+    constexpr float scale = 1.f / (1 << s_value_bits);
+    float cells_per_meter = 1.f / m_cell_size;
+
+    for(uint32_t j = 0; j < the_num_positions; ++j)
+    {
+        // linear interpolation between cell-centers, cell i is centered at (i - 0.5) * m_cell_size
+        float cell_pos = the_positions[j] * cells_per_meter + 0.5f;
+        cell_pos = cell_pos < 1.f ? 1.f : (cell_pos > m_num_cells ? m_num_cells : cell_pos);
+        uint32_t idx = cell_pos;
+        float frac = cell_pos - idx;
+        float val = m_current[idx] + frac * (m_current[idx + 1] - m_current[idx]);
+        the_intensities[j] = (val < 0.f ? -val : val) * scale;
+    }
+}
+
+float WaveEquation::energy() const
+{
+    // sum of kinetic and potential parts, exactly conserved by the undamped leapfrog scheme
+    float c_sq = (float)s_courant_sq / (1 << s_courant_bits);
+    float kinetic = 0.f, potential = 0.f;
+
+    for(uint32_t i = 1; i <= m_num_cells; ++i)
+    {
+        float velocity = m_current[i] - m_previous[i];
+        kinetic += velocity * velocity;
+
+        if(i < m_num_cells)
+        {
+            potential += (float)(m_current[i + 1] - m_current[i]) *
+                         (m_previous[i + 1] - m_previous[i]);
+        }
+    }
+    constexpr float scale = 1.f / (1 << s_value_bits);
+    return 0.5f * (kinetic + c_sq * potential) * scale * scale;
+}
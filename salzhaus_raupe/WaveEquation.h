@@ -0,0 +1,113 @@
+#pragma once
+#include <Arduino.h>
+
+/*! alternative backend to WaveSimulation, offering the same interface.
+ *  solves the 1D wave-equation u_tt = c² * u_xx on a fixed grid of cells spanning the track,
+ *  with reflective (zero-gradient) ends. damping is applied once per update
+ *  as an exponential decay of the whole state.
+ *  in contrast to WaveSimulation, emitted waves interfere and carry their energy
+ *  through reflections.
+ *
+ *  cell values are Q12 fixed-point (1.0 == 4096) in int16, two buffers are used:
+ *  the next state overwrites the previous one in place, so no third buffer is needed.
+ *  the time-step follows from cell-size, speed and the courant number,
+ *  update() performs as many fixed steps as fit into the elapsed time.
+ */
+class WaveEquation
+{
+public:
+
+    WaveEquation(uint32_t the_num_cells = 1024);
+    ~WaveEquation();
+
+    //! run the simulation with the_delta_time increment (ms)
+    void update(uint32_t the_delta_time);
+
+    //! inject a pulse travelling in positive direction, always succeeds
+    bool emit_wave(float the_start_intesity = 1.f, float the_start_pos = 0.f);
+
+    //! return the overall intensity at a given location
+    float intensity_at_position(float the_position);
+
+    //! evaluate the overall intensities (absolute displacement) for an array of locations
+    void intensities_at_positions(const float *the_positions, float *the_intensities,
+                                  uint32_t the_num_positions);
+
+    //! discrete energy of the current state, constant over time without damping
+    float energy() const;
+
+    //! number of grid cells
+    uint32_t num_cells() const { return m_num_cells; }
+
+    //! reset all cells to rest
+    void clear();
+
+    //! return the total length of simulation track in meters
+    float track_legth() const { return m_track_length; }
+    void set_track_length(float the_track_length);
+
+    //! return the absolute propagation speed for simulated waves in meters per second
+    float propagation_speed() const { return m_propagation_speed; }
+    void set_propagation_speed(float the_propagation_speed);
+
+    //! return the time in seconds for a wave to decline to ~1/255 of its amplitude
+    float decay_secs() const { return m_decay_secs; }
+    void set_decay_secs(float the_decay_secs);
+
+private:
+
+    //! fractional bits for cell values
+    static constexpr uint32_t s_value_bits = 12;
+
+    //! fractional bits for damping factors
+    static constexpr uint32_t s_damping_bits = 15;
+
+    //! fractional bits for the squared courant number
+    static constexpr uint32_t s_courant_bits = 8;
+
+    //! squared courant number (c * dt / dx)² = 1.0
+    //  the stencil then becomes exact in integers (no rounding, no dispersion),
+    //  so mass and energy are conserved and the state cannot drift.
+    //  smaller values add rounding to every step and slowly build up an offset
+    static constexpr int32_t s_courant_sq = 1 << s_courant_bits;
+
+    //! upper bound for steps per update, surplus time is dropped after long hitches
+    static constexpr uint32_t s_max_steps_per_update = 32;
+
+    //! half width of an emitted pulse in meters
+    static constexpr float s_pulse_radius = 0.4f;
+
+    //! advance the grid by one time-step
+    void step();
+
+    //! scale current and previous state by the_factor (Q15)
+    void apply_damping(int32_t the_factor);
+
+    //! a single cell-value scaled by the_factor (Q15 < 1.0), small values settle at zero
+    static int16_t damp(int32_t the_value, int32_t the_factor);
+
+    //! derive time-step and damping from track length, speed and decay
+    void update_coefficients();
+
+    float m_track_length;
+    float m_propagation_speed;
+    float m_decay_secs;
+
+    uint32_t m_num_cells;
+
+    //! cell size in meters
+    float m_cell_size;
+
+    //! length of a single time-step in seconds
+    float m_step_secs;
+
+    //! simulated time not yet consumed by steps
+    float m_time_accum = 0.f;
+
+    //! amplitude factors (Q15) after n steps, n = 0 ... s_max_steps_per_update
+    int32_t m_damping[s_max_steps_per_update + 1];
+
+    // current and previous state, m_num_cells + 2 ghost-cells each
+    int16_t *m_current;
+    int16_t *m_previous;
+};
@@ -1,80 +1,255 @@
 #include "utils.h"
 #include "WaveSimulation.h"
 
-WaveSimulation::WaveSimulation(uint32_t max_num_waves):
+//! contributions below this value are skipped
+static constexpr float g_min_contribution = 1.f / 255.f;
+
+//! positions are evaluated in blocks of this size
+static constexpr uint32_t g_block_size = 16;
+
+WaveSimulation::WaveSimulation(uint32_t max_num_waves, EvictionPolicy the_policy):
 m_track_length(12.f),
 m_decay_secs(2.f),
-m_global_propagation_speed(15.f)
+m_global_propagation_speed(15.f),
+m_eviction_policy(the_policy)
 {
-    m_max_num_waves = max_num_waves;
-    m_positions = new float[max_num_waves];
-    m_intensities = new float[max_num_waves];
-    m_propagation_speed = new float[max_num_waves];
-    memset(m_positions, 0, sizeof(float) * max_num_waves);
-    memset(m_intensities, 0, sizeof(float) * max_num_waves);
-    set_propagation_speed(m_global_propagation_speed);
+    set_capacity(max_num_waves);
 }
 
 WaveSimulation::~WaveSimulation()
 {
-    delete[](m_positions);
-    delete[](m_intensities);
+    delete[](m_start_positions);
+    delete[](m_start_intensities);
     delete[](m_propagation_speed);
+    delete[](m_emit_times);
+    delete[](m_emit_ids);
+    delete[](m_active);
+    delete[](m_free);
+    delete[](m_eval_positions);
+    delete[](m_eval_intensities);
+    delete[](m_eval_reach);
+}
+
+void WaveSimulation::set_capacity(uint32_t the_max_num_waves)
+{
+    delete[](m_start_positions);
+    delete[](m_start_intensities);
+    delete[](m_propagation_speed);
+    delete[](m_emit_times);
+    delete[](m_emit_ids);
+    delete[](m_active);
+    delete[](m_free);
+    delete[](m_eval_positions);
+    delete[](m_eval_intensities);
+    delete[](m_eval_reach);
+
+    m_max_num_waves = the_max_num_waves;
+    m_start_positions = new float[the_max_num_waves];
+    m_start_intensities = new float[the_max_num_waves];
+    m_propagation_speed = new float[the_max_num_waves];
+    m_emit_times = new uint32_t[the_max_num_waves];
+    m_emit_ids = new uint32_t[the_max_num_waves];
+    m_active = new uint16_t[the_max_num_waves];
+    m_free = new uint16_t[the_max_num_waves];
+    m_eval_positions = new float[the_max_num_waves];
+    m_eval_intensities = new float[the_max_num_waves];
+    m_eval_reach = new float[the_max_num_waves];
+    memset(m_start_positions, 0, sizeof(float) * the_max_num_waves);
+    memset(m_start_intensities, 0, sizeof(float) * the_max_num_waves);
+    memset(m_emit_times, 0, sizeof(uint32_t) * the_max_num_waves);
+    memset(m_emit_ids, 0, sizeof(uint32_t) * the_max_num_waves);
+
+    // all slots are free
+    m_num_active = 0;
+    m_eval_valid = false;
+    m_num_free = the_max_num_waves;
+    for(uint32_t i = 0; i < the_max_num_waves; ++i){ m_free[i] = the_max_num_waves - 1 - i; }
 }
 
 void WaveSimulation::update(uint32_t the_delta_time)
 {
-    float delta_secs = the_delta_time / 1000.f;
+    m_time += the_delta_time;
+    m_eval_valid = false;
+}
 
-    for(uint32_t i = 0; i < m_max_num_waves; ++i)
+bool WaveSimulation::emit_wave(float the_start_intesity, float the_start_pos)
+{
+    if(the_start_intesity < s_epsilon){ return false; }
+
+    // pool exhausted, first make room from waves that died in the meantime
+    if(!m_num_free){ retire_dead_waves(); }
+
+    if(!m_num_free)
     {
-        if(m_intensities[i] >= s_epsilon)
-        {
-            float new_pos = m_positions[i] + m_propagation_speed[i] * delta_secs;
+        if(m_eviction_policy == EVICT_NONE || !m_num_active){ return false; }
+        retire_wave(eviction_candidate());
+    }
+    uint16_t slot = m_free[--m_num_free];
+    m_active[m_num_active++] = slot;
 
-            // end of track?
-            if(new_pos >= 0.f && new_pos <= m_track_length){ m_positions[i] = new_pos; }
-            else
-            {
-                m_positions[i] = new_pos < 0.f ? -new_pos : 2 * m_track_length - new_pos;
-                m_propagation_speed[i] *= -1.f;
-            }
-            m_intensities[i] -= 1.f / m_decay_secs * delta_secs;
-        }
-        else{ m_intensities[i] = 0.f; }
+    m_start_intensities[slot] = the_start_intesity;
+    m_start_positions[slot] = the_start_pos;
+    m_propagation_speed[slot] = m_global_propagation_speed;
+    m_emit_times[slot] = m_time;
+    m_emit_ids[slot] = m_next_emit_id++;
+    m_eval_valid = false;
+    return true;
+}
+
+void WaveSimulation::retire_wave(uint32_t the_active_index)
+{
+    uint16_t slot = m_active[the_active_index];
+    m_start_intensities[slot] = 0.f;
+    m_free[m_num_free++] = slot;
+    m_active[the_active_index] = m_active[--m_num_active];
+    m_eval_valid = false;
+}
+
+void WaveSimulation::retire_dead_waves()
+{
+    for(uint32_t i = 0; i < m_num_active;)
+    {
+        // the last active wave moves to index i, process it next
+        if(wave_intensity(m_active[i]) < s_epsilon){ retire_wave(i); }
+        else{ ++i; }
     }
 }
 
-void WaveSimulation::emit_wave(float the_start_intesity, float the_start_pos)
+uint32_t WaveSimulation::eviction_candidate() const
 {
-    // find unused slot
-    for(uint32_t i = 0; i < m_max_num_waves; ++i)
+    // only scanned when the pool is full
+    uint32_t ret = 0;
+
+    for(uint32_t i = 1; i < m_num_active; ++i)
     {
-        if(m_intensities[i] < s_epsilon)
+        uint16_t slot = m_active[i], best = m_active[ret];
+
+        if(m_eviction_policy == EVICT_OLDEST)
         {
-            // found an unused slot
-            m_intensities[i] = the_start_intesity;
-            m_positions[i] = the_start_pos;
-            m_propagation_speed[i] = m_global_propagation_speed;
-            break;
+            // wrap-around safe comparison of emit-ids
+            if((int32_t)(m_emit_ids[slot] - m_emit_ids[best]) < 0){ ret = i; }
         }
+        else if(wave_intensity(slot) < wave_intensity(best)){ ret = i; }
+    }
+    return ret;
+}
+
+float WaveSimulation::wave_intensity(uint16_t the_slot) const
+{
+    float age_secs = (m_time - m_emit_times[the_slot]) / 1000.f;
+    return m_start_intensities[the_slot] - age_secs / m_decay_secs;
+}
+
+float WaveSimulation::wave_position(uint16_t the_slot, float *the_direction) const
+{
+    float age_secs = (m_time - m_emit_times[the_slot]) / 1000.f;
+    float period = 2.f * m_track_length;
+    float pos = m_start_positions[the_slot] + m_propagation_speed[the_slot] * age_secs;
+
+    // fold into [0, period)
+    pos -= period * floorf(pos / period);
+
+    // 2nd half of a period travels backwards
+    bool reflected = pos > m_track_length;
+    if(the_direction){ *the_direction = reflected ? -1.f : 1.f; }
+    return reflected ? period - pos : pos;
+}
+
+void WaveSimulation::evaluate_waves()
+{
+    for(uint32_t i = 0; i < m_num_active; i++)
+    {
+        uint16_t slot = m_active[i];
+        float intensity = wave_intensity(slot);
+        m_eval_intensities[i] = intensity;
+        m_eval_positions[i] = wave_position(slot);
+
+        // beyond this distance the contribution is below g_min_contribution
+        float max_dist_sq = (intensity / g_min_contribution - 1.f) / s_quad_factor;
+        m_eval_reach[i] = max_dist_sq > 0.f ? sqrtf(max_dist_sq) : 0.f;
+    }
+    m_eval_valid = true;
+}
+
+void WaveSimulation::rebase_waves()
+{
+    retire_dead_waves();
+    m_eval_valid = false;
+
+    for(uint32_t i = 0; i < m_num_active; i++)
+    {
+        uint16_t slot = m_active[i];
+        float direction;
+        m_start_positions[slot] = wave_position(slot, &direction);
+        m_start_intensities[slot] = wave_intensity(slot);
+        m_propagation_speed[slot] *= direction;
+        m_emit_times[slot] = m_time;
     }
 }
 
 float WaveSimulation::intensity_at_position(float the_position)
 {
-    float sum = 0.f;
-    float quad_factor = 18.f;
+    float ret = 0.f;
+    intensities_at_positions(&the_position, &ret, 1);
+    return ret;
+}
+
+void WaveSimulation::intensities_at_positions(const float *the_positions, float *the_intensities,
+                                              uint32_t the_num_positions)
+{
+    retire_dead_waves();
+
+    // wave states are shared by all queries until the next change, e.g. one per gate and frame
+    if(!m_eval_valid){ evaluate_waves(); }
 
-    for(uint32_t i = 0; i < m_max_num_waves; i++)
+    for(uint32_t j = 0; j < the_num_positions; j += g_block_size)
     {
-        if(m_intensities[i] >= s_epsilon)
+        uint32_t n = the_num_positions - j < g_block_size ? the_num_positions - j : g_block_size;
+        float pos[g_block_size], sum[g_block_size];
+        float lo = the_positions[j], hi = lo;
+
+        // a partial block is padded with its last position
+        for(uint32_t k = 0; k < g_block_size; ++k)
+        {
+            pos[k] = the_positions[j + (k < n ? k : n - 1)];
+            lo = pos[k] < lo ? pos[k] : lo;
+            hi = pos[k] > hi ? pos[k] : hi;
+            sum[k] = 0.f;
+        }
+
+        for(uint32_t i = 0; i < m_num_active; i++)
         {
-            float distance = m_positions[i] - the_position;
-            sum += m_intensities[i] / (1.f + quad_factor * distance * distance);
+            // the cut-off is tested per block, the inner loop has no branches
+            float wave_pos = m_eval_positions[i], intensity = m_eval_intensities[i];
+            if(wave_pos + m_eval_reach[i] < lo || wave_pos - m_eval_reach[i] > hi){ continue; }
+
+            for(uint32_t k = 0; k < g_block_size; ++k)
+            {
+                float distance = wave_pos - pos[k];
+                sum[k] += intensity / (1.f + s_quad_factor * distance * distance);
+            }
         }
+        for(uint32_t k = 0; k < n; ++k){ the_intensities[j + k] = sum[k]; }
+    }
+}
+
+void WaveSimulation::set_track_length(float the_track_length)
+{
+    rebase_waves();
+    m_track_length = the_track_length;
+
+    // keep waves on the shortened track
+    for(uint32_t i = 0; i < m_num_active; i++)
+    {
+        uint16_t slot = m_active[i];
+        if(m_start_positions[slot] > m_track_length){ m_start_positions[slot] = m_track_length; }
     }
-    return sum;
+}
+
+void WaveSimulation::set_decay_secs(float the_decay_secs)
+{
+    rebase_waves();
+    m_decay_secs = the_decay_secs;
 }
 
 float WaveSimulation::propagation_speed() const
@@ -83,10 +258,12 @@ float WaveSimulation::propagation_speed() const
 }
 void WaveSimulation::set_propagation_speed(float the_propagation_speed)
 {
+    rebase_waves();
     m_global_propagation_speed = the_propagation_speed;
 
-    for(uint32_t i = 0; i < m_max_num_waves; i++)
+    for(uint32_t i = 0; i < m_num_active; i++)
     {
-        m_propagation_speed[i] = the_propagation_speed * sgn(m_propagation_speed[i]);
+        uint16_t slot = m_active[i];
+        m_propagation_speed[slot] = the_propagation_speed * sgn(m_propagation_speed[slot]);
     }
 }
@@ -6,21 +6,39 @@ class WaveSimulation
 public:
     static constexpr float s_epsilon = 0.001f;
 
-    WaveSimulation(uint32_t max_num_waves = 3);
+    //! what to do, when a wave is emitted while all slots are in use
+    enum EvictionPolicy{ EVICT_NONE, EVICT_OLDEST, EVICT_WEAKEST };
+
+    WaveSimulation(uint32_t max_num_waves = 3, EvictionPolicy the_policy = EVICT_NONE);
     ~WaveSimulation();
 
-    //! run the simulation with the_delta_time increment
+    //! advance the simulation clock by the_delta_time (ms).
+    //  wave states are evaluated in closed form on query, so this is O(1) and exact for any step
     void update(uint32_t the_delta_time);
 
-    //! emit a new wave
-    void emit_wave(float the_start_intesity = 1.f, float the_start_pos = 0.f);
+    //! emit a new wave, returns false if the wave was dropped
+    bool emit_wave(float the_start_intesity = 1.f, float the_start_pos = 0.f);
+
+    //! maximum number of simultaneous waves. resizing the pool removes all waves
+    uint32_t capacity() const { return m_max_num_waves; }
+    void set_capacity(uint32_t the_max_num_waves);
+
+    //! number of occupied slots. decayed waves are released lazily by the next query or emit
+    uint32_t num_waves() const { return m_num_active; }
+
+    EvictionPolicy eviction_policy() const { return m_eviction_policy; }
+    void set_eviction_policy(EvictionPolicy the_policy){ m_eviction_policy = the_policy; }
 
     //! return the overall intensity at a given location
     float intensity_at_position(float the_position);
 
+    //! evaluate the overall intensities for an array of locations at once
+    void intensities_at_positions(const float *the_positions, float *the_intensities,
+                                  uint32_t the_num_positions);
+
     //! return the total length of simulation track in meters
     float track_legth() const { return m_track_length; }
-    void set_track_length(float the_track_length){ m_track_length = the_track_length; }
+    void set_track_length(float the_track_length);
 
     //! return the absolute propagation speed for simulated waves in meters per second
     float propagation_speed() const;
@@ -28,14 +46,66 @@ public:
 
     //! return the time in seconds for a wave to decline totally
     float decay_secs() const { return m_decay_secs; }
-    void set_decay_secs(float the_decay_secs){ m_decay_secs = the_decay_secs; }
+    void set_decay_secs(float the_decay_secs);
 
 private:
+
+    //! wave shape: intensity / (1 + s_quad_factor * distance²)
+    static constexpr float s_quad_factor = 18.f;
+
+    //! remove the wave at the_active_index in O(1), order of active waves is not kept
+    void retire_wave(uint32_t the_active_index);
+
+    //! index into the active-list for the wave to evict, according to m_eviction_policy
+    uint32_t eviction_candidate() const;
+
+    //! release all waves that have decayed by now
+    void retire_dead_waves();
+
+    //! current intensity of the wave in the_slot: start intensity - age / decay
+    float wave_intensity(uint16_t the_slot) const;
+
+    /*! current position of the wave in the_slot. the unbounded path start + speed * age
+     *  is folded into [0, m_track_length] with a triangle-wave of period 2 * m_track_length,
+     *  which equals bouncing back and forth at the track ends.
+     *  the_direction (optional) receives +1 / -1 relative to the initial speed.
+     */
+    float wave_position(uint16_t the_slot, float *the_direction = nullptr) const;
+
+    //! fill the m_eval_* arrays for the active waves at the current time
+    void evaluate_waves();
+
+    //! restart all waves from their current state, before speed, track or decay change
+    void rebase_waves();
+
     float m_track_length;
     float m_decay_secs;
     float m_global_propagation_speed;
-    float* m_positions;
-    float* m_intensities;
-    float* m_propagation_speed;
-    uint32_t m_max_num_waves;
+    EvictionPolicy m_eviction_policy;
+
+    //! simulation clock in ms, advanced by update()
+    uint32_t m_time = 0;
+
+    // wave pool, structure of arrays indexed by slot. each wave is described by its start-state
+    float* m_start_positions = nullptr;
+    float* m_start_intensities = nullptr;
+    float* m_propagation_speed = nullptr;
+    uint32_t* m_emit_times = nullptr;
+    uint32_t* m_emit_ids = nullptr;
+    uint32_t m_max_num_waves = 0;
+    uint32_t m_next_emit_id = 0;
+
+    // slots of active waves
+    uint16_t* m_active = nullptr;
+    uint32_t m_num_active = 0;
+
+    // stack of unused slots
+    uint16_t* m_free = nullptr;
+    uint32_t m_num_free = 0;
+
+    // per active wave: position, intensity and cut-off distance, valid until the next change
+    float* m_eval_positions = nullptr;
+    float* m_eval_intensities = nullptr;
+    float* m_eval_reach = nullptr;
+    bool m_eval_valid = false;
 };
@@ -1,6 +1,9 @@
 #include "utils.h"
 #include "LED_Tunnel.h"
 #include "WaveSimulation.h"
+#include "WaveEquation.h"
+#include "Nebula.h"
+#include "SPSC_Queue.h"
 
 #define ADC_BITS 10
 
@@ -29,13 +32,43 @@ const int g_update_interval = 1000 / UPDATE_RATE;
 // to indicate update frequency
 bool g_indicator = false;
 
+// set when a LED-strip could not be started, PIN 13 stays lit then
+bool g_strip_failure = false;
+
 // tunnel variables
 Tunnel g_tunnel;
 uint32_t g_current_index = 0;
 
-// lightbarrier handling (changed in ISR, must be volatile)
-volatile bool g_button_pressed = false;
-volatile long g_button_timestamp = 0;
+//! a debounced button edge, timestamped in ISR
+struct button_event_t
+{
+    uint32_t micros;
+    bool pressed;
+};
+
+// edges closer than this to their predecessor are treated as bounces
+const uint32_t g_debounce_micros = 5000;
+
+// button edges, pushed by ISR, consumed in loop()
+kinski::SPSC_Queue<button_event_t, 16> g_button_events;
+
+// button state, as reconstructed from events
+bool g_button_pressed = false;
+long g_button_timestamp = 0;
+uint32_t g_press_micros = 0;
+
+// level and timestamp of the last accepted edge. written by button_ISR() and by the fallback
+// in process_button_events(), so the ISR debounces against edges from either
+volatile bool g_edge_pressed = false;
+volatile uint32_t g_edge_micros = 0;
+
+// release edge of a wave not yet shown, for latency measurement
+bool g_latency_pending = false;
+uint32_t g_release_micros = 0;
+
+// release -> frame shown, in microseconds
+uint32_t g_latency_max = 0;
+float g_latency_avg = 0.f;
 
 const int g_charge_millis = 3000;
 float g_charge = 0.f;
@@ -50,12 +83,27 @@ enum RunMode
 };
 uint32_t g_run_mode = MODE_SPARKLE | MODE_WAVES;
 
-// our wave simulation object
-WaveSimulation g_wave_sim;
+// our wave simulation object, the weakest wave makes room when all slots are in use
+WaveSimulation g_wave_sim(16, WaveSimulation::EVICT_WEAKEST);
+
+// alternative: interfering and reflecting waves from a wave-equation with 1024 cells
+// WaveEquation g_wave_sim(1024);
+
+// start bias for 1st gate and distance between two gates in meters
+constexpr float g_gate_start = 0.3f, g_gate_step = 0.88f;
+
+// apex pixels of a gate are reached this many meters later by a wave
+constexpr float g_arch_lag = 0.5f;
+
+// noise-field for MODE_NEBULA and its colors, indexed by the upper 6 bits of a noise-value
+Nebula g_nebula;
+uint32_t g_nebula_palette[64];
 
 // disabled when set to 0
 int32_t g_random_wave_timer = 1;
-volatile bool g_emit_wave = false;
+
+// render the next frame right away, instead of waiting for the frame-timer
+bool g_force_frame = false;
 
 const uint32_t g_idle_timeout = 15000;
 
@@ -66,24 +114,68 @@ float g_spawn_accum = 0.f;
 
 uint32_t g_blink_interval = 1000;
 
-//! interrupt routine for lightbarrier status
+//! interrupt routine for button edges (CHANGE)
 void button_ISR()
 {
-     bool is_pressed = !digitalRead(BUTTON_PIN);
-
-     // button pressed
-     if(!g_button_pressed && is_pressed)
-     {
-         g_button_pressed = true;
-         g_button_timestamp = millis();
-         g_emit_wave = false;
-     }
-     // button released
-     else if(g_button_pressed && !is_pressed)
-     {
-         g_button_pressed = false;
-         g_emit_wave = true;
-     }
+    uint32_t now = micros();
+    bool is_pressed = !digitalRead(BUTTON_PIN);
+
+    // same level or bouncing
+    if(is_pressed == g_edge_pressed || now - g_edge_micros < g_debounce_micros){ return; }
+
+    g_edge_pressed = is_pressed;
+    g_edge_micros = now;
+    g_button_events.push({now, is_pressed});
+}
+
+//! apply a button edge to the reconstructed button state
+void handle_button_event(const button_event_t &the_event)
+{
+    // an edge arrives twice, if the ISR fires while process_button_events() records it
+    if(the_event.pressed == g_button_pressed){ return; }
+
+    if(the_event.pressed)
+    {
+        g_button_pressed = true;
+        g_press_micros = the_event.micros;
+        g_button_timestamp = millis() - (micros() - the_event.micros) / 1000;
+        g_charge = 0.f;
+    }
+    else
+    {
+        g_button_pressed = false;
+
+        // charge at the exact release edge, emit right away
+        uint32_t press_micros = the_event.micros - g_press_micros;
+        g_charge = clamp(press_micros / (1000.f * g_charge_millis), 0.f, 1.f);
+        g_wave_sim.emit_wave(mix(0.2f, 1.f, g_charge));
+        g_charge = 0.f;
+
+        g_release_micros = the_event.micros;
+        g_latency_pending = true;
+        g_force_frame = true;
+    }
+}
+
+//! consume button edges, called on every loop()
+void process_button_events()
+{
+    button_event_t event;
+    while(g_button_events.pop(event)){ handle_button_event(event); }
+
+    // an edge swallowed by the debounce window leaves the pin at another level than the last
+    // edge. once the window has expired it is handled here, the ISR stays the queue's only
+    // producer and interrupts are never masked. the edge is recorded in the shared state,
+    // the ISR then catches the next one right away and debounces it against this one
+    uint32_t now = micros();
+    bool is_pressed = !digitalRead(BUTTON_PIN);
+
+    if(now - g_edge_micros >= g_debounce_micros && is_pressed != g_edge_pressed)
+    {
+        g_edge_micros = now;
+        g_edge_pressed = is_pressed;
+        handle_button_event({now, is_pressed});
+    }
 }
 
 void update_sparkling(uint32_t the_delta_time)
@@ -109,13 +201,6 @@ void update_waves(uint32_t the_delta_time)
 
     g_random_wave_timer -= g_time_accum;
 
-    if(g_emit_wave)
-    {
-         g_emit_wave = false;
-         g_wave_sim.emit_wave(mix(0.2f, 1.f, g_charge));
-         g_charge = 0.f;
-    }
-
     // idle timeout and wave timer elapsed
     if(millis() - g_button_timestamp > g_idle_timeout &&
        g_random_wave_timer < 0)
@@ -128,19 +213,33 @@ void update_waves(uint32_t the_delta_time)
     }
 
     // g_tunnel.set_brightness(20 + 50 * g_mic_lvl);
-    auto col = Adafruit_NeoPixel::Color(150, 50, 0, g_gamma[40]);
+    auto col = Adafruit_NeoPixel::Color(150, 50, 0, 40);
+
+    // evaluate gate by gate, there is no RAM for per-pixel buffers in the full build
+    float positions[max_gate_leds()], intensities[max_gate_leds()];
+
+    for(uint32_t i = 0; i < g_tunnel.num_gates(); ++i)
+    {
+        Gate &gate = g_tunnel.gates()[i];
+        g_tunnel.pixel_positions(i, positions);
+        g_wave_sim.intensities_at_positions(positions, intensities, gate.num_leds());
+        gate.set_pixels_faded(col, intensities);
+    }
+}
 
-    // start bias for 1st gate in meters
-    float pos_x = 0.3;
+void update_nebula(uint32_t the_delta_time)
+{
+    g_nebula.update(the_delta_time);
 
-    // distance between two gates in meters
-    const float step = 0.88f;
+    float positions[max_gate_leds()];
+    uint8_t values[max_gate_leds()];
 
-    for(int i = 0; i < g_tunnel.num_gates(); i++)
+    for(uint32_t i = 0; i < g_tunnel.num_gates(); ++i)
     {
-        auto fade_col = fade_color(col, g_wave_sim.intensity_at_position(pos_x));
-        g_tunnel.gates()[i].set_all_pixels(fade_col);
-        pos_x += step;
+        Gate &gate = g_tunnel.gates()[i];
+        g_tunnel.pixel_positions(i, positions);
+        g_nebula.render(positions, gate.num_leds(), values);
+        gate.set_pixels_mapped(g_nebula_palette, values);
     }
 }
 
@@ -152,8 +251,7 @@ void setup()
 
     // interrupt from button
     pinMode(BUTTON_PIN, INPUT_PULLUP);
-    // digitalWrite(BUTTON_PIN, HIGH);
-    // attachInterrupt(BUTTON_PIN, button_ISR, CHANGE);
+    attachInterrupt(BUTTON_PIN, button_ISR, CHANGE);
 
     // Button LED
     pinMode(BUTTON_LED, OUTPUT);
@@ -164,7 +262,17 @@ void setup()
     // while(!Serial){ delay(10); }
     Serial.begin(115200);
 
-    g_tunnel.init();
+    // a strip failed to start, keep the status LED lit instead of flashing it
+    g_strip_failure = !g_tunnel.init();
+
+    g_tunnel.set_pixel_layout(g_gate_start, g_gate_step, g_arch_lag);
+
+    // dark purple, fading into orange wisps
+    for(uint32_t i = 0; i < 64; ++i)
+    {
+        float val = i / 63.f;
+        g_nebula_palette[i] = fade_color(color_mix(PURPLE, ORANGE, val * val), val * val);
+    }
 
     g_wave_sim.set_track_length(10.f);
     g_wave_sim.set_propagation_speed(3.33);
@@ -177,8 +285,8 @@ void loop()
     g_last_time_stamp = millis();
     g_time_accum += delta_time;
 
-    // button state
-    button_ISR();
+    // button edges
+    process_button_events();
 
     bool light_led;
 
@@ -191,10 +299,12 @@ void loop()
     else{ light_led = (g_last_time_stamp / g_blink_interval) % 2; }
     digitalWrite(BUTTON_LED, light_led);
 
-    if(g_time_accum >= g_update_interval)
+    if(g_time_accum >= g_update_interval || g_force_frame)
     {
+        g_force_frame = false;
+
         // flash red indicator LED
-        digitalWrite(13, g_indicator);
+        digitalWrite(13, g_indicator || g_strip_failure);
         g_indicator = !g_indicator;
 
         // read debug inputs
@@ -206,13 +316,23 @@ void loop()
         // clear everything to black
         g_tunnel.clear();
 
-        // run stages depending on current mode
-        if(g_run_mode & MODE_WAVES){ update_waves(g_time_accum); }
+        // run stages depending on current mode, nebula and waves both fill all pixels
+        if(g_run_mode & MODE_NEBULA){ update_nebula(g_time_accum); }
+        else if(g_run_mode & MODE_WAVES){ update_waves(g_time_accum); }
         if(g_run_mode & MODE_SPARKLE){ update_sparkling(g_time_accum); }
 
         // send new color values to strips
         g_tunnel.update(delta_time);
 
+        // a released wave is on its way
+        if(g_latency_pending)
+        {
+            g_latency_pending = false;
+            uint32_t latency = micros() - g_release_micros;
+            g_latency_max = max(g_latency_max, latency);
+            g_latency_avg = mix<float>(g_latency_avg, latency, 0.1f);
+        }
+
         // clear time accumulator
         g_time_accum = 0;
     }
@@ -247,6 +367,14 @@ void process_serial_input()
                 g_tunnel.gates()[index].set_all_pixels(ORANGE);
                 g_tunnel.update(0);
             }
+            else if(index == -1){ g_run_mode = MODE_SPARKLE | MODE_NEBULA; }
+            else if(index == -2)
+            {
+                Serial.print("release -> frame latency (us), max: ");
+                Serial.print((int)g_latency_max);
+                Serial.print(" avg: ");
+                Serial.println((int)g_latency_avg);
+            }
             else{ g_run_mode = MODE_SPARKLE | MODE_WAVES; }
         }
     }
@@ -7,13 +7,15 @@
 */
 
 #include "Adafruit_FONA.h"
+#include "CommandParser.h"
 
 #define FONA_RX  9
 #define FONA_TX  8
 #define FONA_RST 4
 #define FONA_RI  7
 
-char g_serial_buf[256];
+// incoming lines, kept across calls until their newline arrives
+kinski::LineBuffer<256> g_serial_lines;
 
 //for notifications from the FONA
 char g_notification_buffer[64];
@@ -167,7 +169,7 @@ void loop()
             uint16_t smslen;
             if(g_fona.readSMS(slot, g_reply_buffer, 250, &smslen))
             {
-                parse_input(g_reply_buffer);
+                parse_input(g_reply_buffer, strlen(g_reply_buffer));
             }
             else{ Serial.println("Failed!"); }
 
@@ -200,79 +202,60 @@ void send_sms()
 
 template <typename T> void process_serial_input(T& the_serial)
 {
-    uint16_t buf_idx = 0;
-
     while(the_serial.available())
     {
-        // get the new byte:
-        char c = the_serial.read();
-
-        switch(c)
+        if(g_serial_lines.feed(the_serial.read()))
         {
-            case '\r':
-            case '\0':
-                continue;
-
-            case '\n':
-                g_serial_buf[buf_idx] = '\0';
-                buf_idx = 0;
-                parse_input(g_serial_buf);
-                break;
-
-            default:
-                g_serial_buf[buf_idx++] = c;
-                break;
+            parse_input(g_serial_lines.line(), g_serial_lines.length());
         }
     }
 }
 
-// we expect the format: "CMD_0:VALUE_0;...;CMD_N:VALUE_N ..."
-void parse_input(char *the_line)
+void cmd_phone(Print &the_device, kinski::Args &the_args)
 {
-    Serial.println(the_line);
-    const char* delim = ";";
-    const size_t max_num_tokens = 3;
-    char *token = strtok(the_line, delim);
-    uint16_t num_tokens = 0;
-    char* tokens[max_num_tokens];
+    the_args.rest(g_current_target_number, sizeof(g_current_target_number));
+    the_device.print("phone: "); the_device.println(g_current_target_number);
+}
 
-    for(; token && (num_tokens < max_num_tokens); num_tokens++)
-    {
-        tokens[num_tokens] = token;
-        token = strtok(nullptr, delim);
-    }
+void cmd_text(Print &the_device, kinski::Args &the_args)
+{
+    the_args.rest(g_current_text_buffer, sizeof(g_current_text_buffer));
+    g_current_text = g_current_text_buffer;
+    the_device.print("text: "); the_device.println(g_current_text);
+}
+
+void cmd_time(Print &the_device, kinski::Args &the_args)
+{
+    int32_t secs;
 
-    for(int i = 0; i < num_tokens; ++i)
+    if(the_args.next_int(&secs) && secs >= 0)
     {
-        Serial.println(tokens[i]);
-        // parse tokens as CMD::VALUE
-        char *cmd = strtok(tokens[i], ":");
-        char *val = strtok(nullptr, ":");
-        if(cmd && val){ process_cmd(cmd, val); }
+        g_timeout_ready = secs * 1000UL;
+        the_device.print("time: "); the_device.println(g_timeout_ready);
     }
 }
 
-bool process_cmd(char* the_cmd, char* the_val)
+//! sorted by name
+constexpr kinski::command_t<Print> g_commands[] =
 {
-    Serial.print("command: ");Serial.print(the_cmd);
-    Serial.print(" - value: ");Serial.println(the_val);
+    {"phone", &cmd_phone},
+    {"text", &cmd_text},
+    {"time", &cmd_time}
+};
+static_assert(kinski::is_sorted(g_commands), "command-table must be sorted by name");
 
-    bool success = false;
-    if(strcmp(the_cmd, "phone") == 0)
-    {
-        strcpy(g_current_target_number, the_val);
-        success = true;
-    }
-    else if(strcmp(the_cmd, "time") == 0)
-    {
-        g_timeout_ready = atol(the_val) * 1000;
-        success = true;
-    }
-    else if(strcmp(the_cmd, "text") == 0)
+// we expect the format: "CMD_0:VALUE_0;...;CMD_N:VALUE_N ..."
+void parse_input(const char *the_line, size_t the_length)
+{
+    Serial.println(the_line);
+    kinski::Args commands(the_line, the_length, ";");
+    kinski::token_t cmd;
+
+    while(commands.next(&cmd))
     {
-        strcpy(g_current_text_buffer, the_val);
-        g_current_text = g_current_text_buffer;
-        success = true;
+        if(!kinski::dispatch_command(g_commands, Serial, cmd.data, cmd.length))
+        {
+            Serial.println("unknown command");
+        }
     }
-    return success;
 }
@@ -0,0 +1,113 @@
+//  adc_timing_test.cpp
+//
+//  ADC_Timing: conversion times and rates against hand-computed values from the SAMD21 datasheet
+//  (ADC, conversion timing: sampling (SAMPLEN + 1) / 2 CLK_ADC cycles, propagation
+//  1 + RESOLUTION / 2 cycles, 4^n accumulated conversions for 12 + n bits), plus the scan-rate
+//  limit ADC_Sampler applies to the sketches' channel-lists
+
+#include <math.h>
+#include "test_utils.h"
+#include "ADC_Timing.h"
+
+namespace
+{
+    //! relative error below 1e-5
+    bool close(double the_value, double the_expected)
+    {
+        return fabs(the_value - the_expected) <= 1e-5 * fabs(the_expected);
+    }
+
+    struct timing_t
+    {
+        adc_config_t config;
+        uint8_t resolution;
+
+        //! CLK_ADC cycles per result
+        double cycles;
+    };
+
+    void check_conversions()
+    {
+        const uint8_t resolutions[][2] =
+        {
+            {0, 10}, {1, 8}, {8, 8}, {9, 10}, {10, 10}, {11, 12}, {12, 12}, {13, 13}, {14, 14},
+            {15, 15}, {16, 16}, {17, 16}, {255, 16}
+        };
+        for(const auto &r : resolutions){ CHECK(adc_valid_resolution(r[0]) == r[1]); }
+
+        // hardware averaging, 4^(resolution - 12) samples
+        const uint32_t num_conversions[] = {1, 4, 16, 64, 256};
+        for(uint8_t i = 0; i < 5; ++i){ CHECK(adc_num_conversions(12 + i) == num_conversions[i]); }
+        CHECK(adc_num_conversions(8) == 1 && adc_num_conversions(10) == 1);
+
+        const timing_t timings[] =
+        {
+            // the Arduino core's analogRead(): DIV512, SAMPLEN 63, 10 bits -> 32 + 6 cycles
+            {{512, 63}, 10, 38.},
+
+            // g_adc_default_config: DIV8, SAMPLEN 47 -> 24 cycles sampling, 12 bits -> 7
+            {g_adc_default_config, 12, 31.},
+            {g_adc_default_config, 10, 30.},
+            {g_adc_default_config, 13, 4 * 31.},
+            {g_adc_default_config, 16, 256 * 31.},
+
+            // shortest sampling, 8 bits: .5 + 5 cycles
+            {{4, 0}, 8, 5.5},
+            {{32, 0}, 12, 7.5}
+        };
+
+        for(const timing_t &t : timings)
+        {
+            double adc_clock = (double)g_adc_gclk_hz / t.config.prescaler;
+            double micros = 1e6 * t.cycles / adc_clock;
+
+            CHECK(adc_conversion_half_cycles(t.resolution, t.config.sample_length) == 2 * t.cycles);
+            CHECK(close(adc_conversion_micros(t.config, t.resolution), micros));
+            CHECK(close(adc_max_sample_rate(t.config, t.resolution), 1e6 / micros));
+        }
+
+        // 31 cycles at 6 MHz
+        CHECK(close(adc_max_sample_rate(g_adc_default_config, 12), 6e6 / 31));
+    }
+
+    void check_scan_rates()
+    {
+        constexpr uint32_t sample_rate = 22050;
+
+        // orientation_express: mic at full rate, poti oversampled at 50Hz
+        const uint8_t resolutions[] = {10, 13, 13};
+        const uint32_t decimations[] = {1, sample_rate / 50, sample_rate / 50};
+
+        // 30 cycles + 124 cycles / 441 per tick, at 6 MHz
+        double micros = (30. + 124. / 441.) / 6.;
+        float rate = adc_max_scan_rate(g_adc_default_config, resolutions, decimations, 2);
+        CHECK(close(rate, 1e6 / micros) && rate > sample_rate);
+
+        // m0_audio_leds: plus the battery, like the poti
+        micros = (30. + 2 * 124. / 441.) / 6.;
+        rate = adc_max_scan_rate(g_adc_default_config, resolutions, decimations, 3);
+        CHECK(close(rate, 1e6 / micros) && rate > sample_rate);
+
+        // with analogRead()'s slow settings the mic alone could not keep up
+        const adc_config_t slow = {512, 63};
+        rate = adc_max_scan_rate(slow, resolutions, decimations, 1);
+        CHECK(close(rate, 93750. / 38.) && rate < sample_rate);
+
+        // decimation 0 counts as 1, no channels no limit
+        const uint32_t no_decimation[] = {0};
+        CHECK(close(adc_max_scan_rate(slow, resolutions, no_decimation, 1), rate));
+        CHECK(adc_max_scan_rate(slow, resolutions, decimations, 0) == 0.f);
+
+        printf("default config: 12 bits %.0f Hz, 16 bits %.0f Hz, mic + poti scan %.0f Hz\n",
+               adc_max_sample_rate(g_adc_default_config, 12),
+               adc_max_sample_rate(g_adc_default_config, 16),
+               adc_max_scan_rate(g_adc_default_config, resolutions, decimations, 2));
+    }
+}
+
+int main()
+{
+    check_conversions();
+    check_scan_rates();
+    return test_result("adc_timing_test");
+}
@@ -0,0 +1,244 @@
+//  command_parser_test.cpp
+//
+//  CommandParser: LineBuffer against a reference line-splitter for random byte-streams,
+//  parse_int()/parse_float() against strtoll()/strtod() for random tokens, dispatch_command()
+//  against a linear table-search, and the throughput of the whole serial-path per byte
+
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "test_utils.h"
+#include "CommandParser.h"
+
+using namespace kinski;
+
+namespace
+{
+    struct device_t
+    {
+        int32_t command = -1;
+        int32_t sum = 0;
+        uint32_t num_args = 0;
+    };
+
+    template <int32_t I> void handler(device_t &the_device, Args &the_args)
+    {
+        the_device.command = I;
+        int32_t val;
+        while(the_args.next_int(&val)){ the_device.sum += val; the_device.num_args++; }
+    }
+
+    constexpr command_t<device_t> g_commands[] =
+    {
+        {"A", &handler<0>}, {"AB", &handler<1>}, {"BRIGHTNESS", &handler<2>}, {"ID", &handler<3>},
+        {"SEGMENT", &handler<4>}, {"SEGMENTS", &handler<5>}, {"text", &handler<6>}
+    };
+    static_assert(is_sorted(g_commands), "command-table must be sorted");
+
+    constexpr command_t<device_t> g_unsorted[] = {{"B", &handler<0>}, {"A", &handler<1>}};
+    static_assert(!is_sorted(g_unsorted), "is_sorted() accepts an unsorted table");
+
+    constexpr command_t<device_t> g_duplicate[] = {{"A", &handler<0>}, {"A", &handler<1>}};
+    static_assert(!is_sorted(g_duplicate), "is_sorted() accepts duplicates");
+
+    constexpr uint32_t g_num_commands = sizeof(g_commands) / sizeof(g_commands[0]);
+
+    //! random string over the_alphabet, up to the_max_length characters
+    std::string random_string(const char *the_alphabet, uint32_t the_max_length)
+    {
+        std::string ret(test_rand() % (the_max_length + 1), ' ');
+        size_t n = strlen(the_alphabet);
+        for(auto &c : ret){ c = the_alphabet[test_rand() % n]; }
+        return ret;
+    }
+
+    //! what LineBuffer<N> should emit for the_input, plus the number of dropped lines
+    std::vector<std::string> split_lines(const std::string &the_input, uint32_t the_size,
+                                         uint32_t *the_num_overflows)
+    {
+        std::vector<std::string> ret;
+        std::string line;
+
+        for(char c : the_input)
+        {
+            if(c == '\n')
+            {
+                if(line.size() > the_size - 1){ (*the_num_overflows)++; }
+                else if(!line.empty()){ ret.push_back(line); }
+                line.clear();
+            }
+            else if(c != '\r' && c != '\0'){ line += c; }
+        }
+        return ret;
+    }
+
+    void fuzz_line_buffer()
+    {
+        constexpr uint16_t N = 16;
+        const char alphabet[] = "ab1 \r\n\n";
+
+        for(uint32_t i = 0; i < 2000; ++i)
+        {
+            std::string input = random_string(alphabet, 200);
+            if(test_rand() & 1){ input[test_rand() % (input.size() + 1)] = '\0'; }
+
+            uint32_t expected_overflows = 0;
+            auto expected = split_lines(input, N, &expected_overflows);
+
+            LineBuffer<N> lines;
+            std::vector<std::string> result;
+
+            for(char c : input)
+            {
+                if(lines.feed(c))
+                {
+                    CHECK(strlen(lines.line()) == lines.length());
+                    result.emplace_back(lines.line(), lines.length());
+                }
+            }
+            CHECK(result == expected);
+            CHECK(lines.num_overflows() == expected_overflows);
+
+            // a partial line is discarded, the next one starts clean
+            lines.clear();
+            CHECK(lines.feed('x') == false && lines.feed('\n') && !strcmp(lines.line(), "x"));
+        }
+    }
+
+    void fuzz_parse_int()
+    {
+        uint32_t num_valid = 0;
+
+        for(uint32_t i = 0; i < 500000; ++i)
+        {
+            std::string str = random_string(i & 1 ? "0123456789" : "0123456789+- a.", 12);
+            if(i % 7 == 0){ str = "-" + random_string("0123456789", 11); }
+
+            // reference: optional sign, only digits, within int32_t
+            size_t first = str.size() && (str[0] == '-' || str[0] == '+') ? 1 : 0;
+            bool expected = str.size() > first &&
+                            str.find_first_not_of("0123456789", first) == std::string::npos;
+            long long ref = expected ? strtoll(str.c_str(), nullptr, 10) : 0;
+            expected = expected && ref >= INT32_MIN && ref <= INT32_MAX;
+
+            int32_t val = 0;
+            bool ok = parse_int({str.data(), str.size()}, &val);
+            CHECK(ok == expected);
+            if(ok && expected){ CHECK(val == ref); num_valid++; }
+        }
+
+        // the edges of the range
+        int32_t val;
+        CHECK(parse_int({"2147483647", 10}, &val) && val == INT32_MAX);
+        CHECK(parse_int({"-2147483648", 11}, &val) && val == INT32_MIN);
+        CHECK(!parse_int({"2147483648", 10}, &val) && !parse_int({"-2147483649", 11}, &val));
+        CHECK(!parse_int({"-", 1}, &val) && !parse_int({"", 0}, &val));
+        printf("parse_int: %u of 500000 random tokens valid\n", num_valid);
+    }
+
+    void fuzz_parse_float()
+    {
+        float max_error = 0.f;
+
+        for(uint32_t i = 0; i < 500000; ++i)
+        {
+            std::string str = random_string(i & 1 ? "0123456789." : "0123456789.-+ e", 9);
+
+            // reference: optional sign, digits with at most one point, no exponent
+            size_t first = str.size() && (str[0] == '-' || str[0] == '+') ? 1 : 0;
+            size_t point = str.find('.', first);
+            bool expected = str.find_first_not_of("0123456789.", first) == std::string::npos &&
+                            str.find_first_of("0123456789", first) != std::string::npos &&
+                            (point == std::string::npos ||
+                             str.find('.', point + 1) == std::string::npos);
+
+            float val = 0.f;
+            bool ok = parse_float({str.data(), str.size()}, &val);
+            CHECK(ok == expected);
+
+            if(ok && expected)
+            {
+                double ref = strtod(str.c_str(), nullptr);
+                float err = fabs(val - ref) / (fabs(ref) > 1. ? fabs(ref) : 1.);
+                max_error = err > max_error ? err : max_error;
+            }
+        }
+        CHECK(max_error < 1e-6f);
+        printf("parse_float: max. relative error %.2e\n", max_error);
+    }
+
+    void fuzz_dispatch()
+    {
+        // prefixes, extensions and case-changes of the table-names, plus noise
+        const char *names[] = {"", "A", "AB", "ABC", "B", "BRIGHTNESS", "BRIGHTNES", "ID", "id",
+                               "SEGMENT", "SEGMENTS", "SEGMENTSS", "text", "TEXT", "Z", "\xff"};
+        constexpr uint32_t num_names = sizeof(names) / sizeof(names[0]);
+        const char *separators[] = {"", " ", ":", ": ", "x"};
+
+        for(uint32_t i = 0; i < 200000; ++i)
+        {
+            std::string line = random_string(" ", 2) + names[test_rand() % num_names];
+            line += separators[test_rand() % 5];
+
+            int32_t sum = 0;
+            uint32_t num_args = test_rand() % 4;
+
+            for(uint32_t j = 0; j < num_args; ++j)
+            {
+                int32_t val = (int32_t)(test_rand() % 2001) - 1000;
+                line += " " + std::to_string(val) + random_string(" ", 2);
+                sum += val;
+            }
+
+            // reference: linear search for the name up to ' ' or ':'
+            size_t start = line.find_first_not_of(' ');
+            std::string name = start == std::string::npos ? "" :
+                               line.substr(start, line.find_first_of(" :", start) - start);
+            int32_t expected = -1;
+            for(uint32_t j = 0; j < g_num_commands; ++j)
+            {
+                if(!name.empty() && name == g_commands[j].name){ expected = j; }
+            }
+
+            device_t device;
+            bool found = dispatch_command(g_commands, device, line.data(), line.size());
+            CHECK(found == (expected >= 0));
+            CHECK(device.command == expected);
+
+            // a known name is delimited by ' ', ':' or the line-end, all arguments arrive
+            if(expected >= 0){ CHECK(device.num_args == num_args && device.sum == sum); }
+        }
+    }
+}
+
+int main()
+{
+    fuzz_line_buffer();
+    fuzz_parse_int();
+    fuzz_parse_float();
+    fuzz_dispatch();
+
+    // serial-path throughput: bytes -> lines -> dispatch -> integer-arguments
+    const char input[] = "SEGMENT: 1 2 3 4 5 6 7\r\nBRIGHTNESS 100\r\nID\r\n";
+    constexpr size_t num_bytes = sizeof(input) - 1;
+    LineBuffer<128> lines;
+    device_t device;
+
+    double us = time_us([&]
+    {
+        for(size_t i = 0; i < num_bytes; ++i)
+        {
+            if(lines.feed(input[i]))
+            {
+                dispatch_command(g_commands, device, lines.line(), lines.length());
+            }
+        }
+        do_not_optimize(device.sum);
+    }, 200000);
+
+    CHECK(device.sum == 200000 * (28 + 100));
+    printf("%zu bytes, 3 commands: %.3f us, %.2f ns per byte\n", num_bytes, us,
+           1000 * us / num_bytes);
+    return test_result("command_parser_test");
+}
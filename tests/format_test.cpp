@@ -0,0 +1,174 @@
+//  format_test.cpp
+//
+//  Format: fmt_int()/fmt_uint() against snprintf() for random and edge-case values,
+//  fmt_fixed() against "%.*f" for random magnitudes and precisions, chained appends,
+//  and a cap_sense_mpr-style output line against the former sprintf + strcat version
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "test_utils.h"
+#include "Format.h"
+
+using namespace kinski;
+
+namespace
+{
+    //! random value in [-1, 1)
+    float random_unit(){ return (test_rand() % 2000000) / 1000000.f - 1.f; }
+
+    void check_integers()
+    {
+        char result[16], expected[16];
+
+        const int32_t edges[] = {0, 1, -1, 9, 10, -10, 99, 100, 999999999, 1000000000,
+                                 INT32_MAX, INT32_MIN, INT32_MIN + 1};
+
+        for(int32_t val : edges)
+        {
+            snprintf(expected, sizeof(expected), "%d", val);
+            CHECK(fmt_int(result, val) == result + strlen(expected) && !strcmp(result, expected));
+        }
+
+        for(uint32_t i = 0; i < 2000000; ++i)
+        {
+            // spread over all digit-counts, not just the large ones
+            uint32_t val = test_rand() >> (test_rand() % 32);
+
+            snprintf(expected, sizeof(expected), "%u", val);
+            CHECK(fmt_uint(result, val) - result == (ptrdiff_t)strlen(expected));
+            CHECK(!strcmp(result, expected));
+
+            snprintf(expected, sizeof(expected), "%d", (int32_t)val);
+            fmt_int(result, (int32_t)val);
+            CHECK(!strcmp(result, expected));
+            CHECK(strlen(result) <= FMT_INT_MAX_CHARS);
+        }
+        snprintf(expected, sizeof(expected), "%u", UINT32_MAX);
+        CHECK(fmt_uint(result, UINT32_MAX) && !strcmp(result, expected));
+    }
+
+    void check_fixed()
+    {
+        char result[32], expected[32];
+        uint32_t num_exact = 0, num_short = 0, num_values = 2000000;
+
+        for(uint32_t i = 0; i < num_values; ++i)
+        {
+            float val = random_unit() * powf(10.f, (float)(test_rand() % 7) - 3.f);
+            uint8_t precision = test_rand() % (FMT_MAX_PRECISION + 1);
+
+            fmt_fixed(result, val, precision);
+            snprintf(expected, sizeof(expected), "%.*f", precision, (double)val);
+
+            // printf keeps the sign of values rounding to zero, fmt_fixed() does not
+            if(expected[0] == '-' && atof(expected) == 0.){ memmove(expected, expected + 1, 31); }
+
+            // same layout, at most one unit off in the last digit (float scaling vs. double)
+            CHECK(strlen(result) + 1 >= strlen(expected) && strlen(result) <= strlen(expected) + 1);
+            CHECK((strchr(result, '.') != nullptr) == (precision > 0));
+            CHECK(fabs(atof(result) - atof(expected)) <= 1.001 * pow(10., -precision) +
+                                                         1e-6 * fabs(val));
+
+            // identical, as long as the scaled value fits the float-mantissa with room to spare,
+            // except close to a rounding-boundary, where scaling in float decides differently
+            if(fabsf(val) * powf(10.f, precision) < 1e6f)
+            {
+                num_short++;
+                num_exact += !strcmp(result, expected);
+            }
+        }
+        CHECK(num_exact > num_short * 99 / 100);
+        printf("fmt_fixed: %.3f%% of %u values below 1e6 units identical to printf\n",
+               100. * num_exact / num_short, num_short);
+
+        struct { float val; uint8_t precision; const char *str; } cases[] =
+        {
+            {0.f, 3, "0.000"}, {-0.f, 3, "0.000"}, {-.0004f, 3, "0.000"}, {-.05f, 3, "-0.050"},
+            {1.9996f, 3, "2.000"}, {12.5f, 0, "13"}, {.5f, 2, "0.50"}, {-1.25f, 1, "-1.3"},
+            {.000001f, 6, "0.000001"}, {123.456f, 9, "123.456000"}, {NAN, 3, "0.000"},
+            {1e12f, 3, "4294967.040"}, {-1e12f, 0, "-4294967040"}
+        };
+
+        for(const auto &c : cases)
+        {
+            char *end = fmt_fixed(result, c.val, c.precision);
+            CHECK(!strcmp(result, c.str) && end == result + strlen(c.str));
+            if(strcmp(result, c.str)){ fprintf(stderr, "  '%s' != '%s'\n", result, c.str); }
+        }
+    }
+
+    void check_append()
+    {
+        char buf[64];
+        char *ptr = fmt_str(buf, "ID ");
+        ptr = fmt_int(ptr, -42);
+        ptr = fmt_char(ptr, ' ');
+        ptr = fmt_fixed(ptr, .25f, 2);
+        ptr = fmt_char(ptr, ' ');
+        ptr = fmt_uint(ptr, 7);
+        CHECK(!strcmp(buf, "ID -42 0.25 7") && ptr == buf + strlen(buf));
+    }
+
+    constexpr uint32_t g_num_sensors = 12;
+    uint16_t g_touch_values[g_num_sensors];
+    float g_proxy_values[g_num_sensors];
+
+    //! "<touch> <proximity> ..." for all sensors, as cap_sense_mpr sends it
+    size_t format_line(char *the_buf)
+    {
+        char *ptr = the_buf;
+
+        for(uint32_t i = 0; i < g_num_sensors; ++i)
+        {
+            ptr = fmt_uint(ptr, g_touch_values[i]);
+            ptr = fmt_char(ptr, ' ');
+            ptr = fmt_fixed(ptr, g_proxy_values[i]);
+            ptr = fmt_char(ptr, ' ');
+        }
+        ptr[-1] = '\n';
+        return ptr - the_buf;
+    }
+
+    //! the same line, with the previous sprintf-based fmt_real_to_str() and strcat()
+    size_t format_line_sprintf(char *the_buf)
+    {
+        char tmp[32];
+        the_buf[0] = '\0';
+
+        for(uint32_t i = 0; i < g_num_sensors; ++i)
+        {
+            float val = g_proxy_values[i];
+            sprintf(tmp, "%d %d.%03d ", g_touch_values[i], (int)val,
+                    (int)((val - (int)val) * 1000));
+            strcat(the_buf, tmp);
+        }
+        size_t len = strlen(the_buf);
+        the_buf[len - 1] = '\n';
+        return len;
+    }
+}
+
+int main()
+{
+    check_integers();
+    check_fixed();
+    check_append();
+
+    for(uint32_t i = 0; i < g_num_sensors; ++i)
+    {
+        g_touch_values[i] = test_rand() % 1024;
+        g_proxy_values[i] = (random_unit() + 1.f) * .5f;
+    }
+
+    char buf[256];
+    size_t len = 0;
+    double fmt_us = time_us([&]{ len += format_line(buf); do_not_optimize(buf[0]); }, 200000);
+    double printf_us = time_us([&]{ len += format_line_sprintf(buf); do_not_optimize(buf[0]); },
+                               200000);
+
+    printf("%u sensors per line: Format %.0f ns, sprintf + strcat %.0f ns\n", g_num_sensors,
+           1000 * fmt_us, 1000 * printf_us);
+    return test_result("format_test");
+}
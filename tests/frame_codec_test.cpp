@@ -0,0 +1,322 @@
+//  frame_codec_test.cpp
+//
+//  FrameParser and decode_frame() against a stream encoded by tube_codec.py / tube_stream.py
+//  (see gen_codec_vectors.py): every update has to reproduce the LED-state the host encoded.
+//  malformed op-streams are rejected, and a benchmark for parsing and decoding.
+//  the stream plus split raw updates, with dropped frames, fed through a simulated 2 Mbaud serial
+//  loop into write_frame(), as tube_base_2017 applies frames
+
+#include <vector>
+#include "test_utils.h"
+#include "FrameParser.h"
+#include "FrameCodec.h"
+
+#ifndef CODEC_VECTORS
+#define CODEC_VECTORS "build/codec_vectors.bin"
+#endif
+
+namespace
+{
+    struct vectors_t
+    {
+        uint32_t num_bytes = 0, num_updates = 0;
+        std::vector<uint8_t> stream, states;
+    };
+
+    bool load_vectors(const char *the_path, vectors_t &the_vectors)
+    {
+        FILE *f = fopen(the_path, "rb");
+        if(!f){ return false; }
+
+        uint32_t header[3];
+        bool ok = fread(header, sizeof(header), 1, f) == 1;
+
+        if(ok)
+        {
+            the_vectors.num_bytes = header[0];
+            the_vectors.num_updates = header[1];
+            the_vectors.stream.resize(header[2]);
+            the_vectors.states.resize(header[0] * header[1]);
+            ok = fread(the_vectors.stream.data(), header[2], 1, f) == 1 &&
+                 fread(the_vectors.states.data(), the_vectors.states.size(), 1, f) == 1;
+        }
+        fclose(f);
+        return ok;
+    }
+
+    //! parse and decode the_stream into the_leds, like tube_base_2017 does. returns #updates
+    uint32_t replay(const std::vector<uint8_t> &the_stream, std::vector<uint8_t> &the_leds,
+                    FrameParser &the_parser, const vectors_t *the_expected = nullptr)
+    {
+        uint32_t num_updates = 0;
+
+        for(uint8_t c : the_stream)
+        {
+            if(!the_parser.feed(c)){ continue; }
+            const frame_header_t &header = the_parser.header();
+
+            bool ok = header.offset < the_leds.size() &&
+                decode_frame(the_parser.payload(), header.length, the_leds.data() + header.offset,
+                             the_leds.size() - header.offset, 4);
+            CHECK(ok);
+
+            if(header.flags & FRAME_SHOW)
+            {
+                if(the_expected && num_updates < the_expected->num_updates)
+                {
+                    const uint8_t *state = the_expected->states.data() +
+                        num_updates * the_expected->num_bytes;
+                    CHECK(!memcmp(the_leds.data(), state, the_expected->num_bytes));
+                }
+                num_updates++;
+            }
+        }
+        return num_updates;
+    }
+
+    // 2 Mbaud, 8N1: 200 bytes arrive during a 1ms loop()-iteration
+    constexpr uint32_t g_baud_rate = 2000000, g_loop_us = 1000;
+    constexpr uint32_t g_bytes_per_loop = g_baud_rate / 10 * g_loop_us / 1000000;
+
+    //! a frame within a serial stream and the update it belongs to
+    struct frame_t
+    {
+        size_t begin, end;
+        uint32_t update;
+        uint16_t frame_number;
+        uint8_t flags;
+
+        //! not received or not applicable, following a lost frame up to the next keyframe
+        bool dropped, stale;
+    };
+
+    //! a stream as sent, the frames received and the LED-state expected after every update
+    struct serial_t
+    {
+        std::vector<uint8_t> bytes;
+        std::vector<frame_t> frames;
+        std::vector<uint8_t> states;
+        uint32_t num_bytes = 0;
+    };
+
+    //! append a frame, as tube_stream.make_frame() builds it
+    void append_frame(std::vector<uint8_t> &the_stream, uint16_t the_frame_number,
+                      uint8_t the_flags, uint16_t the_offset, const uint8_t *the_payload,
+                      uint16_t the_length)
+    {
+        const uint8_t header[] = {(uint8_t)the_frame_number, (uint8_t)(the_frame_number >> 8), 0,
+                                  the_flags, (uint8_t)the_offset, (uint8_t)(the_offset >> 8),
+                                  (uint8_t)the_length, (uint8_t)(the_length >> 8)};
+        uint16_t crc = crc16_ccitt(header, sizeof(header));
+        crc = crc16_ccitt(the_payload, the_length, crc);
+
+        the_stream.push_back(FRAME_SYNC_0);
+        the_stream.push_back(FRAME_SYNC_1);
+        the_stream.insert(the_stream.end(), header, header + sizeof(header));
+        the_stream.insert(the_stream.end(), the_payload, the_payload + the_length);
+        the_stream.push_back(crc & 0xFF);
+        the_stream.push_back(crc >> 8);
+    }
+
+    /*! the encoded updates of the_vectors, followed by the_num_raw random raw updates, split into
+     *  frames of FRAME_MAX_PAYLOAD at increasing offsets. every the_drop_interval-th frame is lost
+     */
+    serial_t make_serial(const vectors_t &the_vectors, uint32_t the_num_raw,
+                         uint32_t the_drop_interval)
+    {
+        serial_t ret;
+        ret.num_bytes = the_vectors.num_bytes;
+        ret.states = the_vectors.states;
+        std::vector<uint8_t> stream = the_vectors.stream;
+
+        std::vector<uint8_t> data(ret.num_bytes);
+        uint16_t frame_number = 0;
+        FrameParser parser;
+        for(uint8_t c : stream)
+        {
+            if(parser.feed(c)){ frame_number = parser.header().frame_number; }
+        }
+
+        for(uint32_t i = 0; i < the_num_raw; ++i)
+        {
+            for(auto &b : data){ b = test_rand(); }
+            ret.states.insert(ret.states.end(), data.begin(), data.end());
+
+            for(uint32_t offset = 0; offset < ret.num_bytes; offset += FRAME_MAX_PAYLOAD)
+            {
+                uint32_t length = min(ret.num_bytes - offset, (uint32_t)FRAME_MAX_PAYLOAD);
+                uint8_t flags = offset + length == ret.num_bytes ? FRAME_SHOW : 0;
+                append_frame(stream, ++frame_number, flags, offset, data.data() + offset, length);
+            }
+        }
+
+        // frame boundaries, the updates they belong to and which of them get lost
+        parser.reset();
+        uint32_t update = 0;
+        bool stale = false;
+
+        for(size_t i = 0, begin = 0; i < stream.size(); ++i)
+        {
+            if(!parser.feed(stream[i])){ continue; }
+            const frame_header_t &header = parser.header();
+
+            frame_t f = {begin, i + 1, update, header.frame_number, header.flags, false, false};
+            f.dropped = ret.frames.size() % the_drop_interval == the_drop_interval - 1;
+
+            if(f.flags & FRAME_KEY || !(f.flags & FRAME_ENCODED)){ stale = false; }
+            stale = stale || f.dropped;
+            f.stale = stale;
+
+            ret.frames.push_back(f);
+            begin = i + 1;
+            if(header.flags & FRAME_SHOW){ update++; }
+        }
+
+        for(const frame_t &f : ret.frames)
+        {
+            if(!f.dropped){ ret.bytes.insert(ret.bytes.end(), &stream[f.begin], &stream[f.end]); }
+        }
+        return ret;
+    }
+
+    /*! feed the_serial byte-wise, g_bytes_per_loop per loop()-iteration, and apply its frames.
+     *  returns the longest iteration in us, the_check compares every shown update
+     */
+    double run_serial(const serial_t &the_serial, bool the_check)
+    {
+        FrameParser parser;
+        frame_stream_t stream;
+        std::vector<uint8_t> leds(the_serial.num_bytes, 0);
+        size_t frame_index = 0, pos = 0;
+        uint32_t num_shown = 0, num_dropped = 0;
+        double max_us = 0.;
+
+        while(pos < the_serial.bytes.size())
+        {
+            size_t end = min(pos + g_bytes_per_loop, the_serial.bytes.size());
+            auto start = std::chrono::steady_clock::now();
+
+            for(; pos < end; ++pos)
+            {
+                if(!parser.feed(the_serial.bytes[pos])){ continue; }
+                bool written = write_frame(parser, stream, leds.data(), leds.size(), 4);
+                if(!the_check){ continue; }
+
+                // skip the lost ones
+                while(the_serial.frames[frame_index].dropped){ frame_index++; num_dropped++; }
+                const frame_t &f = the_serial.frames[frame_index++];
+                CHECK(f.frame_number == parser.header().frame_number);
+
+                // losses count once the next frame arrives, up to a keyframe nothing is written
+                CHECK(parser.num_lost() == num_dropped && written == !f.stale);
+
+                if(f.flags & FRAME_SHOW && !f.stale)
+                {
+                    const uint8_t *state = the_serial.states.data() +
+                                           f.update * the_serial.num_bytes;
+                    CHECK(!memcmp(leds.data(), state, the_serial.num_bytes));
+                    num_shown++;
+                }
+            }
+            std::chrono::duration<double, std::micro> dur =
+                std::chrono::steady_clock::now() - start;
+            max_us = max(max_us, dur.count());
+        }
+
+        if(the_check)
+        {
+            uint32_t num_stale = 0, num_updates = the_serial.states.size() / the_serial.num_bytes;
+            for(const frame_t &f : the_serial.frames)
+            {
+                num_stale += f.flags & FRAME_SHOW && f.stale;
+            }
+            CHECK(!parser.num_errors() && num_shown + num_stale == num_updates);
+            CHECK(num_dropped && num_stale && parser.num_lost() == num_dropped);
+        }
+        return max_us;
+    }
+}
+
+int main()
+{
+    vectors_t vectors;
+
+    if(!load_vectors(CODEC_VECTORS, vectors))
+    {
+        fprintf(stderr, "could not read %s, run gen_codec_vectors.py\n", CODEC_VECTORS);
+        return 1;
+    }
+
+    // round-trip, every update matches the host's LED-state
+    std::vector<uint8_t> leds(vectors.num_bytes, 0);
+    FrameParser parser;
+    CHECK(replay(vectors.stream, leds, parser, &vectors) == vectors.num_updates);
+    CHECK(!parser.num_errors() && !parser.num_lost());
+
+    uint32_t num_frames = parser.num_frames();
+    printf("%u updates in %u frames, %zu bytes encoded vs. %u raw (%.1f%%)\n",
+           vectors.num_updates, num_frames, vectors.stream.size(),
+           vectors.num_updates * vectors.num_bytes,
+           100.f * vectors.stream.size() / (vectors.num_updates * vectors.num_bytes));
+
+    // a flipped bit is caught by the CRC, the frame is dropped and counted
+    {
+        std::vector<uint8_t> stream = vectors.stream;
+        stream[stream.size() / 2] ^= 0x10;
+        FrameParser p;
+        std::fill(leds.begin(), leds.end(), 0);
+        replay(stream, leds, p);
+        CHECK(p.num_errors() + p.num_lost() >= 1 && p.num_frames() < num_frames);
+    }
+
+    // malformed op-streams
+    {
+        uint8_t dst[16] = {};
+
+        // literal of 2 pixels, only one follows
+        const uint8_t truncated[] = {(OP_LITERAL << 6) | 1, 1, 2, 3, 4};
+        CHECK(!decode_frame(truncated, sizeof(truncated), dst, sizeof(dst), 4));
+
+        // run without its pixel
+        const uint8_t no_pixel[] = {(OP_RUN << 6) | 0, 1, 2};
+        CHECK(!decode_frame(no_pixel, sizeof(no_pixel), dst, sizeof(dst), 4));
+
+        // skip past the end of the destination
+        const uint8_t overflow[] = {(OP_SKIP << 6) | 4};
+        CHECK(!decode_frame(overflow, sizeof(overflow), dst, sizeof(dst), 4));
+
+        // exactly filling the destination is fine
+        const uint8_t fill[] = {(OP_RUN << 6) | 3, 9, 8, 7, 6};
+        CHECK(decode_frame(fill, sizeof(fill), dst, sizeof(dst), 4) && dst[12] == 9);
+
+        // xor-run applied twice restores the content
+        const uint8_t xor_run[] = {(OP_XOR_RUN << 6) | 3, 0xFF, 0, 0xFF, 0};
+        CHECK(decode_frame(xor_run, sizeof(xor_run), dst, sizeof(dst), 4) && dst[0] == 0xF6);
+        CHECK(decode_frame(xor_run, sizeof(xor_run), dst, sizeof(dst), 4) && dst[0] == 9);
+    }
+
+    // benchmark, the whole stream through parser and decoder
+    double us = time_us([&]
+    {
+        FrameParser p;
+        replay(vectors.stream, leds, p);
+        do_not_optimize(leds[0]);
+    }, 200);
+
+    printf("parse + decode: %.2f us per update, %.1f MB/s of stream\n", us / vectors.num_updates,
+           vectors.stream.size() / us);
+
+    // a serial sender at 2 Mbaud: encoded updates, then raw ones, with every 50th frame lost
+    serial_t serial = make_serial(vectors, 20, 50);
+    run_serial(serial, true);
+
+    double serial_us = serial.bytes.size() * 10. * 1e6 / g_baud_rate;
+    double total_us = time_us([&]{ run_serial(serial, false); }, 20);
+    double max_us = run_serial(serial, false);
+    CHECK(total_us < serial_us);
+
+    printf("%zu bytes in %zu frames at 2 Mbaud: %.1f ms on the wire, parse + apply %.2f ms, "
+           "max. %.1f us per %u byte loop()\n", serial.bytes.size(), serial.frames.size(),
+           serial_us / 1000, total_us / 1000, max_us, g_bytes_per_loop);
+    return test_result("frame_codec_test");
+}
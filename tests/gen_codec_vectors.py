@@ -0,0 +1,86 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+'''
+test-vectors for frame_codec_test: a stream of encoded frames, built with tube_codec.py and
+tube_stream.py, followed by the LED-state expected after every update
+
+usage: gen_codec_vectors.py <output>
+
+output layout (little-endian):
+  num_bytes (4) | num_updates (4) | stream_length (4) | stream | num_updates * num_bytes states
+'''
+
+import sys, os, struct, random, colorsys
+
+TUBE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tube_base_2017')
+sys.path.insert(0, TUBE_DIR)
+import tube_codec
+import tube_stream
+
+NUM_PIXELS = 300
+NUM_UPDATES = 120
+KEYFRAME_INTERVAL = 30
+
+#############################################################
+
+def pattern(the_index, the_previous, the_rand):
+  """alternates a moving rainbow, static regions with sparse changes and uniform fills"""
+  kind = (the_index // 20) % 3
+
+  if kind == 0 or the_previous is None:
+    data = bytearray()
+    for i in range(NUM_PIXELS):
+      r, g, b = colorsys.hsv_to_rgb((the_index * 0.02 + i / float(NUM_PIXELS)) % 1.0, 1.0, 1.0)
+      data += bytearray([int(r * 255), int(g * 255), int(b * 255), 0])
+    return bytes(data)
+
+  data = bytearray(the_previous)
+
+  if kind == 1:
+    # a few short stretches change, some by the same xor-pattern
+    for _ in range(the_rand.randint(1, 6)):
+      start, length = the_rand.randrange(NUM_PIXELS), the_rand.randint(1, 80)
+      pixel = bytearray(the_rand.getrandbits(8) for _ in range(4))
+      for i in range(start, min(start + length, NUM_PIXELS)):
+        data[4 * i:4 * i + 4] = bytearray(a ^ b for a, b in zip(data[4 * i:4 * i + 4], pixel))
+  else:
+    # uniform blocks
+    for start in range(0, NUM_PIXELS, 50):
+      pixel = bytearray(the_rand.getrandbits(8) for _ in range(4))
+      for i in range(start, min(start + 50, NUM_PIXELS)): data[4 * i:4 * i + 4] = pixel
+  return bytes(data)
+
+def main(the_path):
+  rand = random.Random(42)
+  stream, states = bytearray(), bytearray()
+  previous, frame_number = None, 0
+
+  for u in range(NUM_UPDATES):
+    data = pattern(u, previous, rand)
+    key = u % KEYFRAME_INTERVAL == 0
+    frames = tube_stream.make_encoded_frames(frame_number, 0, data, None if key else previous)
+    frame_number = (frame_number + len(frames)) & 0xFFFF
+
+    # the python reference-decoder has to agree as well
+    target = bytearray(NUM_PIXELS * 4) if key else bytearray(previous)
+    for f in frames:
+      offset, length = struct.unpack('<HH', f[6:10])
+      tube_codec.decode(f[10:10 + length], target, 4, offset)
+    assert bytes(target) == data
+
+    for f in frames: stream += f
+    states += data
+    previous = data
+
+  with open(the_path, 'wb') as out:
+    out.write(struct.pack('<III', NUM_PIXELS * 4, NUM_UPDATES, len(stream)))
+    out.write(stream)
+    out.write(states)
+
+#############################################################
+
+if __name__ == '__main__':
+  if len(sys.argv) < 2:
+    print(__doc__)
+    sys.exit(1)
+  main(sys.argv[1])
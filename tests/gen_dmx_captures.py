@@ -0,0 +1,174 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+'''
+writes the Art-Net and sACN captures replayed by universe_receiver_test, as libpcap-files
+(Ethernet / IPv4 / UDP) like tcpdump or Wireshark record them, so real recordings can be
+replayed the same way. packet-layouts follow what common controllers send: ArtPoll and ArtDmx,
+E1.31 with priorities, preview-data, start-code 0xDD and stream-termination.
+
+usage: gen_dmx_captures.py <output_dir>
+
+every frame f fills universe u with: slot[0] = f & 0xFF, slot[1] = u, slot[i] = (f + u + i) & 0xFF
+'''
+
+import sys, os, struct
+
+ARTNET_PORT = 6454
+SACN_PORT = 5568
+FRAME_INTERVAL = 0.025
+
+#############################################################
+
+def ip_bytes(the_ip):
+  return bytes(bytearray(int(v) for v in the_ip.split('.')))
+
+def ip_checksum(the_header):
+  s = sum(struct.unpack('!10H', the_header))
+  while s >> 16: s = (s & 0xFFFF) + (s >> 16)
+  return ~s & 0xFFFF
+
+def udp_packet(the_src, the_dst, the_port, the_payload):
+  """Ethernet / IPv4 / UDP, UDP-checksum left at 0 (allowed for IPv4)"""
+  udp = struct.pack('!HHHH', 49152, the_port, 8 + len(the_payload), 0) + the_payload
+  ip = struct.pack('!BBHHHBBH4s4s', 0x45, 0, 20 + len(udp), 0, 0x4000, 64, 17, 0,
+                   ip_bytes(the_src), ip_bytes(the_dst))
+  ip = ip[:10] + struct.pack('!H', ip_checksum(ip)) + ip[12:]
+  eth = b'\xff' * 6 + b'\x02\x00\x00\x00\x00\x05' + b'\x08\x00'
+  return eth + ip + udp
+
+class PcapWriter(object):
+  def __init__(self, the_path):
+    self.file = open(the_path, 'wb')
+    self.file.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+
+  def write(self, the_time, the_packet):
+    secs = int(the_time)
+    self.file.write(struct.pack('<IIII', 1500000000 + secs, int((the_time - secs) * 1e6),
+                                len(the_packet), len(the_packet)))
+    self.file.write(the_packet)
+
+  def close(self):
+    self.file.close()
+
+def slots(the_frame, the_universe, the_num_slots=512):
+  data = bytearray((the_frame + the_universe + i) & 0xFF for i in range(the_num_slots))
+  data[0], data[1] = the_frame & 0xFF, the_universe
+  return bytes(data)
+
+#############################################################
+
+def art_poll():
+  return b'Art-Net\x00' + struct.pack('<H', 0x2000) + struct.pack('!H', 14) + b'\x02\x00'
+
+def art_dmx(the_universe, the_sequence, the_data):
+  return b'Art-Net\x00' + struct.pack('<H', 0x5000) + struct.pack('!HBB', 14, the_sequence, 0) + \
+         struct.pack('<H', the_universe) + struct.pack('!H', len(the_data)) + the_data
+
+def art_sync():
+  return b'Art-Net\x00' + struct.pack('<H', 0x5200) + struct.pack('!H', 14) + b'\x00\x00'
+
+def write_artnet(the_path):
+  """
+  frames   0-99: universes 0, 1 and unmapped 2, ArtPoll every second,
+                 frame 30 lacks universe 1, universe 0 of frame 50 is sent twice
+  frames 100-199: followed by ArtSync
+  5s pause, then frames 200-219 without ArtSync again
+  """
+  out = PcapWriter(the_path)
+  t, src, dst = 0.0, '10.0.0.5', '10.0.0.255'
+
+  for f in range(220):
+    if f == 200: t += 5.0
+    if f % 40 == 0: out.write(t, udp_packet(src, dst, ARTNET_PORT, art_poll()))
+
+    # sequence 0 disables sequencing, so 1-255
+    seq = f % 255 + 1
+
+    for u in (0, 1, 2):
+      if f == 30 and u == 1: continue
+      pkt = udp_packet(src, dst, ARTNET_PORT, art_dmx(u, seq, slots(f, u)))
+      out.write(t + u * 0.0002, pkt)
+      if f == 50 and u == 0: out.write(t + 0.0001, pkt)
+
+    if 100 <= f < 200: out.write(t + 0.001, udp_packet(src, dst, ARTNET_PORT, art_sync()))
+    t += FRAME_INTERVAL
+  out.close()
+
+#############################################################
+
+CID = bytes(bytearray(range(0x10, 0x20)))
+
+def root_layer(the_vector, the_pdu):
+  body = struct.pack('!I', the_vector) + CID + the_pdu
+  return struct.pack('!HH', 0x0010, 0) + b'ASC-E1.17\x00\x00\x00' + \
+         struct.pack('!H', 0x7000 | (len(body) + 2)) + body
+
+def sacn_data(the_universe, the_sequence, the_data, the_sync=0, the_options=0,
+              the_start_code=0):
+  dmp = struct.pack('!BBHHH', 0x02, 0xa1, 0, 1, len(the_data) + 1) + \
+        bytearray([the_start_code]) + the_data
+  dmp = struct.pack('!H', 0x7000 | (len(dmp) + 2)) + dmp
+  name = b'lighting console'.ljust(64, b'\x00')
+  framing = struct.pack('!I', 0x00000002) + name + \
+            struct.pack('!BHBBH', 100, the_sync, the_sequence, the_options, the_universe) + dmp
+  framing = struct.pack('!H', 0x7000 | (len(framing) + 2)) + framing
+  return root_layer(0x00000004, framing)
+
+def sacn_sync(the_sequence, the_sync):
+  framing = struct.pack('!IBHH', 0x00000001, the_sequence, the_sync, 0)
+  framing = struct.pack('!H', 0x7000 | (len(framing) + 2)) + framing
+  return root_layer(0x00000008, framing)
+
+def write_sacn(the_path):
+  """
+  frames   0-99: universes 1, 2 to their multicast-groups, sequence wraps at 255,
+                 preview-data and start-code 0xDD in between, universe 1 of frame 60 twice,
+                 frame 5 carries sequence 0, universe 2 of it twice
+  frames 100-199: synchronization-address 7, each frame followed by a sync-packet,
+                 except frames 150-159, unsynchronized with synchronization-address 0
+  then 3 stream-terminated packets
+  """
+  out = PcapWriter(the_path)
+  t, src = 0.0, '10.0.0.6'
+  seq = {1: 251, 2: 251}
+  sync_seq = 0
+
+  for f in range(200):
+    sync = 7 if f >= 100 and not 150 <= f < 160 else 0
+
+    for u in (1, 2):
+      dst = '239.255.0.%d' % u
+      pkt = udp_packet(src, dst, SACN_PORT, sacn_data(u, seq[u], slots(f, u), sync))
+      out.write(t + u * 0.0002, pkt)
+      if (f, u) in ((60, 1), (5, 2)): out.write(t + u * 0.0002 + 0.0001, pkt)
+      seq[u] = (seq[u] + 1) & 0xFF
+
+      if f % 10 == 5:
+        garbage = bytes(bytearray([0x55]) * 512)
+        out.write(t + 0.0005, udp_packet(src, dst, SACN_PORT,
+                                         sacn_data(u, seq[u], garbage, sync, 0x80)))
+        out.write(t + 0.0006, udp_packet(src, dst, SACN_PORT,
+                                         sacn_data(u, seq[u], garbage, sync, 0, 0xDD)))
+        seq[u] = (seq[u] + 1) & 0xFF
+
+    if sync:
+      out.write(t + 0.001, udp_packet(src, '239.255.0.7', SACN_PORT, sacn_sync(sync_seq, sync)))
+      sync_seq = (sync_seq + 1) & 0xFF
+    t += FRAME_INTERVAL
+
+  for i in range(3):
+    out.write(t, udp_packet(src, '239.255.0.1', SACN_PORT,
+                            sacn_data(1, seq[1], bytes(bytearray(512)), 0, 0x40)))
+    seq[1] = (seq[1] + 1) & 0xFF
+    t += FRAME_INTERVAL
+  out.close()
+
+#############################################################
+
+if __name__ == '__main__':
+  if len(sys.argv) < 2:
+    print(__doc__)
+    sys.exit(1)
+  out_dir = sys.argv[1]
+  write_artnet(os.path.join(out_dir, 'artnet.pcap'))
+  write_sacn(os.path.join(out_dir, 'sacn.pcap'))
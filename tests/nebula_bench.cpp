@@ -0,0 +1,90 @@
+//  nebula_bench.cpp
+//
+//  Nebula: the noise-field is smooth along the tunnel and over time, uses the value-range,
+//  rendering gate by gate matches a single pass, and its per-pixel cost for a full-build
+//  sized tunnel (13 gates of 126 pixels)
+
+#include "test_utils.h"
+#include "Nebula.h"
+
+int main()
+{
+    constexpr uint32_t num_gates = 13, gate_leds = 126, num_pixels = num_gates * gate_leds;
+
+    // gate-positions plus arch-lag, like Tunnel::pixel_positions()
+    static float positions[num_pixels];
+
+    for(uint32_t i = 0; i < num_pixels; ++i)
+    {
+        positions[i] = .3f + (i / gate_leds) * .88f + .5f * ((i % gate_leds) + .5f) / gate_leds;
+    }
+
+    Nebula nebula;
+
+    static uint8_t values[num_pixels], prev[num_pixels];
+    nebula.update(16);
+    nebula.render(positions, num_pixels, prev);
+
+    uint32_t hist[8] = {};
+    int32_t max_step_x = 0, max_step_t = 0;
+
+    for(uint32_t f = 0; f < 600; ++f)
+    {
+        nebula.update(16);
+        nebula.render(positions, num_pixels, values);
+
+        for(uint32_t i = 0; i < num_pixels; ++i)
+        {
+            hist[values[i] >> 5]++;
+
+            // neighbours within a gate are at most a few cm apart
+            if(i % gate_leds)
+            {
+                int32_t d = abs(values[i] - values[i - 1]);
+                max_step_x = d > max_step_x ? d : max_step_x;
+            }
+            int32_t d = abs(values[i] - prev[i]);
+            max_step_t = d > max_step_t ? d : max_step_t;
+        }
+        memcpy(prev, values, sizeof(values));
+    }
+
+    // no jumps between neighbouring pixels or frames
+    CHECK(max_step_x < 12);
+    CHECK(max_step_t < 16);
+
+    // most of the range is used, dark and bright regions both exist
+    uint32_t num_used = 0;
+    for(uint32_t i = 0; i < 8; ++i){ num_used += hist[i] > 600 * num_pixels / 200; }
+    CHECK(num_used >= 5);
+
+    printf("histogram:");
+    for(uint32_t i = 0; i < 8; ++i){ printf(" %.1f%%", 100.f * hist[i] / (600 * num_pixels)); }
+    printf(", max. step %d (pixel) %d (frame)\n", max_step_x, max_step_t);
+
+    // the same state renders the same frame, also when rendered gate by gate
+    Nebula other;
+    for(uint32_t f = 0; f < 601; ++f){ other.update(16); }
+    other.render(positions, num_pixels, prev);
+    CHECK(!memcmp(prev, values, sizeof(values)));
+
+    for(uint32_t i = 0; i < num_gates; ++i)
+    {
+        other.render(positions + i * gate_leds, gate_leds, prev + i * gate_leds);
+    }
+    CHECK(!memcmp(prev, values, sizeof(values)));
+
+    double us = time_us([&]
+    {
+        nebula.update(16);
+        for(uint32_t i = 0; i < num_gates; ++i)
+        {
+            nebula.render(positions + i * gate_leds, gate_leds, values + i * gate_leds);
+        }
+        do_not_optimize(values[0]);
+    }, 5000);
+
+    printf("%u pixels: %.2f us per frame, %.2f ns per pixel (both octaves, per gate)\n", num_pixels, us,
+           1000 * us / num_pixels);
+    return test_result("nebula_bench");
+}
@@ -0,0 +1,109 @@
+//  sample_stats_bench.cpp
+//
+//  compute_sample_stats() against the previous multi-pass approach (rms, mean, min, max
+//  in separate loops, like the CMSIS calls in fuckpoop), results are checked against each other
+
+#include <math.h>
+#include "SampleStats.h"
+#include "test_utils.h"
+
+using namespace kinski;
+
+namespace
+{
+    struct multi_pass_t
+    {
+        int16_t min, max;
+        int32_t sum;
+        uint64_t sum_sq;
+        uint32_t zero_crossings;
+    };
+
+    // one loop per statistic, as with arm_rms_q15, arm_mean_q15, arm_min_q31, arm_max_q31
+    multi_pass_t multi_pass(const int16_t *the_samples, size_t the_num_samples)
+    {
+        multi_pass_t ret = {INT16_MAX, INT16_MIN, 0, 0, 0};
+
+        for(size_t i = 0; i < the_num_samples; ++i)
+        {
+            ret.sum_sq += (uint64_t)((int32_t)the_samples[i] * the_samples[i]);
+        }
+        for(size_t i = 0; i < the_num_samples; ++i){ ret.sum += the_samples[i]; }
+        for(size_t i = 0; i < the_num_samples; ++i)
+        {
+            if(the_samples[i] < ret.min){ ret.min = the_samples[i]; }
+        }
+        for(size_t i = 0; i < the_num_samples; ++i)
+        {
+            if(the_samples[i] > ret.max){ ret.max = the_samples[i]; }
+        }
+        bool prev_neg = false;
+
+        for(size_t i = 0; i < the_num_samples; ++i)
+        {
+            bool neg = the_samples[i] < 0;
+            ret.zero_crossings += neg != prev_neg;
+            prev_neg = neg;
+        }
+        return ret;
+    }
+}
+
+int main()
+{
+    // odd sizes exercise the remainder-loop
+    const size_t block_sizes[] = {1, 3, 64, 255, 512, 1027};
+
+    for(size_t num_samples : block_sizes)
+    {
+        int16_t buf[1027];
+        for(size_t i = 0; i < num_samples; ++i){ buf[i] = (int16_t)test_rand(); }
+
+        auto s = compute_sample_stats(buf, num_samples);
+        auto ref = multi_pass(buf, num_samples);
+
+        CHECK(s.min == ref.min);
+        CHECK(s.max == ref.max);
+        CHECK(s.sum == ref.sum);
+        CHECK(s.sum_sq == ref.sum_sq);
+        CHECK(s.zero_crossings == ref.zero_crossings);
+        CHECK(s.num_samples == num_samples);
+    }
+
+    // other sample-types
+    float f[5] = {1.f, -1.f, 2.f, -3.f, 4.f};
+    auto fs = compute_sample_stats(f, 5);
+    CHECK(fs.min == -3.f && fs.max == 4.f && fs.zero_crossings == 4);
+
+    uint16_t u[6] = {1, 2, 3, 4, 5, 6};
+    auto us = compute_sample_stats(u, 6);
+    CHECK(fabsf(us.mean() - 3.5f) < 1e-6f);
+    CHECK(fabsf(us.rms() - sqrtf(91.f / 6)) < 1e-5f);
+
+    // block continuation
+    int16_t neg[2] = {-1, -2};
+    CHECK(compute_sample_stats(neg, 2, int16_t(-5)).zero_crossings == 0);
+    CHECK(compute_sample_stats(neg, 2, int16_t(5)).zero_crossings == 1);
+
+    // benchmark on a typical I2S block
+    constexpr size_t num_samples = 512;
+    constexpr uint32_t num_iterations = 200000;
+    int16_t buf[num_samples];
+    for(size_t i = 0; i < num_samples; ++i){ buf[i] = (int16_t)test_rand(); }
+
+    double single_us = time_us([&]
+    {
+        auto s = compute_sample_stats(buf, num_samples);
+        do_not_optimize(s);
+    }, num_iterations);
+
+    double multi_us = time_us([&]
+    {
+        auto s = multi_pass(buf, num_samples);
+        do_not_optimize(s);
+    }, num_iterations);
+
+    printf("%zu samples: single-pass %.3f us, multi-pass %.3f us (%.2fx)\n", num_samples,
+           single_us, multi_us, multi_us / single_us);
+    return test_result("sample_stats_bench");
+}
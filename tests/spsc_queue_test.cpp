@@ -0,0 +1,142 @@
+//  spsc_queue_test.cpp
+//
+//  two-thread stress test for SPSC_Queue. a small capacity keeps both sides on the same slots,
+//  multi-word elements expose torn or stale reads, a missing acquire/release would show up
+//  as gaps, duplicates or corrupt payloads (reliably so under -fsanitize=thread)
+
+#include <atomic>
+#include <thread>
+#include "SPSC_Queue.h"
+#include "test_utils.h"
+
+using namespace kinski;
+
+namespace
+{
+    struct event_t
+    {
+        uint32_t seq;
+        uint32_t payload[3];
+    };
+
+    inline event_t make_event(uint32_t the_seq)
+    {
+        return {the_seq, {the_seq * 2654435761u, ~the_seq, the_seq ^ 0xA5A5A5A5u}};
+    }
+
+    inline bool valid(const event_t &the_event, uint32_t the_seq)
+    {
+        event_t e = make_event(the_seq);
+        return the_event.seq == e.seq && the_event.payload[0] == e.payload[0] &&
+               the_event.payload[1] == e.payload[1] && the_event.payload[2] == e.payload[2];
+    }
+
+    constexpr uint32_t g_num_events = 1000000;
+
+    // producer never gives up, every event must arrive in order, single and batch pops
+    template <uint32_t N> void stress_lossless(bool the_batch)
+    {
+        static SPSC_Queue<event_t, N> queue;
+        uint32_t num_errors = 0, num_pops = 0;
+
+        std::thread producer([]
+        {
+            for(uint32_t i = 0; i < g_num_events;)
+            {
+                if(queue.push(make_event(i))){ i++; }
+                else{ std::this_thread::yield(); }
+            }
+        });
+
+        event_t buf[N];
+
+        for(uint32_t expected = 0; expected < g_num_events;)
+        {
+            uint32_t num = the_batch ? queue.pop(buf, N) : queue.pop(buf[0]);
+            if(!num){ std::this_thread::yield(); continue; }
+            num_pops++;
+
+            for(uint32_t i = 0; i < num; ++i, ++expected)
+            {
+                if(!valid(buf[i], expected)){ num_errors++; }
+            }
+        }
+        producer.join();
+
+        CHECK(!num_errors);
+        CHECK(queue.empty());
+
+        // push() failed whenever the consumer lagged behind, those are counted as drops
+        printf("capacity %u, %s: %u pops, %u rejected pushes\n", N, the_batch ? "batch" : "single",
+               num_pops, queue.num_dropped());
+    }
+
+    // ISR-style producer that drops when full: what arrives is in order and intact,
+    // and arrived + dropped accounts for every push
+    void stress_dropping()
+    {
+        static SPSC_Queue<event_t, 8> queue;
+        static std::atomic<bool> done(false);
+
+        std::thread producer([]
+        {
+            for(uint32_t i = 0; i < g_num_events; ++i)
+            {
+                queue.push(make_event(i));
+
+                // give the consumer a chance every now and then
+                if(!(i & 15)){ std::this_thread::yield(); }
+            }
+            done = true;
+        });
+
+        uint32_t num_received = 0, num_errors = 0;
+        int64_t last = -1;
+        event_t buf[8];
+
+        for(bool finished = false; !finished;)
+        {
+            // the last drain after the producer finished picks up the remainder
+            finished = done;
+            uint32_t num = queue.pop(buf, 8);
+
+            for(uint32_t i = 0; i < num; ++i)
+            {
+                if((int64_t)buf[i].seq <= last || !valid(buf[i], buf[i].seq)){ num_errors++; }
+                last = buf[i].seq;
+            }
+            num_received += num;
+
+            if(num){ finished = false; }
+            else{ std::this_thread::yield(); }
+        }
+        producer.join();
+
+        CHECK(!num_errors);
+        CHECK(num_received + queue.num_dropped() == g_num_events);
+        printf("dropping producer: %u received, %u dropped\n", num_received, queue.num_dropped());
+    }
+}
+
+int main()
+{
+    // single-threaded basics
+    SPSC_Queue<uint32_t, 4> q;
+    uint32_t v = 0;
+    CHECK(q.empty() && !q.pop(v));
+    for(uint32_t i = 0; i < 4; ++i){ CHECK(q.push(i)); }
+    CHECK(!q.push(4) && q.num_dropped() == 1 && q.size() == 4);
+    CHECK(q.pop(v) && v == 0);
+    CHECK(q.push(5) && q.size() == 4);
+
+    uint32_t buf[8];
+    CHECK(q.pop(buf, 8) == 4 && buf[0] == 1 && buf[2] == 3 && buf[3] == 5);
+    CHECK(q.empty());
+
+    stress_lossless<2>(false);
+    stress_lossless<16>(false);
+    stress_lossless<16>(true);
+    stress_lossless<256>(true);
+    stress_dropping();
+    return test_result("spsc_queue_test");
+}
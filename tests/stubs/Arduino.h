@@ -0,0 +1,97 @@
+//  Arduino.h
+//
+//  host-stub, just enough of the Arduino-API for the code under test.
+//  time only advances through stub_advance_micros()
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+inline uint32_t& stub_micros()
+{
+    static uint32_t s_micros = 0;
+    return s_micros;
+}
+
+inline void stub_advance_micros(uint32_t the_micros){ stub_micros() += the_micros; }
+
+inline unsigned long micros(){ return stub_micros(); }
+inline unsigned long millis(){ return stub_micros() / 1000; }
+inline void delay(unsigned long the_millis){ stub_advance_micros(the_millis * 1000); }
+inline void delayMicroseconds(unsigned int the_micros){ stub_advance_micros(the_micros); }
+
+inline void noInterrupts(){}
+inline void interrupts(){}
+inline void pinMode(int, int){}
+inline int digitalRead(int){ return LOW; }
+inline void digitalWrite(int, int){}
+inline int analogRead(int){ return 0; }
+
+class Print
+{
+public:
+    virtual ~Print(){}
+    virtual size_t write(uint8_t the_byte) = 0;
+
+    virtual size_t write(const uint8_t *the_data, size_t the_num_bytes)
+    {
+        for(size_t i = 0; i < the_num_bytes; ++i){ write(the_data[i]); }
+        return the_num_bytes;
+    }
+    size_t write(const char *the_str){ return write((const uint8_t*)the_str, strlen(the_str)); }
+    size_t print(const char *the_str){ return write(the_str); }
+    size_t println(const char *the_str = ""){ return write(the_str) + write("\n"); }
+
+    size_t print(long the_value)
+    {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%ld", the_value);
+        return write(buf);
+    }
+    size_t println(long the_value){ return print(the_value) + write("\n"); }
+    virtual void flush(){}
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+//! swallows output, unless echo is set
+class SerialStub : public Stream
+{
+public:
+    void begin(long){}
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t the_byte) override { if(echo){ putchar(the_byte); } return 1; }
+    using Print::write;
+    operator bool() const { return true; }
+    bool echo = false;
+};
+
+static SerialStub Serial;
@@ -0,0 +1,49 @@
+//  test_utils.h
+//
+//  minimal helpers for the host-side tests and benchmarks, one translation-unit per program
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+static int g_num_failures = 0;
+
+//! report a failed expectation, keep going
+#define CHECK(expr) \
+    do{ if(!(expr)){ fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+        g_num_failures++; } } while(0)
+
+//! exit-code for main()
+inline int test_result(const char *the_name)
+{
+    if(g_num_failures){ fprintf(stderr, "%s: %d failure(s)\n", the_name, g_num_failures); }
+    else{ printf("%s: ok\n", the_name); }
+    return g_num_failures ? 1 : 0;
+}
+
+//! xorshift32, deterministic across platforms
+inline uint32_t test_rand()
+{
+    static uint32_t s = 2463534242u;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+//! time the_fn(), called the_num_iterations times, in microseconds per call
+template <typename F> double time_us(F the_fn, uint32_t the_num_iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < the_num_iterations; ++i){ the_fn(); }
+    std::chrono::duration<double, std::micro> dur = std::chrono::steady_clock::now() - start;
+    return dur.count() / the_num_iterations;
+}
+
+//! keep the optimiser from discarding benchmarked results
+template <typename T> inline void do_not_optimize(const T &the_value)
+{
+    asm volatile("" : : "r"(&the_value) : "memory");
+}
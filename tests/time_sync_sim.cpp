@@ -0,0 +1,297 @@
+//  time_sync_sim.cpp
+//
+//  TimeSync: a simulated network of nodes with +-50ppm clocks, random micros()-offsets
+//  (some wrapping during the run), exponential packet-jitter and loss. the spread of
+//  global_micros() across all synced nodes is sampled every 100ms, the master is killed
+//  half-way through and the rest has to continue its timebase under a new one
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include "test_utils.h"
+#include "TimeSync.h"
+
+using namespace kinski;
+
+namespace
+{
+    struct scenario_t
+    {
+        const char *name;
+        uint32_t num_nodes;
+
+        //! mean of the exponential jitter on top of 200us base-latency
+        double jitter_mean;
+
+        //! probability of an additional 5-25ms delay, e.g. a busy access-point
+        double spike_prob;
+
+        //! the main-loop is blocked for 5ms by every 60Hz LED-frame
+        bool led_frames;
+
+        //! limits for the spread (us, median and p99) and the drift-estimates (ppm)
+        double max_median, max_p99, max_drift_error;
+    };
+
+    constexpr double g_loss = .01;
+    constexpr uint64_t g_duration = 240000000, g_kill_time = g_duration / 2;
+
+    //! true time in us, shared by all nodes
+    uint64_t g_time = 0;
+
+    double random_uniform(){ return (test_rand() >> 8) / 16777216.; }
+
+    struct packet_t
+    {
+        uint64_t arrival;
+        uint32_t ip;
+        uint16_t port;
+        std::vector<uint8_t> data;
+    };
+
+    struct node_t;
+    std::vector<node_t*> g_nodes;
+
+    //! the subset of Arduino's UDP-interface TimeSync::poll() uses
+    struct socket_t
+    {
+        node_t *owner = nullptr;
+        const scenario_t *scenario = nullptr;
+        std::deque<packet_t> inbox;
+        packet_t current;
+        size_t read_pos = 0;
+        uint32_t out_ip = 0;
+        std::vector<uint8_t> out;
+
+        int parsePacket()
+        {
+            auto it = std::min_element(inbox.begin(), inbox.end(),
+                                       [](const packet_t &a, const packet_t &b)
+                                       { return a.arrival < b.arrival; });
+            if(it == inbox.end() || it->arrival > g_time){ return 0; }
+
+            current = *it;
+            inbox.erase(it);
+            read_pos = 0;
+            return current.data.size();
+        }
+
+        int read(uint8_t *the_buf, size_t the_size)
+        {
+            size_t n = std::min(the_size, current.data.size() - read_pos);
+            memcpy(the_buf, current.data.data() + read_pos, n);
+            read_pos += n;
+            return n;
+        }
+
+        uint32_t remoteIP() const { return current.ip; }
+        uint16_t remotePort() const { return current.port; }
+
+        void beginPacket(uint32_t the_ip, uint16_t /*the_port*/){ out_ip = the_ip; out.clear(); }
+        void write(const uint8_t *the_data, size_t the_size)
+        {
+            out.insert(out.end(), the_data, the_data + the_size);
+        }
+        void endPacket();
+    };
+
+    struct node_t
+    {
+        uint32_t ip;
+        double ppm;
+        uint32_t clock_start;
+        TimeSync sync;
+        socket_t socket;
+        uint64_t next_poll = 0, last_frame = 0;
+        bool alive = true;
+
+        node_t(uint32_t the_ip): ip(the_ip), sync("node"){}
+
+        uint32_t micros() const
+        {
+            return clock_start + (uint64_t)llround(g_time * (1. + ppm * 1e-6));
+        }
+    };
+
+    double network_delay(const scenario_t &the_scenario)
+    {
+        double ret = 200. - the_scenario.jitter_mean * log(1. - random_uniform());
+        if(random_uniform() < the_scenario.spike_prob)
+        {
+            ret += 5000. + 20000. * random_uniform();
+        }
+        return ret;
+    }
+
+    void socket_t::endPacket()
+    {
+        // 10.0.0.255, in network byte-order like IPAddress
+        bool broadcast = out_ip == 0xFF00000A;
+
+        for(node_t *n : g_nodes)
+        {
+            if(!n->alive || n == owner || (!broadcast && n->ip != out_ip)){ continue; }
+            if(random_uniform() < g_loss){ continue; }
+            n->socket.inbox.push_back({g_time + (uint64_t)network_delay(*scenario), owner->ip,
+                                       TIMESYNC_PORT, out});
+        }
+    }
+
+    //! percentile of the_values, which get sorted
+    double percentile(std::vector<double> &the_values, uint32_t the_percent)
+    {
+        if(the_values.empty()){ return 0.; }
+        std::sort(the_values.begin(), the_values.end());
+        return the_values[std::min<size_t>(the_values.size() * the_percent / 100,
+                                           the_values.size() - 1)];
+    }
+
+    /*! runs the_scenario, returns the spreads in us, sampled before and after the master
+     *  was killed, while all live nodes were synced
+     */
+    void simulate(const scenario_t &the_scenario, std::vector<double> &the_before,
+                  std::vector<double> &the_after)
+    {
+        g_time = 0;
+        g_nodes.clear();
+
+        for(uint32_t i = 0; i < the_scenario.num_nodes; ++i)
+        {
+            // 10.0.0.(i + 2)
+            node_t *n = new node_t(10 | (i + 2) << 24);
+            n->ppm = 100. * random_uniform() - 50.;
+
+            // every other micros() wraps during the run
+            n->clock_start = i & 1 ? test_rand() : 0xFFFFFFFFu - test_rand() % 200000000u;
+            n->socket.owner = n;
+            n->socket.scenario = &the_scenario;
+            n->sync.set_addresses(n->ip, 0xFF00000A);
+
+            // staggered boot
+            n->next_poll = 3000000 * random_uniform();
+            g_nodes.push_back(n);
+        }
+
+        uint32_t num_killed = 0, last_master = 0;
+        uint64_t next_sample = 0, last_global = 0;
+
+        for(g_time = 0; g_time < g_duration; g_time += 100)
+        {
+            if(!num_killed && g_time >= g_kill_time)
+            {
+                for(node_t *n : g_nodes)
+                {
+                    if(n->alive && n->sync.is_master()){ n->alive = false; num_killed++; break; }
+                }
+                CHECK(num_killed == 1);
+            }
+
+            for(node_t *n : g_nodes)
+            {
+                if(!n->alive || g_time < n->next_poll){ continue; }
+                n->sync.poll(n->socket, n->micros());
+
+                // ~0.5ms per loop, plus a blocking LED-update per frame
+                n->next_poll = g_time + 500;
+
+                if(the_scenario.led_frames && g_time - n->last_frame >= 16667)
+                {
+                    n->last_frame = g_time;
+                    n->next_poll += 5000;
+                }
+            }
+
+            if(g_time < next_sample){ continue; }
+            next_sample += 100000;
+
+            int64_t lo = INT64_MAX, hi = INT64_MIN;
+            uint32_t num_synced = 0, master = 0;
+
+            for(node_t *n : g_nodes)
+            {
+                if(!n->alive || !n->sync.synced()){ continue; }
+                int64_t t = n->sync.global_micros(n->micros());
+                lo = std::min(lo, t);
+                hi = std::max(hi, t);
+                num_synced++;
+                if(n->sync.is_master()){ master = n->ip; }
+            }
+
+            // everybody synced within a minute, and stays so
+            bool all_synced = num_synced == the_scenario.num_nodes - num_killed;
+            if(g_time >= 60000000){ CHECK(all_synced); }
+            if(!all_synced || g_time < 60000000){ continue; }
+
+            // a single master, the live node with the lowest address. after a loss the
+            // election settles once the old one has timed out
+            if(g_time < g_kill_time || g_time > g_kill_time + 2 * TimeSync::s_peer_timeout)
+            {
+                CHECK(master == g_nodes[num_killed]->ip);
+            }
+
+            // the new master continues the timebase, time does not run backwards across it
+            uint64_t global = (lo + hi) / 2;
+            if(last_master && master != last_master){ CHECK(global + 20000 > last_global); }
+            last_master = master;
+            last_global = global;
+
+            (g_time < g_kill_time ? the_before : the_after).push_back(hi - lo);
+        }
+
+        uint32_t num_steps = 0, num_rejected = 0, num_responses = 0;
+        float max_drift_error = 0.f;
+
+        for(node_t *n : g_nodes)
+        {
+            num_steps += n->sync.num_steps();
+            num_rejected += n->sync.num_rejected();
+            num_responses += n->sync.num_responses();
+
+            // a new master keeps the rate of the timebase, that of the first master's crystal
+            const node_t *m = g_nodes[0];
+            if(!n->alive){ continue; }
+            float truth = (m->ppm - n->ppm) / (1. + n->ppm * 1e-6);
+            max_drift_error = std::max(max_drift_error, fabsf(n->sync.drift() * 1e6f - truth));
+        }
+
+        // one initial step per node, plus one for each node switching the master
+        CHECK(num_steps <= 2 * the_scenario.num_nodes + 2);
+        CHECK(max_drift_error < the_scenario.max_drift_error);
+
+        printf("%s: %u responses, %u rejected, %u steps, max. drift-error %.1f ppm\n",
+               the_scenario.name, num_responses, num_rejected, num_steps, max_drift_error);
+
+        for(node_t *n : g_nodes){ delete n; }
+        g_nodes.clear();
+    }
+}
+
+int main()
+{
+    // spreads well below a 60Hz frame in both cases
+    const scenario_t scenarios[] =
+    {
+        {"quiet LAN", 20, 100., 0., false, 1000., 2000., 10.},
+        {"busy WiFi", 20, 1000., .02, true, 5000., 8000., 25.}
+    };
+
+    for(const auto &scenario : scenarios)
+    {
+        std::vector<double> before, after;
+        simulate(scenario, before, after);
+        CHECK(!before.empty() && !after.empty());
+
+        for(auto *spreads : {&before, &after})
+        {
+            double median = percentile(*spreads, 50), p99 = percentile(*spreads, 99);
+            CHECK(median < scenario.max_median && p99 < scenario.max_p99);
+            printf("  %s master-loss: spread median %.0f us, p99 %.0f us, max. %.0f us\n",
+                   spreads == &before ? "before" : "after ", median, p99,
+                   spreads->empty() ? 0. : spreads->back());
+        }
+    }
+    return test_result("time_sync_sim");
+}
@@ -0,0 +1,264 @@
+//  universe_receiver_test.cpp
+//
+//  UniverseReceiver: replays Art-Net and sACN packet-captures (libpcap, see gen_dmx_captures.py)
+//  and checks every completed frame: all mapped universes have to hold the same frame,
+//  sync-packets, sequence-numbers, preview-data and foreign start-codes are honoured.
+//  tube_base_2017's universe-table mapped into paths, plus a per-packet benchmark
+
+#include <string.h>
+#include <vector>
+#include "test_utils.h"
+#include "UniverseReceiver.h"
+#include "universe_config.h"
+
+using namespace kinski;
+
+#ifndef DMX_CAPTURES
+#define DMX_CAPTURES "build"
+#endif
+
+namespace
+{
+    struct packet_t
+    {
+        uint32_t millis;
+        uint16_t port;
+        std::vector<uint8_t> payload;
+    };
+
+    inline uint16_t read_u16_be(const uint8_t *the_ptr){ return (the_ptr[0] << 8) | the_ptr[1]; }
+
+    //! UDP-payloads of a libpcap-file (Ethernet, IPv4), timestamps relative to the 1st packet
+    bool read_capture(const char *the_path, std::vector<packet_t> &the_packets)
+    {
+        FILE *f = fopen(the_path, "rb");
+        if(!f){ return false; }
+
+        uint32_t header[6];
+        bool ok = fread(header, sizeof(header), 1, f) == 1 && header[0] == 0xa1b2c3d4 &&
+                  header[5] == 1;
+        uint32_t record[4], first_ms = 0;
+        std::vector<uint8_t> buf;
+
+        while(ok && fread(record, sizeof(record), 1, f) == 1)
+        {
+            buf.resize(record[2]);
+            if(fread(buf.data(), buf.size(), 1, f) != 1){ ok = false; break; }
+            const uint8_t *ptr = buf.data();
+
+            // IPv4 / UDP only
+            if(buf.size() < 42 || read_u16_be(ptr + 12) != 0x0800 || ptr[23] != 17){ continue; }
+            const uint8_t *udp = ptr + 14 + (ptr[14] & 0x0F) * 4;
+            if(udp + 8 > ptr + buf.size()){ continue; }
+
+            uint32_t ms = record[0] * 1000 + record[1] / 1000;
+            if(the_packets.empty()){ first_ms = ms; }
+
+            packet_t p;
+            p.millis = ms - first_ms;
+            p.port = read_u16_be(udp + 2);
+            p.payload.assign(udp + 8, udp + read_u16_be(udp + 4));
+            the_packets.push_back(p);
+        }
+        fclose(f);
+        return ok && !the_packets.empty();
+    }
+
+    struct result_t
+    {
+        uint32_t num_packets = 0, num_frames = 0, num_torn = 0;
+    };
+
+    /*! feed the_packets for the_port, on every completed frame all of the_universes
+     *  in the_buf (512 bytes each) have to hold the same frame, as written by gen_dmx_captures.py
+     */
+    result_t replay(UniverseReceiver &the_receiver, const std::vector<packet_t> &the_packets,
+                    uint16_t the_port, const uint8_t *the_buf, uint32_t the_num_universes,
+                    uint16_t the_first_universe)
+    {
+        result_t ret;
+
+        for(const packet_t &p : the_packets)
+        {
+            if(p.port != the_port){ continue; }
+            ret.num_packets++;
+
+            if(!the_receiver.parse(p.payload.data(), p.payload.size(), p.millis)){ continue; }
+            ret.num_frames++;
+
+            bool consistent = true;
+
+            for(uint32_t u = 0; u < the_num_universes; ++u)
+            {
+                const uint8_t *slots = the_buf + 512 * u;
+                uint8_t frame = the_buf[0], universe = the_first_universe + u;
+                consistent &= slots[0] == frame && slots[1] == universe;
+
+                for(uint32_t i = 2; i < 512; ++i)
+                {
+                    consistent &= slots[i] == (uint8_t)(frame + universe + i);
+                }
+            }
+            ret.num_torn += !consistent;
+        }
+        return ret;
+    }
+
+    //! an ArtDmx-packet, carrying the_num_slots times the_value
+    std::vector<uint8_t> art_dmx(uint16_t the_universe, uint16_t the_num_slots, uint8_t the_value)
+    {
+        std::vector<uint8_t> ret = {'A', 'r', 't', '-', 'N', 'e', 't', 0, 0x00, 0x50, 0, 14, 0, 0,
+                                    (uint8_t)the_universe, (uint8_t)(the_universe >> 8),
+                                    (uint8_t)(the_num_slots >> 8), (uint8_t)the_num_slots};
+        ret.resize(ret.size() + the_num_slots, the_value);
+        return ret;
+    }
+
+    //! the part of LED_Path add_universes() uses, plus a guard-region behind its end
+    struct path_t
+    {
+        std::vector<uint8_t> buf;
+        uint32_t size;
+
+        path_t(uint32_t the_size): buf(the_size + 600), size(the_size){}
+        uint8_t* data(){ return buf.data(); }
+        uint32_t num_bytes() const { return size; }
+    };
+
+    void check_universe_config()
+    {
+        constexpr size_t num_configs = sizeof(g_universe_config) / sizeof(universe_config_t);
+
+        // tube_base_2017's table, into its single path of 1 segment (24 RGBW-pixels)
+        {
+            path_t path(24 * 4), *paths[] = {&path};
+            UniverseReceiver receiver;
+            CHECK(add_universes(receiver, g_universe_config, paths, 1) == num_configs);
+
+            for(size_t i = 0; i < num_configs; ++i)
+            {
+                const universe_config_t &cfg = g_universe_config[i];
+                auto pkt = art_dmx(cfg.universe, 512, i + 1);
+                receiver.parse(pkt.data(), pkt.size(), 0);
+                CHECK(path.buf[cfg.offset] == i + 1 && path.buf[path.size - 1] == i + 1);
+                CHECK(!path.buf[path.size]);
+            }
+        }
+
+        // clamped to the path's end and s_max_num_slots, invalid entries skipped
+        const universe_config_t config[] =
+        {
+            {1, 0, 0}, {2, 0, 512}, {3, 1, 0}, {4, 0, 700}, {1, 1, 100}, {5, 2, 0}
+        };
+        path_t path_0(700), path_1(200), *paths[] = {&path_0, &path_1};
+        UniverseReceiver receiver;
+        CHECK(add_universes(receiver, config, paths, 2) == 3);
+
+        for(uint16_t u = 1; u <= 5; ++u)
+        {
+            auto pkt = art_dmx(u, 512, u);
+            receiver.parse(pkt.data(), pkt.size(), 0);
+        }
+        CHECK(receiver.num_frames() == 1 && !receiver.num_errors());
+
+        for(uint32_t i = 0; i < path_0.buf.size(); ++i)
+        {
+            CHECK(path_0.buf[i] == (i < 512 ? 1 : i < 700 ? 2 : 0));
+        }
+        for(uint32_t i = 0; i < path_1.buf.size(); ++i)
+        {
+            CHECK(path_1.buf[i] == (i < 200 ? 3 : 0));
+        }
+    }
+}
+
+int main()
+{
+    static uint8_t buf[1024];
+
+    // Art-Net: universes 0, 1 mapped, 2 is not
+    {
+        std::vector<packet_t> packets;
+        CHECK(read_capture(DMX_CAPTURES "/artnet.pcap", packets));
+
+        UniverseReceiver receiver;
+        receiver.add_universe(0, buf, 512);
+        receiver.add_universe(1, buf + 512, 512);
+        result_t r = replay(receiver, packets, ARTNET_PORT, buf, 2, 0);
+
+        // 220 frames, frame 30 lacks universe 1: universe 0 of frame 31 completes it early,
+        // showing 31 and 29 side by side
+        CHECK(r.num_frames == 220);
+        CHECK(r.num_torn == 1);
+        CHECK(receiver.num_out_of_order() == 1);
+        CHECK(!receiver.num_errors());
+        CHECK(receiver.num_packets() == r.num_packets);
+
+        // ArtSync stopped 5s before the end
+        CHECK(!receiver.synchronous(packets.back().millis));
+        printf("art-net: %u packets, %u frames, %u torn, %u out of order\n", r.num_packets,
+               r.num_frames, r.num_torn, receiver.num_out_of_order());
+    }
+
+    // sACN: universes 1, 2, with preview-data, start-code 0xDD and stream-termination
+    {
+        std::vector<packet_t> packets;
+        CHECK(read_capture(DMX_CAPTURES "/sacn.pcap", packets));
+
+        UniverseReceiver receiver;
+        receiver.add_universe(1, buf, 512);
+        receiver.add_universe(2, buf + 512, 512);
+        result_t r = replay(receiver, packets, SACN_PORT, buf, 2, 1);
+
+        CHECK(!r.num_torn);
+        CHECK(receiver.num_out_of_order() == 2);
+        CHECK(!receiver.num_errors());
+
+        // frame 5 with sequence 0 and its repeated universe 2 (out of order), frame 60's repeated
+        // universe 1. frames 100-149 and 160-199 completed on sync-packets, unsynchronized
+        // frames 150-159 right away. universe-data was ignored after termination
+        CHECK(r.num_frames == 200);
+        CHECK(receiver.synchronous(packets.back().millis));
+        CHECK(buf[0] == (uint8_t)199);
+        printf("sacn: %u packets, %u frames, %u torn, %u out of order\n", r.num_packets,
+               r.num_frames, r.num_torn, receiver.num_out_of_order());
+
+        // benchmark, whole capture
+        uint64_t num_bytes = 0;
+        for(const packet_t &p : packets){ num_bytes += p.payload.size(); }
+
+        double us = time_us([&]
+        {
+            UniverseReceiver rcv;
+            rcv.add_universe(1, buf, 512);
+            rcv.add_universe(2, buf + 512, 512);
+            for(const packet_t &p : packets)
+            {
+                rcv.parse(p.payload.data(), p.payload.size(), p.millis);
+            }
+            do_not_optimize(buf[0]);
+        }, 200);
+
+        printf("parse: %.3f us per packet, %.0f MB/s\n", us / packets.size(), num_bytes / us);
+    }
+
+    // truncated and foreign packets are counted as errors, not applied
+    {
+        UniverseReceiver receiver;
+        receiver.add_universe(0, buf, 512);
+        memset(buf, 0, sizeof(buf));
+
+        const uint8_t junk[5] = {1, 2, 3, 4, 5};
+        CHECK(!receiver.parse(junk, sizeof(junk), 0));
+
+        // ArtDmx announcing 512 slots, carrying 100
+        uint8_t short_dmx[18 + 100] = {'A', 'r', 't', '-', 'N', 'e', 't', 0, 0x00, 0x50, 0, 14,
+                                       1, 0, 0, 0, 0x02, 0x00};
+        memset(short_dmx + 18, 0xFF, 100);
+        CHECK(!receiver.parse(short_dmx, sizeof(short_dmx), 0));
+        CHECK(receiver.num_errors() == 2 && !buf[0]);
+    }
+
+    check_universe_config();
+    return test_result("universe_receiver_test");
+}
@@ -0,0 +1,146 @@
+//  wave_equation_test.cpp
+//
+//  WaveEquation: energy-conservation of the undamped Q12 leapfrog-scheme, propagation,
+//  reflection at the ghost-cells, the damping-table and a per-frame benchmark
+
+#include "test_utils.h"
+#include "WaveEquation.h"
+
+namespace
+{
+    constexpr float g_track_length = 10.f;
+    constexpr float g_speed = 3.33f;
+
+    //! position of the strongest displacement, sampled per cell
+    float peak_position(WaveEquation &the_sim, float *the_peak = nullptr)
+    {
+        float best = 0.f, best_pos = 0.f, cell = g_track_length / the_sim.num_cells();
+
+        for(uint32_t i = 0; i < the_sim.num_cells(); ++i)
+        {
+            float pos = (i + .5f) * cell, val = the_sim.intensity_at_position(pos);
+            if(val > best){ best = val; best_pos = pos; }
+        }
+        if(the_peak){ *the_peak = best; }
+        return best_pos;
+    }
+
+    void setup(WaveEquation &the_sim, float the_decay_secs)
+    {
+        the_sim.set_track_length(g_track_length);
+        the_sim.set_propagation_speed(g_speed);
+        the_sim.set_decay_secs(the_decay_secs);
+    }
+}
+
+int main()
+{
+    // undamped: energy is conserved through propagation, reflections and interference
+    {
+        WaveEquation sim(1024);
+        setup(sim, 1e9f);
+        sim.emit_wave(1.f, 3.f);
+        sim.emit_wave(.6f, 7.f);
+
+        float e0 = sim.energy(), max_dev = 0.f;
+        CHECK(e0 > 0.f);
+
+        // 20s, each pulse reflects several times and crosses the other
+        for(uint32_t f = 0; f < 1250; ++f)
+        {
+            sim.update(16);
+            float dev = fabsf(sim.energy() - e0) / e0;
+            max_dev = dev > max_dev ? dev : max_dev;
+        }
+        CHECK(max_dev < 1e-3f);
+        printf("undamped energy: %.4f, max. relative deviation %.2e\n", e0, max_dev);
+    }
+
+    // a pulse travels forward with the propagation speed and is reflected at the track-end
+    {
+        WaveEquation sim(1024);
+        setup(sim, 1e9f);
+        sim.emit_wave(1.f, 2.f);
+
+        float peak0;
+        CHECK(fabsf(peak_position(sim, &peak0) - 2.f) < .05f);
+
+        // 1s -> 3.33m forward
+        for(uint32_t f = 0; f < 125; ++f){ sim.update(8); }
+        float peak;
+        CHECK(fabsf(peak_position(sim, &peak) - (2.f + g_speed)) < .1f);
+        CHECK(fabsf(peak - peak0) < .05f);
+
+        // another 2s -> 2 + 9.99 = 11.99, reflected at 10m -> 8.01
+        for(uint32_t f = 0; f < 250; ++f){ sim.update(8); }
+        CHECK(fabsf(peak_position(sim, &peak) - (2 * g_track_length - 2.f - 3 * g_speed)) < .1f);
+        CHECK(fabsf(peak - peak0) < .05f);
+    }
+
+    // superposition: two pulses emitted at the same spot add up
+    {
+        WaveEquation a(512), b(512);
+        setup(a, 1e9f);
+        setup(b, 1e9f);
+        a.emit_wave(.5f, 4.f);
+        b.emit_wave(.5f, 4.f);
+        b.emit_wave(.5f, 4.f);
+        for(uint32_t f = 0; f < 30; ++f){ a.update(16); b.update(16); }
+        CHECK(fabsf(2.f * a.intensity_at_position(5.f) - b.intensity_at_position(5.f)) < 2e-3f);
+    }
+
+    // damping: the amplitude has dropped to ~1/255 after decay_secs
+    {
+        constexpr float decay_secs = 2.f;
+        WaveEquation sim(1024);
+        setup(sim, decay_secs);
+        sim.emit_wave(1.f, 5.f);
+
+        float peak0, peak, e0 = sim.energy();
+        peak_position(sim, &peak0);
+
+        // half-way: sqrt(1/255)
+        for(uint32_t f = 0; f < 63; ++f){ sim.update(16); }
+        peak_position(sim, &peak);
+        CHECK(fabsf(peak / peak0 - sqrtf(1.f / 255)) < .015f);
+
+        for(uint32_t f = 0; f < 62; ++f){ sim.update(16); }
+        peak_position(sim, &peak);
+        CHECK(peak / peak0 < 2.f / 255 && peak > 0.f);
+        CHECK(sim.energy() < e0 * 1e-4f);
+        printf("damping: %.4f after %.1fs (expected %.4f)\n", peak / peak0, decay_secs, 1 / 255.f);
+
+        // rounding to nearest lets the state settle at exactly zero
+        for(uint32_t f = 0; f < 600; ++f){ sim.update(16); }
+        CHECK(sim.energy() == 0.f);
+    }
+
+    // long hitches are capped, instead of stalling the next frame
+    {
+        WaveEquation sim(1024);
+        setup(sim, 2.f);
+        sim.emit_wave(1.f, 5.f);
+        double us = time_us([&]{ sim.update(5000); }, 1);
+        CHECK(us < 50000.0);
+    }
+
+    // benchmark, 60Hz frames
+    const uint32_t cell_counts[] = {1024, 2048};
+
+    for(uint32_t num_cells : cell_counts)
+    {
+        WaveEquation sim(num_cells);
+        setup(sim, 2.f);
+
+        double us = time_us([&]
+        {
+            sim.emit_wave(1.f, (test_rand() % 1000) / 100.f);
+            sim.update(16);
+        }, 20000);
+
+        float steps = .016f * g_speed * num_cells / g_track_length;
+        printf("%u cells: %.2f us per 16ms frame (%.1f steps), %.2f ns per cell-step\n", num_cells,
+               us, steps, 1000 * us / (steps * num_cells));
+    }
+    return test_result("wave_equation_test");
+}
@@ -0,0 +1,152 @@
+//  wave_simulation_bench.cpp
+//
+//  WaveSimulation::intensities_at_positions() against a per-position loop over all waves
+//  (the previous intensity_at_position()), for 16, 256 and 4096 evenly spread positions and
+//  for salzhaus_raupe's tunnel, 13 gates of 126 pixels, 0.88m apart, evaluated gate by gate.
+//  both evaluate the same divide, the batch skips waves out of reach of a block of positions,
+//  which carries over to the M0, where each skipped soft-float divide saves far more
+
+// before Arduino.h, its min/max macros break <chrono>
+#include "test_utils.h"
+#include "WaveSimulation.h"
+
+namespace
+{
+    constexpr uint32_t g_num_waves = 8;
+    constexpr float g_track_length = 10.f;
+
+    float g_wave_pos[g_num_waves], g_wave_intensity[g_num_waves];
+
+    // salzhaus_raupe's gates: 42 pixels up, 42 at the top, 42 down, the top lags by 0.5m
+    constexpr uint32_t g_num_gates = 13, g_gate_leds = 126;
+    constexpr float g_gate_start = .3f, g_gate_step = .88f, g_arch_lag = .5f;
+
+    // per position, all waves, one divide per wave
+    void reference(const float *the_positions, float *the_intensities, uint32_t the_num_positions)
+    {
+        for(uint32_t j = 0; j < the_num_positions; ++j)
+        {
+            float sum = 0.f;
+
+            for(uint32_t i = 0; i < g_num_waves; ++i)
+            {
+                float d = g_wave_pos[i] - the_positions[j];
+                sum += g_wave_intensity[i] / (1.f + 18.f * d * d);
+            }
+            the_intensities[j] = sum;
+        }
+    }
+}
+
+int main()
+{
+    WaveSimulation sim(g_num_waves);
+    sim.set_track_length(g_track_length);
+
+    // waves are evaluated at their start-state, no update() in between
+    for(uint32_t i = 0; i < g_num_waves; ++i)
+    {
+        g_wave_pos[i] = g_track_length * (test_rand() % 1000) / 1000.f;
+        g_wave_intensity[i] = .2f + .8f * (test_rand() % 1000) / 1000.f;
+        CHECK(sim.emit_wave(g_wave_intensity[i], g_wave_pos[i]));
+    }
+
+    const uint32_t sizes[] = {16, 256, 4096};
+
+    for(uint32_t num_positions : sizes)
+    {
+        float *positions = new float[num_positions];
+        float *result = new float[num_positions], *expected = new float[num_positions];
+
+        for(uint32_t i = 0; i < num_positions; ++i)
+        {
+            positions[i] = g_track_length * (i + .5f) / num_positions;
+        }
+
+        sim.intensities_at_positions(positions, result, num_positions);
+        reference(positions, expected, num_positions);
+
+        // the same divide, only the cut-off differs, below one 8bit step per wave
+        float max_error = 0.f;
+
+        for(uint32_t i = 0; i < num_positions; ++i)
+        {
+            float err = fabsf(result[i] - expected[i]);
+            max_error = err > max_error ? err : max_error;
+            CHECK(err <= g_num_waves / 255.f);
+        }
+        CHECK(fabsf(sim.intensity_at_position(positions[0]) - result[0]) <= g_num_waves / 255.f);
+
+        uint32_t num_iterations = 4000000 / num_positions;
+
+        double batch_us = time_us([&]
+        {
+            sim.intensities_at_positions(positions, result, num_positions);
+            do_not_optimize(result[0]);
+        }, num_iterations);
+
+        double ref_us = time_us([&]
+        {
+            reference(positions, expected, num_positions);
+            do_not_optimize(expected[0]);
+        }, num_iterations);
+
+        printf("%4u positions, %u waves: batch %.2f ns/pos, per-position divide %.2f ns/pos, "
+               "max. error %.4f\n", num_positions, g_num_waves, 1000 * batch_us / num_positions,
+               1000 * ref_us / num_positions, max_error);
+
+        delete[] positions;
+        delete[] result;
+        delete[] expected;
+    }
+
+    // the tunnel, a frame is one update() and one call per gate
+    float *positions = new float[g_num_gates * g_gate_leds];
+    float *result = new float[g_num_gates * g_gate_leds];
+    float *expected = new float[g_num_gates * g_gate_leds];
+
+    for(uint32_t i = 0; i < g_num_gates; ++i)
+    {
+        for(uint32_t j = 0; j < g_gate_leds; ++j)
+        {
+            float h = j < 42 ? (j + .5f) / 42 : j < 84 ? 1.f : (125.5f - j) / 42;
+            positions[i * g_gate_leds + j] = g_gate_start + i * g_gate_step + g_arch_lag * h;
+        }
+    }
+
+    auto batch_frame = [&]
+    {
+        sim.update(0);
+
+        for(uint32_t i = 0; i < g_num_gates; ++i)
+        {
+            sim.intensities_at_positions(positions + i * g_gate_leds, result + i * g_gate_leds,
+                                         g_gate_leds);
+        }
+        do_not_optimize(result[0]);
+    };
+    auto ref_frame = [&]
+    {
+        for(uint32_t i = 0; i < g_num_gates; ++i)
+        {
+            reference(positions + i * g_gate_leds, expected + i * g_gate_leds, g_gate_leds);
+        }
+        do_not_optimize(expected[0]);
+    };
+    batch_frame();
+    ref_frame();
+
+    for(uint32_t i = 0; i < g_num_gates * g_gate_leds; ++i)
+    {
+        CHECK(fabsf(result[i] - expected[i]) <= g_num_waves / 255.f);
+    }
+
+    double batch_us = time_us(batch_frame, 20000), ref_us = time_us(ref_frame, 20000);
+    printf("tunnel, %u gates: batch %.2f us/frame, per-position divide %.2f us/frame\n",
+           g_num_gates, batch_us, ref_us);
+
+    delete[] positions;
+    delete[] result;
+    delete[] expected;
+    return test_result("wave_simulation_bench");
+}
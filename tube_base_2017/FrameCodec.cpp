@@ -0,0 +1,81 @@
+#include "FrameCodec.h"
+
+bool decode_frame(const uint8_t *the_src, size_t the_src_len, uint8_t *the_dst,
+                  size_t the_dst_len, uint8_t the_bytes_per_pixel)
+{
+    const uint8_t *src = the_src, *src_end = the_src + the_src_len;
+    uint8_t *dst = the_dst, *dst_end = the_dst + the_dst_len;
+
+    while(src < src_end)
+    {
+        uint8_t op = *src >> 6;
+        size_t num_bytes = ((*src & 0x3F) + 1) * the_bytes_per_pixel;
+        src++;
+
+        if(num_bytes > (size_t)(dst_end - dst)){ return false; }
+
+        switch(op)
+        {
+            case OP_SKIP:
+                break;
+
+            case OP_LITERAL:
+                if(num_bytes > (size_t)(src_end - src)){ return false; }
+                memcpy(dst, src, num_bytes);
+                src += num_bytes;
+                break;
+
+            case OP_RUN:
+            case OP_XOR_RUN:
+            {
+                if(the_bytes_per_pixel > src_end - src){ return false; }
+
+                for(size_t i = 0; i < num_bytes; i += the_bytes_per_pixel)
+                {
+                    if(op == OP_RUN){ memcpy(dst + i, src, the_bytes_per_pixel); }
+                    else
+                    {
+                        for(uint8_t j = 0; j < the_bytes_per_pixel; ++j){ dst[i + j] ^= src[j]; }
+                    }
+                }
+                src += the_bytes_per_pixel;
+                break;
+            }
+        }
+        dst += num_bytes;
+    }
+    return true;
+}
+
+bool write_frame(const FrameParser &the_parser, frame_stream_t &the_stream, uint8_t *the_dst,
+                 size_t the_dst_len, uint8_t the_bytes_per_pixel)
+{
+    const frame_header_t &header = the_parser.header();
+
+    // lost or corrupt frames invalidate the state delta-frames refer to
+    uint32_t num_errors = the_parser.num_lost() + the_parser.num_errors();
+    if(num_errors != the_stream.num_errors){ the_stream.valid = false; }
+    the_stream.num_errors = num_errors;
+
+    // raw frames are self-contained as well
+    if(header.flags & FRAME_KEY || !(header.flags & FRAME_ENCODED)){ the_stream.valid = true; }
+
+    if(!the_stream.valid || !the_dst || header.offset >= the_dst_len){ return false; }
+    size_t num_bytes = the_dst_len - header.offset;
+
+    if(header.flags & FRAME_ENCODED)
+    {
+        // straight into the LED-buffer
+        if(!decode_frame(the_parser.payload(), header.length, the_dst + header.offset, num_bytes,
+                         the_bytes_per_pixel))
+        {
+            the_stream.valid = false;
+        }
+    }
+    else
+    {
+        memcpy(the_dst + header.offset, the_parser.payload(),
+               header.length < num_bytes ? header.length : num_bytes);
+    }
+    return true;
+}
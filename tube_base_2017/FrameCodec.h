@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Arduino.h"
+#include "FrameParser.h"
+
+/*! compact op-stream for LED frames, carried in frames with FRAME_ENCODED set.
+ *
+ *  every op starts with a byte: 2 bit opcode (high bits) | 6 bit pixel count - 1
+ *
+ *  OP_SKIP      keep count pixels unchanged, no data
+ *  OP_LITERAL   count pixels follow
+ *  OP_RUN       one pixel follows, repeated count times
+ *  OP_XOR_RUN   one pixel follows, XOR'ed into count pixels
+ *
+ *  keyframes only use OP_LITERAL and OP_RUN, delta-frames refer to the current content.
+ *  the host-side encoder lives in tube_codec.py
+ */
+
+enum FrameOp
+{
+    OP_SKIP = 0,
+    OP_LITERAL = 1,
+    OP_RUN = 2,
+    OP_XOR_RUN = 3
+};
+
+//! maximum pixel count per op
+#define FRAME_OP_MAX_COUNT 64
+
+/*! decode an op-stream directly into the_dst.
+ *  returns false for truncated or overflowing op-streams, the_dst might be partially written then
+ */
+bool decode_frame(const uint8_t *the_src, size_t the_src_len, uint8_t *the_dst,
+                  size_t the_dst_len, uint8_t the_bytes_per_pixel);
+
+//! whether a source's delta-frames can be applied, one per source of frames
+struct frame_stream_t
+{
+    //! delta-frames are only applied on top of a known state, i.e. after a keyframe without losses
+    bool valid = false;
+
+    //! lost and corrupt frames of the source, as of its last frame
+    uint32_t num_errors = 0;
+};
+
+/*! write the last valid frame of the_parser into the_dst, e.g. a path's LED-buffer.
+ *  lost or corrupt frames invalidate the_stream, keyframes and raw frames make it valid again.
+ *  returns true, if the_dst was written to, for a failing op-stream only partially
+ */
+bool write_frame(const FrameParser &the_parser, frame_stream_t &the_stream, uint8_t *the_dst,
+                 size_t the_dst_len, uint8_t the_bytes_per_pixel);
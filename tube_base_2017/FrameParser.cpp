@@ -0,0 +1,115 @@
+#include "FrameParser.h"
+
+namespace
+{
+    // CRC16-CCITT remainders for a single nibble
+    const uint16_t g_crc_nibble_table[16] =
+    {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+
+    inline uint16_t crc16_update(uint16_t the_crc, uint8_t the_byte)
+    {
+        the_crc = (the_crc << 4) ^ g_crc_nibble_table[(the_crc >> 12) ^ (the_byte >> 4)];
+        the_crc = (the_crc << 4) ^ g_crc_nibble_table[(the_crc >> 12) ^ (the_byte & 0x0F)];
+        return the_crc;
+    }
+
+    inline uint16_t read_u16(const uint8_t *the_ptr){ return the_ptr[0] | (the_ptr[1] << 8); }
+}
+
+uint16_t crc16_ccitt(const uint8_t *the_data, size_t the_num_bytes, uint16_t the_crc)
+{
+    for(size_t i = 0; i < the_num_bytes; ++i){ the_crc = crc16_update(the_crc, the_data[i]); }
+    return the_crc;
+}
+
+void FrameParser::reset()
+{
+    m_state = STATE_SYNC_0;
+    m_pos = 0;
+    m_crc = 0xFFFF;
+    m_last_frame_number = 0;
+    m_num_frames = m_num_errors = m_num_lost = 0;
+}
+
+bool FrameParser::decode_header()
+{
+    m_header.frame_number = read_u16(m_header_buf);
+    m_header.path = m_header_buf[2];
+    m_header.flags = m_header_buf[3];
+    m_header.offset = read_u16(m_header_buf + 4);
+    m_header.length = read_u16(m_header_buf + 6);
+    return m_header.length <= FRAME_MAX_PAYLOAD;
+}
+
+bool FrameParser::feed(uint8_t the_byte)
+{
+    switch(m_state)
+    {
+        case STATE_SYNC_0:
+            if(the_byte == FRAME_SYNC_0){ m_state = STATE_SYNC_1; }
+            break;
+
+        case STATE_SYNC_1:
+            if(the_byte == FRAME_SYNC_1)
+            {
+                m_state = STATE_HEADER;
+                m_pos = 0;
+                m_crc = 0xFFFF;
+            }
+            else if(the_byte != FRAME_SYNC_0){ m_state = STATE_SYNC_0; }
+            break;
+
+        case STATE_HEADER:
+            m_header_buf[m_pos++] = the_byte;
+            m_crc = crc16_update(m_crc, the_byte);
+
+            if(m_pos == s_header_size)
+            {
+                m_pos = 0;
+
+                if(!decode_header())
+                {
+                    m_num_errors++;
+                    m_state = STATE_SYNC_0;
+                }
+                else{ m_state = m_header.length ? STATE_PAYLOAD : STATE_CRC; }
+            }
+            break;
+
+        case STATE_PAYLOAD:
+            m_payload[m_pos++] = the_byte;
+            m_crc = crc16_update(m_crc, the_byte);
+
+            if(m_pos == m_header.length)
+            {
+                m_pos = 0;
+                m_state = STATE_CRC;
+            }
+            break;
+
+        case STATE_CRC:
+            m_crc_buf[m_pos++] = the_byte;
+
+            if(m_pos == sizeof(m_crc_buf))
+            {
+                m_state = STATE_SYNC_0;
+
+                if(read_u16(m_crc_buf) == m_crc)
+                {
+                    // forward gaps in frame numbers, ignore restarts of the sender
+                    uint16_t gap = m_header.frame_number - m_last_frame_number - 1;
+                    if(m_num_frames && gap < 0x8000){ m_num_lost += gap; }
+
+                    m_last_frame_number = m_header.frame_number;
+                    m_num_frames++;
+                    return true;
+                }
+                m_num_errors++;
+            }
+            break;
+    }
+    return false;
+}
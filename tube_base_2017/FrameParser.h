@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Arduino.h"
+
+/*! binary frame protocol for streaming LED data
+ *
+ *  | sync (2) | frame (2) | path (1) | flags (1) | offset (2) | length (2) | payload | crc (2) |
+ *
+ *  multi-byte fields are little-endian. the CRC16-CCITT (0x1021, init 0xFFFF)
+ *  covers everything between sync and crc. both sync bytes are outside of ASCII,
+ *  so frames can share a stream with text commands.
+ *  updates bigger than FRAME_MAX_PAYLOAD are split into several frames using offsets,
+ *  the last one carrying FRAME_SHOW.
+ */
+
+#define FRAME_SYNC_0 0xA5
+#define FRAME_SYNC_1 0xC3
+
+//! size of the staging buffer, maximum payload per frame
+#define FRAME_MAX_PAYLOAD 512
+
+enum FrameFlags
+{
+    //! display all paths after this frame was applied
+    FRAME_SHOW = 1 << 0,
+
+    //! payload is an op-stream (see FrameCodec.h) instead of raw LED data
+    FRAME_ENCODED = 1 << 1,
+
+    //! encoded payload does not depend on previous content (no SKIP / XOR_RUN)
+    FRAME_KEY = 1 << 2
+};
+
+struct frame_header_t
+{
+    uint16_t frame_number;
+    uint8_t path;
+    uint8_t flags;
+    uint16_t offset;
+    uint16_t length;
+};
+
+//! CRC16-CCITT, pass a previous result as the_crc to continue a checksum
+uint16_t crc16_ccitt(const uint8_t *the_data, size_t the_num_bytes, uint16_t the_crc = 0xFFFF);
+
+/*! incremental, non-blocking parser for the frame protocol.
+ *  bytes are fed one at a time, whenever they arrive. payloads are collected
+ *  in a staging buffer and only handed out after the CRC matched.
+ */
+class FrameParser
+{
+public:
+
+    //! feed a single byte. returns true, if it completed a valid frame
+    bool feed(uint8_t the_byte);
+
+    //! drop a partial frame and start over with zeroed counters, e.g. for a new client
+    void reset();
+
+    //! true while in the middle of a frame, subsequent bytes belong to the parser
+    bool busy() const { return m_state != STATE_SYNC_0; }
+
+    //! header and payload of the last valid frame, only meaningful after feed() returned true
+    const frame_header_t& header() const { return m_header; }
+    const uint8_t* payload() const { return m_payload; }
+
+    //! number of valid frames
+    uint32_t num_frames() const { return m_num_frames; }
+
+    //! number of frames rejected for CRC-mismatch or oversized payload
+    uint32_t num_errors() const { return m_num_errors; }
+
+    //! number of frames missing, judging by gaps in frame numbers
+    uint32_t num_lost() const { return m_num_lost; }
+
+private:
+
+    enum State{ STATE_SYNC_0, STATE_SYNC_1, STATE_HEADER, STATE_PAYLOAD, STATE_CRC };
+
+    //! size of the encoded header
+    static constexpr uint8_t s_header_size = 8;
+
+    //! header-bytes to frame_header_t, false if the payload would not fit
+    bool decode_header();
+
+    State m_state = STATE_SYNC_0;
+    uint16_t m_pos = 0;
+    uint16_t m_crc = 0xFFFF;
+
+    uint8_t m_header_buf[s_header_size];
+    uint8_t m_crc_buf[2];
+
+    frame_header_t m_header = {};
+    uint8_t m_payload[FRAME_MAX_PAYLOAD];
+
+    uint16_t m_last_frame_number = 0;
+    uint32_t m_num_frames = 0;
+    uint32_t m_num_errors = 0;
+    uint32_t m_num_lost = 0;
+};
@@ -162,6 +162,17 @@ void SinusFill::reset(LED_Path* the_path)
 
 }
 
+void SinusFill::set_time(uint32_t the_time)
+{
+    // offsets follow the clock instead of accumulated deltas,
+    // wrapped at full periods to keep the float precise
+    for(uint32_t i = 0; i < 2; ++i)
+    {
+        uint32_t period = fabs(PI_2 * TUBE_LENGTH * 1000.f / (m_sinus_factors[i] * m_sinus_speeds[i]));
+        if(period){ m_sinus_offsets[i] = m_sinus_speeds[i] * (the_time % period) / 1000.f; }
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 CompositeMode::CompositeMode():ModeHelper()
@@ -210,6 +221,14 @@ void CompositeMode::reset(LED_Path* the_path)
     }
 }
 
+void CompositeMode::set_time(uint32_t the_time)
+{
+    for(int i = 0; i < s_max_num_modes; ++i)
+    {
+         if(m_mode_helpers[i]){ m_mode_helpers[i]->set_time(the_time); }
+    }
+}
+
 void CompositeMode::add_mode(ModeHelper *m)
 {
     for(int i = 0; i < s_max_num_modes; ++i)
@@ -15,6 +15,9 @@ public:
     virtual void reset(LED_Path* the_path) = 0;
     virtual void set_trigger_time(uint32_t the_min, uint32_t the_max);
 
+    //! align to a clock in ms shared between nodes, for phase-locked animations
+    virtual void set_time(uint32_t the_time){}
+
 protected:
 
     // LED_Path* m_path;
@@ -65,6 +68,7 @@ public:
     SinusFill();
     void process(LED_Path* the_path, uint32_t the_delta_time) override;
     void reset(LED_Path* the_path) override;
+    void set_time(uint32_t the_time) override;
 
     void set_sinus_offsets(float a, float b){ m_sinus_offsets[0] = a; m_sinus_offsets[1] = b;}
 
@@ -97,6 +101,7 @@ public:
     CompositeMode();
     void process(LED_Path* the_path, uint32_t the_delta_time) override;
     void reset(LED_Path* the_path) override;
+    void set_time(uint32_t the_time) override;
 
     void add_mode(ModeHelper *m);
     void remove_mode(ModeHelper *m);
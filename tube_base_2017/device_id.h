@@ -4,4 +4,4 @@
 #define CMD_QUERY_ID "ID"
 #define CMD_SEGMENT "SEGMENT"
 #define CMD_BRIGHTNESS "BRIGHTNESS"
-#define CMD_RECV_DATA "DATA"
+#define CMD_NETWORK "NETWORK"
@@ -1,4 +1,7 @@
 #include "ModeHelpers.h"
+#include "FrameParser.h"
+#include "FrameCodec.h"
+#include "CommandParser.h"
 #include "Timer.hpp"
 #include "device_id.h"
 
@@ -8,6 +11,9 @@
 
 #ifdef USE_NETWORK
 #include "NetworkHelper.h"
+#include "UniverseReceiver.h"
+#include "universe_config.h"
+#include "TimeSync.h"
 
 // Ethernet MAC adress
 uint8_t g_mac_adress[6] = {0x00, 0xAA, 0xBB, 0xCC, 0xDE, 0x69};
@@ -34,15 +40,19 @@ void send_udp_broadcast()
      NetworkHelper::get()->send_udp_broadcast(DEVICE_ID, g_udp_broadcast_port);
 };
 
+kinski::UniverseReceiver g_universes;
+UDP *g_artnet_socket = nullptr, *g_sacn_socket = nullptr;
+
+// discovery and a timebase shared with all other nodes, drives our modes
+kinski::TimeSync g_time_sync(DEVICE_ID);
+UDP *g_sync_socket = nullptr;
+
 #endif
 
 // update rate in Hz
 #define UPDATE_RATE 60
 #define SERIAL_BUFSIZE 128
 
-char g_serial_buf[SERIAL_BUFSIZE];
-uint32_t g_buf_index = 0;
-
 // helper variables for time measurement
 long g_last_time_stamp = 0;
 uint32_t g_time_accum = 0;
@@ -79,11 +89,60 @@ constexpr uint8_t g_path_lengths[] = {1};
 const uint8_t g_led_pins[] = {5};
 
 LED_Path* g_path[g_num_paths];
+
+//! input-state per source: LED-frames, text-commands and the client-session they belong to
+struct input_t
+{
+    FrameParser frames;
+    kinski::LineBuffer<SERIAL_BUFSIZE> lines;
+    frame_stream_t stream;
+    uint32_t session = 0;
+
+    //! start over, e.g. for a new client
+    void reset()
+    {
+        frames.reset();
+        lines.clear();
+        stream = {};
+    }
+};
+
+// serial and one per connection-slot, a client never continues another one's frame or line
+input_t g_serial_input;
+#ifdef USE_NETWORK
+input_t g_net_inputs[NetworkHelper::s_max_num_connections];
+#endif
+
 ModeHelper *g_mode_sinus = nullptr, *g_mode_colour = nullptr, *g_mode_current = nullptr;
 CompositeMode *g_mode_composite = nullptr;
 
+//! the LED-state delta-frames refer to is gone, for all sources except the_source
+void invalidate_streams(const input_t *the_source = nullptr)
+{
+    if(&g_serial_input != the_source){ g_serial_input.stream.valid = false; }
+#ifdef USE_NETWORK
+    for(input_t &input : g_net_inputs)
+    {
+        if(&input != the_source){ input.stream.valid = false; }
+    }
+#endif
+}
+
 //! timer callback to reset the runmode after streaming
-void set_running(){ g_run_mode = MODE_RUNNING; }
+void set_running()
+{
+    g_run_mode = MODE_RUNNING;
+    invalidate_streams();
+}
+
+//! pause our modes while external data arrives
+void set_streaming()
+{
+    g_run_mode = MODE_STREAMING;
+
+    // start a timer to return <g_run_mode> to normal
+    g_timer[TIMER_RUNMODE].expires_from_now(2.f);
+}
 
 void setup()
 {
@@ -117,6 +176,13 @@ void setup()
         g_timer[TIMER_UDP_BROADCAST].expires_from_now(g_udp_broadcast_interval);
         g_timer[TIMER_UDP_BROADCAST].set_periodic();
         g_timer[TIMER_UDP_BROADCAST].set_callback(&::send_udp_broadcast);
+
+        g_sync_socket = g_net_helper->create_udp_socket(TIMESYNC_PORT);
+
+        g_artnet_socket = g_net_helper->create_udp_socket(ARTNET_PORT);
+        g_sacn_socket = g_net_helper->create_udp_socket(SACN_PORT);
+
+        add_universes(g_universes, g_universe_config, g_path, g_num_paths);
     }
 #endif
 
@@ -133,23 +199,60 @@ void loop()
     // poll Timer objects
     for(uint32_t i = 0; i < g_num_timers; ++i){ g_timer[i].poll(); }
 
+    // inputs are read on every iteration, to keep up with streamed frames
+    process_input(Serial, g_serial_input);
+
+#ifdef USE_NETWORK
+    // drain transmit-buffers, accept new clients
+    g_net_helper->update_connections();
+
+    uint32_t num_connections = 0;
+    auto net_clients = g_net_helper->connected_clients(&num_connections);
+
+    for(uint8_t i = 0; i < num_connections; ++i)
+    {
+        input_t &input = g_net_inputs[net_clients[i]->slot()];
+
+        // the slot was closed and taken over by a new client since
+        if(input.session != net_clients[i]->session())
+        {
+            input.reset();
+            input.session = net_clients[i]->session();
+        }
+        process_input(*net_clients[i], input);
+    }
+
+    // addresses change with WiFi drop-outs
+    if(g_sync_socket)
+    {
+        g_time_sync.set_addresses(g_net_helper->local_ip(), g_net_helper->broadcast_ip());
+        g_time_sync.poll(*g_sync_socket, micros());
+    }
+
+    // DMX-universes are written straight into our paths, show once a frame is complete
+    bool dmx_frame = false;
+    if(g_artnet_socket){ dmx_frame |= g_universes.poll(*g_artnet_socket, millis()); }
+    if(g_sacn_socket){ dmx_frame |= g_universes.poll(*g_sacn_socket, millis()); }
+
+    if(dmx_frame)
+    {
+        for(size_t i = 0; i < g_num_paths; i++){ g_path[i]->strip()->show(); }
+        set_streaming();
+    }
+#endif
+
     if(g_time_accum >= g_update_interval)
     {
         // flash red indicator LED
         if(g_use_indicator){ digitalWrite(13, g_indicator); }
         g_indicator = !g_indicator;
 
-        // read debug inputs
-        process_input(Serial);
-
-#ifdef USE_NETWORK
-        uint32_t num_connections = 0;
-        auto net_clients = g_net_helper->connected_clients(&num_connections);
-        for(uint8_t i = 0; i < num_connections; ++i){ process_input(*net_clients[i]); }
-#endif
-
         if(!(g_run_mode & MODE_STREAMING))
         {
+#ifdef USE_NETWORK
+            // phase-locked with the other nodes
+            if(g_time_sync.synced()){ g_mode_current->set_time(g_time_sync.global_millis(micros())); }
+#endif
             for(uint8_t i = 0; i < g_num_paths; ++i)
             {
                 g_mode_current->process(g_path[i], g_time_accum);
@@ -161,125 +264,138 @@ void loop()
     }
 }
 
-template <typename T> void process_input(T& the_device)
+//! copy a validated frame from the_source into its path, show all paths if requested
+void apply_frame(input_t &the_source)
 {
-    g_buf_index = 0;
+    const frame_header_t &header = the_source.frames.header();
+    LED_Path *path = header.path < g_num_paths ? g_path[header.path] : nullptr;
 
-    while(the_device.available())
+    if(write_frame(the_source.frames, the_source.stream, path ? path->data() : nullptr,
+                   path ? path->num_bytes() : 0, BYTES_PER_PIXEL))
     {
-        // get the new byte:
-        uint8_t c = the_device.read();
+        // other sources' delta-frames no longer match the LED-state
+        invalidate_streams(&the_source);
+    }
 
-        switch(c)
-        {
-            case '\r':
-            case '\0':
-                continue;
-
-            case '\n':
-                g_serial_buf[g_buf_index] = '\0';
-                g_buf_index = 0;
-                parse_line(the_device, g_serial_buf);
-                break;
-
-            default:
-                // add it to the buf
-                g_serial_buf[g_buf_index] = c;
-                g_buf_index = (g_buf_index + 1) % SERIAL_BUFSIZE;
-                break;
-        }
+    if(header.flags & FRAME_SHOW)
+    {
+        for(size_t i = 0; i < g_num_paths; i++){ g_path[i]->strip()->show(); }
     }
+    set_streaming();
 }
 
-template <typename T> void parse_line(T& the_device, char *the_line)
+void cmd_query_id(Print &the_device, kinski::Args &the_args)
 {
-    const char* cmd_token = strtok(the_line, ":");
+    char buf[32];
+    sprintf(buf, "%s %s\n", CMD_QUERY_ID, DEVICE_ID);
+    the_device.write((const uint8_t*)buf, strlen(buf));
+}
+
+void cmd_segment(Print &the_device, kinski::Args &the_args)
+{
+    int32_t index;
 
-    if(strcmp(cmd_token, CMD_QUERY_ID) == 0)
+    // disable all segments
+    for (size_t p = 0; p < g_num_paths; p++)
     {
-        char buf[32];
-        sprintf(buf, "%s %s\n", CMD_QUERY_ID, DEVICE_ID);
-        the_device.write((const uint8_t*)buf, strlen(buf));
-        return;
+        for(uint32_t i = 0; i < g_path[p]->num_segments(); ++i)
+        {
+            g_path[p]->segment(i)->set_active(false);
+        }
     }
-    else if(strcmp(cmd_token, CMD_RECV_DATA) == 0)
+
+    while(the_args.next_int(&index))
     {
-        const char* arg_str = strtok(nullptr, " ");
-        uint32_t num_bytes = 0;
-        if(arg_str){ num_bytes = atoi(arg_str); }
+        size_t path_idx = 0;
 
-        for(size_t i = 0; i < g_num_paths; i++)
+        for(; path_idx < g_num_paths; path_idx++)
         {
-            size_t bytes_read = 0;
-            size_t num_path_bytes = min(num_bytes, g_path[i]->num_bytes());
-            num_bytes -= num_path_bytes;
+            if(index < g_path[path_idx]->num_segments()){ break; }
+            index -= g_path[path_idx]->num_segments();
+        }
 
-            while(bytes_read < num_path_bytes)
-            {
-                bytes_read += the_device.readBytes((char*)g_path[i]->data() + bytes_read,
-                                                   num_path_bytes - bytes_read);
-            }
+        if(index >= 0 && path_idx < g_num_paths)
+        {
+            g_run_mode = MODE_DEBUG;
+            g_mode_current = g_mode_sinus;
+            Segment *s = g_path[path_idx]->segment(index);
+            s->set_active(true);
+            s->set_color(ORANGE);
         }
+        else
+        {
+            g_run_mode = MODE_RUNNING;
+            g_mode_current = g_mode_composite;
+            for(uint8_t i = 0; i < g_num_paths; ++i){ g_mode_current->reset(g_path[i]); }
+            break;
+        }
+    }
+    for(size_t p = 0; p < g_num_paths; p++){ g_path[p]->update(0); }
+}
 
-        for(size_t i = 0; i < g_num_paths; i++){ g_path[i]->strip()->show(); }
-        g_run_mode = MODE_STREAMING;
+void cmd_brightness(Print &the_device, kinski::Args &the_args)
+{
+    float val;
+    if(the_args.next_float(&val)){ g_path[0]->set_brightness(clamp<float>(val, 0.f, 1.f)); }
+}
 
-        // start a timer to return <g_run_mode> to normal
-        g_timer[TIMER_RUNMODE].expires_from_now(2.f);
-        return;
-    }
-    else if(strcmp(cmd_token, CMD_SEGMENT) == 0)
+#ifdef USE_NETWORK
+//! WiFi-metrics: state, ms to first connection, outages (count, last, max, total ms), attempts, scans
+void cmd_network(Print &the_device, kinski::Args &the_args)
+{
+    const wifi_stats_t &stats = g_net_helper->wifi_stats();
+    const uint32_t values[] =
     {
-        const char* arg_str = nullptr;
+        (uint32_t)g_net_helper->wifi_state(), stats.boot_to_network, stats.num_outages,
+        stats.last_outage, stats.max_outage, stats.total_outage, stats.num_attempts,
+        stats.num_scans
+    };
+    char buf[sizeof(CMD_NETWORK) + sizeof(values) / sizeof(uint32_t) * (FMT_INT_MAX_CHARS + 1) + 1];
+    char *ptr = kinski::fmt_str(buf, CMD_NETWORK);
+
+    for(uint32_t v : values)
+    {
+        ptr = kinski::fmt_char(ptr, ' ');
+        ptr = kinski::fmt_uint(ptr, v);
+    }
+    ptr = kinski::fmt_char(ptr, '\n');
+    the_device.write((const uint8_t*)buf, ptr - buf);
+}
+#endif
 
-        // disable all segments
-        for (size_t p = 0; p < g_num_paths; p++)
-        {
-            for(uint32_t i = 0; i < g_path[p]->num_segments(); ++i)
-            {
-                g_path[p]->segment(i)->set_active(false);
-            }
-        }
+//! sorted by name
+constexpr kinski::command_t<Print> g_commands[] =
+{
+    {CMD_BRIGHTNESS, &cmd_brightness},
+    {CMD_QUERY_ID, &cmd_query_id},
+#ifdef USE_NETWORK
+    {CMD_NETWORK, &cmd_network},
+#endif
+    {CMD_SEGMENT, &cmd_segment}
+};
+static_assert(kinski::is_sorted(g_commands), "command-table must be sorted by name");
 
-        while((arg_str = strtok(nullptr, " ")))
-        {
-            int index = atoi(arg_str);
-            size_t path_idx = 0;
+template <typename T> void process_input(T& the_device, input_t &the_input)
+{
+    FrameParser &parser = the_input.frames;
+    kinski::LineBuffer<SERIAL_BUFSIZE> &lines = the_input.lines;
 
-            for(; path_idx < g_num_paths; path_idx++)
-            {
-                if(index < g_path[path_idx]->num_segments()){ break; }
-                index -= g_path[path_idx]->num_segments();
-            }
+    // partial lines are kept in the source's line-buffer until their newline arrives
+    while(the_device.available())
+    {
+        // get the new byte:
+        uint8_t c = the_device.read();
 
-            if(index >= 0 && index < g_path[path_idx]->num_segments())
-            {
-                g_run_mode = MODE_DEBUG;
-                g_mode_current = g_mode_sinus;
-                Segment *s = g_path[path_idx]->segment(index);
-                s->set_active(true);
-                s->set_color(ORANGE);
-            }
-            else
-            {
-                g_run_mode = MODE_RUNNING;
-                g_mode_current = g_mode_composite;
-                for(uint8_t i = 0; i < g_num_paths; ++i){ g_mode_current->reset(g_path[i]); }
-                break;
-            }
+        // binary frames start with a non-ASCII sync byte
+        if(parser.busy() || c == FRAME_SYNC_0)
+        {
+            if(parser.feed(c)){ apply_frame(the_input); }
+            continue;
         }
-        for(size_t p = 0; p < g_num_paths; p++){ g_path[p]->update(0); }
-        return;
-    }
-    else if(strcmp(cmd_token, CMD_BRIGHTNESS) == 0)
-    {
-        const char* arg_str = strtok(nullptr, " ");
-        float val = g_path[0]->brightness();
 
-        if(arg_str)
+        if(lines.feed(c))
         {
-            val = clamp<float>(atof(arg_str), 0.f, 1.f);
-            g_path[0]->set_brightness(val);
+            kinski::dispatch_command(g_commands, the_device, lines.line(), lines.length());
         }
     }
 }
@@ -0,0 +1,119 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+'''
+encoder for the LED frame op-stream (see FrameCodec.h)
+
+keyframes are built from LITERAL and RUN ops only,
+delta-frames additionally SKIP unchanged pixels and XOR_RUN repeated changes.
+'''
+
+OP_SKIP = 0
+OP_LITERAL = 1
+OP_RUN = 2
+OP_XOR_RUN = 3
+OP_MAX_COUNT = 64
+
+# biggest possible op: header + OP_MAX_COUNT literal pixels
+def max_op_size(the_bytes_per_pixel):
+  return 1 + OP_MAX_COUNT * the_bytes_per_pixel
+
+#############################################################
+
+def op_byte(the_op, the_count):
+  return bytearray([(the_op << 6) | (the_count - 1)])
+
+def run_length(the_pixels, the_start, the_key=lambda i: i):
+  """number of consecutive pixels from the_start with the same the_key(pixel)"""
+  n = 1
+  val = the_key(the_pixels[the_start])
+  while the_start + n < len(the_pixels) and n < OP_MAX_COUNT and \
+        the_key(the_pixels[the_start + n]) == val:
+    n += 1
+  return n
+
+def encode(the_current, the_previous=None, the_bytes_per_pixel=4, the_start=0,
+           the_max_bytes=512):
+  """
+  encode pixels of the_current (bytes), starting at pixel the_start.
+  the_previous == None results in a keyframe.
+  stops before the output would exceed the_max_bytes.
+  returns (payload, end pixel)
+  """
+  bpp = the_bytes_per_pixel
+  cur = [bytes(the_current[i:i + bpp]) for i in range(0, len(the_current), bpp)]
+  prev = None
+  if the_previous is not None:
+    prev = [bytes(the_previous[i:i + bpp]) for i in range(0, len(the_previous), bpp)]
+
+  def unchanged(i):
+    return prev is not None and cur[i] == prev[i]
+
+  def xor_pixel(i):
+    return bytes(bytearray(a ^ b for a, b in zip(bytearray(cur[i]), bytearray(prev[i]))))
+
+  out = bytearray()
+  literal = []
+  i = the_start
+
+  def flush_literal():
+    if literal:
+      out.extend(op_byte(OP_LITERAL, len(literal)))
+      for p in literal: out.extend(p)
+      del literal[:]
+
+  while i < len(cur) and len(out) + len(literal) * bpp + max_op_size(bpp) <= the_max_bytes:
+    if unchanged(i):
+      flush_literal()
+      n = 1
+      while i + n < len(cur) and n < OP_MAX_COUNT and unchanged(i + n): n += 1
+      out.extend(op_byte(OP_SKIP, n))
+      i += n
+      continue
+
+    n = run_length(cur, i)
+    if n >= 2:
+      flush_literal()
+      out.extend(op_byte(OP_RUN, n) + cur[i])
+      i += n
+      continue
+
+    if prev is not None:
+      n = 1
+      x = xor_pixel(i)
+      while i + n < len(cur) and n < OP_MAX_COUNT and not unchanged(i + n) and \
+            xor_pixel(i + n) == x:
+        n += 1
+      if n >= 2:
+        flush_literal()
+        out.extend(op_byte(OP_XOR_RUN, n) + x)
+        i += n
+        continue
+
+    literal.append(cur[i])
+    if len(literal) == OP_MAX_COUNT: flush_literal()
+    i += 1
+
+  flush_literal()
+  return bytes(out), i
+
+def decode(the_payload, the_target, the_bytes_per_pixel=4, the_offset=0):
+  """reference decoder, applies the_payload to the bytearray the_target"""
+  bpp = the_bytes_per_pixel
+  src = bytearray(the_payload)
+  pos, dst = 0, the_offset
+
+  while pos < len(src):
+    op, num_bytes = src[pos] >> 6, ((src[pos] & 0x3F) + 1) * bpp
+    pos += 1
+
+    if op == OP_LITERAL:
+      the_target[dst:dst + num_bytes] = src[pos:pos + num_bytes]
+      pos += num_bytes
+    elif op in (OP_RUN, OP_XOR_RUN):
+      pixel = src[pos:pos + bpp]
+      pos += bpp
+      for i in range(dst, dst + num_bytes, bpp):
+        if op == OP_RUN: the_target[i:i + bpp] = pixel
+        else: the_target[i:i + bpp] = bytearray(a ^ b for a, b in zip(the_target[i:i + bpp], pixel))
+    dst += num_bytes
+  return the_target
@@ -0,0 +1,139 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+'''
+python script to stream LED data to a tube_base_2017 device,
+using the binary frame protocol (see FrameParser.h)
+
+usage: tube_stream.py <serial_port> [num_bytes] [fps] [raw]
+'''
+
+import sys, time, struct, colorsys
+import tube_codec
+
+SYNC = b'\xa5\xc3'
+MAX_PAYLOAD = 512
+FRAME_SHOW = 1 << 0
+FRAME_ENCODED = 1 << 1
+FRAME_KEY = 1 << 2
+
+# send a keyframe every n frames, so receivers recover from lost frames
+KEYFRAME_INTERVAL = 30
+BAUD_RATE = 2000000
+
+#############################################################
+
+def crc16_ccitt(the_data, the_crc=0xFFFF):
+  """CRC16-CCITT, polynomial 0x1021"""
+  for b in bytearray(the_data):
+    the_crc ^= b << 8
+    for _ in range(8):
+      the_crc = ((the_crc << 1) ^ 0x1021) if the_crc & 0x8000 else (the_crc << 1)
+      the_crc &= 0xFFFF
+  return the_crc
+
+def make_frame(the_frame_number, the_path, the_flags, the_offset, the_payload):
+  header = struct.pack('<HBBHH', the_frame_number & 0xFFFF, the_path, the_flags, the_offset,
+                       len(the_payload))
+  body = header + the_payload
+  return SYNC + body + struct.pack('<H', crc16_ccitt(body))
+
+def make_frames(the_frame_number, the_path, the_data, the_show=True):
+  """split raw LED data for one path into frames, the last one carrying FRAME_SHOW"""
+  frames = []
+  offsets = range(0, len(the_data), MAX_PAYLOAD) or [0]
+
+  for i, offset in enumerate(offsets):
+    flags = FRAME_SHOW if (the_show and i == len(offsets) - 1) else 0
+    frames.append(make_frame(the_frame_number + i, the_path, flags, offset,
+                             the_data[offset:offset + MAX_PAYLOAD]))
+  return frames
+
+def make_encoded_frames(the_frame_number, the_path, the_data, the_previous=None,
+                        the_bytes_per_pixel=4, the_show=True):
+  """
+  encode LED data for one path, as delta to the_previous or as keyframe (the_previous == None)
+  """
+  payloads = []
+  start, num_pixels = 0, len(the_data) // the_bytes_per_pixel
+
+  while start < num_pixels or not payloads:
+    payload, end = tube_codec.encode(the_data, the_previous, the_bytes_per_pixel, start,
+                                     MAX_PAYLOAD)
+    payloads.append((start * the_bytes_per_pixel, payload))
+    start = end
+
+  frames = []
+  for i, (offset, payload) in enumerate(payloads):
+    flags = FRAME_ENCODED | (FRAME_KEY if the_previous is None else 0)
+    if the_show and i == len(payloads) - 1: flags |= FRAME_SHOW
+    frames.append(make_frame(the_frame_number + i, the_path, flags, offset, payload))
+  return frames
+
+#############################################################
+
+class App(object):
+  def __init__(self, the_port, the_num_bytes, the_fps, the_raw=False):
+    # only needed for streaming, the framing-functions work without pyserial
+    import serial
+    self.serial = serial.Serial(the_port, BAUD_RATE)
+    self.num_bytes = the_num_bytes
+    self.fps = the_fps
+    self.raw = the_raw
+    self.frame_number = 0
+    self.num_updates = 0
+    self.previous = None
+    self.running = True
+
+  def pattern(self, the_time):
+    """rotating rainbow, RGBW byte order"""
+    num_pixels = self.num_bytes // 4
+    data = bytearray()
+
+    for i in range(num_pixels):
+      r, g, b = colorsys.hsv_to_rgb((the_time * 0.2 + i / float(num_pixels)) % 1.0, 1.0, 1.0)
+      data += bytearray([int(r * 255), int(g * 255), int(b * 255), 0])
+    return bytes(data)
+
+  def run(self):
+    start = time.time()
+    num_sent = 0
+
+    while self.running:
+      try:
+        data = self.pattern(time.time() - start)
+
+        if self.raw:
+          frames = make_frames(self.frame_number, 0, data)
+        else:
+          key = self.num_updates % KEYFRAME_INTERVAL == 0
+          frames = make_encoded_frames(self.frame_number, 0, data,
+                                       None if key else self.previous)
+          self.previous = data
+
+        self.frame_number = (self.frame_number + len(frames)) & 0xFFFF
+        self.num_updates += 1
+
+        for f in frames:
+          self.serial.write(f)
+          num_sent += len(f)
+
+        elapsed = time.time() - start
+        sys.stdout.write("\r{:.1f} kB/s".format(num_sent / elapsed / 1024.0))
+        time.sleep(1.0 / self.fps)
+
+      except KeyboardInterrupt:
+        print("\n->keyboard interrupt<-")
+        self.running = False
+        print("ciao\n")
+
+#############################################################
+
+if __name__ == '__main__':
+  if len(sys.argv) < 2:
+    print(__doc__)
+    sys.exit(1)
+
+  num_bytes = int(sys.argv[2]) if len(sys.argv) > 2 else 24 * 4
+  fps = float(sys.argv[3]) if len(sys.argv) > 3 else 60.0
+  raw = len(sys.argv) > 4 and sys.argv[4] == 'raw'
+  App(sys.argv[1], num_bytes, fps, raw).run()
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "UniverseReceiver.h"
+
+// Art-Net / sACN, DMX-universes mapped to byte-ranges of our paths
+struct universe_config_t
+{
+    uint16_t universe;
+    uint8_t path;
+    uint16_t offset;
+};
+const universe_config_t g_universe_config[] =
+{
+    {0, 0, 0}
+};
+
+/*! map the universes of the_config into the_paths (anything providing data() and num_bytes()),
+ *  each up to the end of its path, at most s_max_num_slots bytes.
+ *  entries for missing paths, offsets beyond a path's end and repeated universes are skipped.
+ *  returns the number of mapped universes
+ */
+template <typename T, size_t N>
+uint8_t add_universes(kinski::UniverseReceiver &the_receiver,
+                      const universe_config_t (&the_config)[N], T *const *the_paths,
+                      uint8_t the_num_paths)
+{
+    uint8_t ret = 0;
+
+    for(size_t i = 0; i < N; ++i)
+    {
+        const universe_config_t &cfg = the_config[i];
+        if(cfg.path >= the_num_paths || cfg.offset >= the_paths[cfg.path]->num_bytes()){ continue; }
+
+        uint32_t num_bytes = the_paths[cfg.path]->num_bytes() - cfg.offset;
+        if(num_bytes > kinski::UniverseReceiver::s_max_num_slots)
+        {
+            num_bytes = kinski::UniverseReceiver::s_max_num_slots;
+        }
+        ret += the_receiver.add_universe(cfg.universe, the_paths[cfg.path]->data() + cfg.offset,
+                                         num_bytes);
+    }
+    return ret;
+}